@@ -0,0 +1,98 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+namespace hal::rmd::benchmark {
+/**
+ * @brief Emit a single result as a line of JSON on stdout
+ *
+ * Every benchmark reports through this function so the output of the
+ * benchmark executable can be diffed and parsed by scripts. Each line has the
+ * form:
+ *
+ *    {"benchmark":"drc/velocity_control","metric":"ns_per_op","value":12.5}
+ *
+ * @param p_benchmark - name of the benchmark, "<group>/<case>"
+ * @param p_metric - name of the measured quantity including its unit
+ * @param p_value - measured value
+ */
+inline void report(std::string_view p_benchmark,
+                   std::string_view p_metric,
+                   double p_value)
+{
+  std::printf(R"({"benchmark":"%.*s","metric":"%.*s","value":%.6g})"
+              "\n",
+              static_cast<int>(p_benchmark.size()),
+              p_benchmark.data(),
+              static_cast<int>(p_metric.size()),
+              p_metric.data(),
+              p_value);
+}
+
+/**
+ * @brief Prevent the compiler from optimizing away a value
+ *
+ * @param p_value - value that must be computed
+ */
+template<class T>
+inline void do_not_optimize(T const& p_value)
+{
+  asm volatile("" : : "r,m"(p_value) : "memory");
+}
+
+/**
+ * @brief Measure the average time of an operation
+ *
+ * The operation is run in batches that double in size until a batch takes at
+ * least the minimum measurement time, then the average time per operation of
+ * that batch is reported as "ns_per_op" and "ops_per_sec".
+ *
+ * @param p_benchmark - name of the benchmark, "<group>/<case>"
+ * @param p_operation - operation to measure
+ */
+template<class operation>
+void measure(std::string_view p_benchmark, operation&& p_operation)
+{
+  using clock = std::chrono::steady_clock;
+  constexpr auto minimum_time = std::chrono::milliseconds(100);
+
+  // Warm up caches and branch predictors
+  for (int i = 0; i < 1000; i++) {
+    p_operation();
+  }
+
+  for (std::uint64_t iterations = 1024;; iterations *= 2) {
+    auto const start = clock::now();
+    for (std::uint64_t i = 0; i < iterations; i++) {
+      p_operation();
+    }
+    auto const elapsed = clock::now() - start;
+
+    if (minimum_time <= elapsed) {
+      auto const nanoseconds =
+        std::chrono::duration<double, std::nano>(elapsed).count();
+      auto const ns_per_op = nanoseconds / static_cast<double>(iterations);
+      report(p_benchmark, "ns_per_op", ns_per_op);
+      report(p_benchmark, "ops_per_sec", 1e9 / ns_per_op);
+      return;
+    }
+  }
+}
+}  // namespace hal::rmd::benchmark
@@ -0,0 +1,241 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <libhal-rmd/drc.hpp>
+#include <libhal-rmd/mc_x.hpp>
+#include <libhal-rmd/simulated_bus.hpp>
+#include <libhal-util/can.hpp>
+
+#include "benchmark.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr can::id_t first_id = 0x141;
+constexpr can::id_t mc_x_reply_offset = 0x100;
+constexpr can::id_t mc_x_broadcast_id = 0x280;
+constexpr auto response_timeout = std::chrono::milliseconds(20);
+/// Motor firmware processing time and its variation
+constexpr std::uint64_t processing_ns = 50'000;
+constexpr std::uint64_t jitter_ns = 20'000;
+constexpr std::size_t round_trips = 1000;
+constexpr std::size_t sweeps = 200;
+
+simulated_bus::device_t device(std::size_t p_index,
+                                          can::id_t p_reply_offset)
+{
+  auto const id = static_cast<can::id_t>(first_id + p_index);
+  return {
+    .id = id,
+    .reply_id = id + p_reply_offset,
+    .processing_ns = processing_ns,
+    .jitter_ns = jitter_ns,
+    .broadcast_id = mc_x_broadcast_id,
+  };
+}
+
+void report_samples(char const* p_name,
+                    std::vector<std::uint64_t> const& p_samples)
+{
+  double sum = 0.0;
+  std::uint64_t best = p_samples.front();
+  std::uint64_t worst = p_samples.front();
+  for (auto const sample : p_samples) {
+    sum += static_cast<double>(sample);
+    best = std::min(best, sample);
+    worst = std::max(worst, sample);
+  }
+  auto const mean = sum / static_cast<double>(p_samples.size());
+  double variance = 0.0;
+  for (auto const sample : p_samples) {
+    auto const error = static_cast<double>(sample) - mean;
+    variance += error * error;
+  }
+  variance /= static_cast<double>(p_samples.size());
+
+  benchmark::report(p_name, "mean_us", mean / 1e3);
+  benchmark::report(p_name, "jitter_us", std::sqrt(variance) / 1e3);
+  benchmark::report(p_name, "best_us", static_cast<double>(best) / 1e3);
+  benchmark::report(p_name, "worst_us", static_cast<double>(worst) / 1e3);
+}
+
+/**
+ * @brief Round trip time of feedback requests to a single motor
+ *
+ * @param p_name - name of the benchmark
+ * @param p_request - function that performs a single blocking request
+ * @param p_bus - bus the motor is on
+ */
+template<class request>
+void round_trip(char const* p_name,
+                simulated_bus& p_bus,
+                request&& p_request)
+{
+  std::vector<std::uint64_t> samples;
+  samples.reserve(round_trips);
+  for (std::size_t i = 0; i < round_trips; i++) {
+    auto const start = p_bus.now();
+    p_request();
+    samples.push_back(p_bus.now() - start);
+  }
+  report_samples(p_name, samples);
+}
+
+void drc_round_trip()
+{
+  simulated_bus bus;
+  bus.add_device(device(0, 0));
+  hal::can_router router(bus.host());
+  drc motor(
+    router, bus, 1.0f, first_id, response_timeout, drc::startup::attach);
+
+  round_trip("simulated_bus/drc_round_trip", bus, [&motor] {
+    motor.feedback_request(drc::read::status_2);
+  });
+}
+
+void mc_x_round_trip()
+{
+  simulated_bus bus;
+  bus.add_device(device(0, mc_x_reply_offset));
+  hal::can_router router(bus.host());
+  mc_x motor(router, bus, 1.0f, first_id, response_timeout);
+
+  round_trip("simulated_bus/mc_x_round_trip", bus, [&motor] {
+    motor.feedback_request(mc_x::read::status_2);
+  });
+}
+
+/**
+ * @brief Sweep the status of every DRC motor on the bus
+ *
+ * Compares polling each motor in turn to `drc::verify_alive()`, which sends
+ * every request back to back so the replies contend for the bus.
+ *
+ * @param p_motor_count - number of motors on the bus
+ * @param p_pipelined - use verify_alive instead of polling in turn
+ */
+void drc_sweep(std::size_t p_motor_count, bool p_pipelined)
+{
+  simulated_bus bus;
+  for (std::size_t i = 0; i < p_motor_count; i++) {
+    bus.add_device(device(i, 0));
+  }
+  hal::can_router router(bus.host());
+  std::vector<std::unique_ptr<drc>> motors;
+  std::vector<drc*> pointers;
+  for (std::size_t i = 0; i < p_motor_count; i++) {
+    motors.push_back(
+      std::make_unique<drc>(router,
+                            bus,
+                            1.0f,
+                            static_cast<can::id_t>(first_id + i),
+                            response_timeout,
+                            drc::startup::attach));
+    pointers.push_back(motors.back().get());
+  }
+
+  std::vector<std::uint64_t> samples;
+  samples.reserve(sweeps);
+  for (std::size_t i = 0; i < sweeps; i++) {
+    auto const start = bus.now();
+    if (p_pipelined) {
+      drc::verify_alive(pointers);
+    } else {
+      for (auto* motor : pointers) {
+        motor->feedback_request(drc::read::status_1_and_error_flags);
+      }
+    }
+    samples.push_back(bus.now() - start);
+  }
+
+  std::array<char, 64> name{};
+  std::snprintf(name.data(),
+                name.size(),
+                "simulated_bus/drc_%s_%zu_motors",
+                p_pipelined ? "verify_alive" : "polled",
+                p_motor_count);
+  report_samples(name.data(), samples);
+  benchmark::report(name.data(), "utilization", bus.utilization());
+  benchmark::report(name.data(),
+                    "arbitration_losses_per_sweep",
+                    static_cast<double>(bus.stats().arbitration_losses) /
+                      sweeps);
+  benchmark::report(name.data(),
+                    "worst_access_us",
+                    static_cast<double>(bus.stats().worst_access_ns) / 1e3);
+}
+
+/**
+ * @brief Broadcast stop to every MC-X motor, all of them reply at once
+ *
+ * @param p_motor_count - number of motors on the bus
+ */
+void mc_x_broadcast_stop(std::size_t p_motor_count)
+{
+  simulated_bus bus;
+  for (std::size_t i = 0; i < p_motor_count; i++) {
+    bus.add_device(device(i, mc_x_reply_offset));
+  }
+  hal::can_router router(bus.host());
+  std::vector<std::unique_ptr<mc_x>> motors;
+  std::vector<mc_x*> pointers;
+  for (std::size_t i = 0; i < p_motor_count; i++) {
+    auto const id = static_cast<can::id_t>(first_id + i);
+    motors.push_back(
+      std::make_unique<mc_x>(router, bus, 1.0f, id, response_timeout));
+    pointers.push_back(motors.back().get());
+  }
+
+  std::vector<std::uint64_t> samples;
+  samples.reserve(sweeps);
+  for (std::size_t i = 0; i < sweeps; i++) {
+    auto const start = bus.now();
+    mc_x::emergency_stop_all(pointers);
+    samples.push_back(bus.now() - start);
+  }
+
+  std::array<char, 64> name{};
+  std::snprintf(name.data(),
+                name.size(),
+                "simulated_bus/mc_x_broadcast_stop_%zu_motors",
+                p_motor_count);
+  report_samples(name.data(), samples);
+  benchmark::report(name.data(),
+                    "arbitration_losses_per_stop",
+                    static_cast<double>(bus.stats().arbitration_losses) /
+                      sweeps);
+}
+}  // namespace
+
+void bus_simulation_benchmark()
+{
+  // 1 Mbit/s, 50us +/- 20us motor processing time, 1us between clock polls
+  drc_round_trip();
+  mc_x_round_trip();
+  for (std::size_t motor_count : { 1, 4, 8, 16, 32 }) {
+    drc_sweep(motor_count, false);
+    drc_sweep(motor_count, true);
+  }
+  for (std::size_t motor_count : { 1, 8, 32 }) {
+    mc_x_broadcast_stop(motor_count);
+  }
+}
+}  // namespace hal::rmd
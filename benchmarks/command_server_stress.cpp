@@ -0,0 +1,144 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <libhal-rmd/linux/command_server.hpp>
+#include <libhal-util/can.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "benchmark.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr std::size_t motor_count = 8;
+constexpr can::id_t first_id = 0x141;
+constexpr std::size_t commands_per_producer = 20'000;
+/// Futures each producer keeps outstanding before waiting on the oldest
+constexpr std::size_t window = 8;
+
+/// Replies to every frame on the calling thread as soon as it is sent
+struct instant_can : public hal::can
+{
+  hal::callback<handler> receive = [](message_t const&) {};
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  void driver_bus_on() override
+  {
+  }
+
+  void driver_send(message_t const& p_message) override
+  {
+    receive(p_message);
+  }
+
+  void driver_on_receive(hal::callback<handler> p_handler) override
+  {
+    receive = p_handler;
+  }
+};
+
+struct host_clock : public hal::steady_clock
+{
+private:
+  hal::hertz driver_frequency() override
+  {
+    return 1'000'000'000.0f;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    auto const now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  }
+};
+
+void producers_benchmark(std::size_t p_producers)
+{
+  instant_can bus;
+  host_clock clock;
+  hal::can_router router(bus);
+  std::vector<std::unique_ptr<drc>> motors;
+  for (std::size_t i = 0; i < motor_count; i++) {
+    motors.push_back(
+      std::make_unique<drc>(router,
+                            clock,
+                            1.0f,
+                            static_cast<can::id_t>(first_id + i),
+                            std::chrono::milliseconds(10),
+                            drc::startup::attach));
+  }
+  std::array<hal::byte, 8> const status_2{ hal::value(drc::read::status_2) };
+
+  command_server server(clock);
+  auto const start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t p = 0; p < p_producers; p++) {
+      threads.emplace_back([&, p]() {
+        std::deque<std::future<command_server::feedback_t>> outstanding;
+        for (std::size_t i = 0; i < commands_per_producer; i++) {
+          auto* motor = motors[(p + i) % motor_count].get();
+          std::optional<std::future<command_server::feedback_t>> future;
+          while (not(future = server.submit(motor, status_2))) {
+            std::this_thread::yield();
+          }
+          outstanding.push_back(std::move(*future));
+          if (outstanding.size() == window) {
+            benchmark::do_not_optimize(outstanding.front().get());
+            outstanding.pop_front();
+          }
+        }
+        for (auto& pending : outstanding) {
+          benchmark::do_not_optimize(pending.get());
+        }
+      });
+    }
+  }
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+
+  auto const seconds = std::chrono::duration<double>(elapsed).count();
+  auto const commands = static_cast<double>(p_producers) *
+                        static_cast<double>(commands_per_producer);
+  std::array<char, 64> name{};
+  std::snprintf(name.data(),
+                name.size(),
+                "command_server/%zu_producers",
+                p_producers);
+  benchmark::report(name.data(), "commands_per_sec", commands / seconds);
+  benchmark::report(
+    name.data(), "completed", static_cast<double>(server.completed()));
+}
+}  // namespace
+
+void command_server_benchmark()
+{
+  // 8 motors that reply instantly, so the I/O thread and the queue are the
+  // bottleneck.
+  for (std::size_t producers : { 1, 2, 4, 8 }) {
+    producers_benchmark(producers);
+  }
+}
+}  // namespace hal::rmd
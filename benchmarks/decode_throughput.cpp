@@ -0,0 +1,130 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <libhal-rmd/can_trace.hpp>
+#include <libhal-rmd/drc.hpp>
+#include <libhal-rmd/mc_x.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "benchmark.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr std::size_t motor_count = 8;
+constexpr std::size_t frame_count = 200'000;
+constexpr can::id_t drc_first_id = 0x141;
+constexpr can::id_t mc_x_first_id = drc_first_id + motor_count;
+constexpr can::id_t mc_x_response_offset = 0x100;
+
+struct null_clock : public hal::steady_clock
+{
+  hal::hertz driver_frequency() override
+  {
+    return 1'000'000.0f;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    return 0;
+  }
+};
+
+/**
+ * @brief Build a trace of responses that cycles through every decoded command
+ * for a bus of drc and mc_x motors.
+ */
+std::vector<hal::byte> synthesize_session()
+{
+  constexpr std::array commands{
+    hal::value(drc::read::status_2),
+    hal::value(drc::actuate::speed),
+    hal::value(drc::read::status_1_and_error_flags),
+    hal::value(drc::read::multi_turns_angle),
+  };
+
+  std::vector<hal::byte> trace;
+  auto const header = encode_trace_header(1'000'000.0f);
+  trace.insert(trace.end(), header.begin(), header.end());
+
+  std::array<hal::byte, max_trace_record_size> buffer{};
+  std::uint64_t previous = 0;
+  for (std::size_t i = 0; i < frame_count; i++) {
+    auto const motor = i % (2 * motor_count);
+    auto const id = motor < motor_count
+                      ? drc_first_id + motor
+                      : mc_x_first_id + (motor - motor_count) +
+                          mc_x_response_offset;
+    auto const value = static_cast<hal::byte>(i);
+    trace_record const record{
+      .timestamp = previous + 250,
+      .direction = trace_direction::receive,
+      .message = {
+        .id = static_cast<can::id_t>(id),
+        .payload = { commands[(i / (2 * motor_count)) % commands.size()],
+                     value, value, value, value, value, value, value },
+        .length = 8,
+      },
+    };
+    auto const encoded = encode_trace_record(record, previous, buffer);
+    trace.insert(trace.end(), encoded.begin(), encoded.end());
+    previous = record.timestamp;
+  }
+
+  return trace;
+}
+}  // namespace
+
+void decode_throughput_benchmark()
+{
+  constexpr int iterations = 10;
+  auto const trace = synthesize_session();
+
+  null_clock clock;
+  can_trace_replay replay(trace);
+  hal::can_router router(replay);
+  std::vector<std::unique_ptr<drc>> drc_motors;
+  std::vector<std::unique_ptr<mc_x>> mc_x_motors;
+  for (std::size_t i = 0; i < motor_count; i++) {
+    drc_motors.push_back(
+      std::make_unique<drc>(router,
+                            clock,
+                            6.0f,
+                            static_cast<can::id_t>(drc_first_id + i),
+                            std::chrono::milliseconds(10),
+                            drc::startup::attach));
+    mc_x_motors.push_back(std::make_unique<mc_x>(
+      router, clock, 36.0f, static_cast<can::id_t>(mc_x_first_id + i)));
+  }
+
+  std::size_t delivered = 0;
+  auto const start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    replay.rewind();
+    delivered += replay.replay_all();
+  }
+  auto const stop = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double> const elapsed = stop - start;
+  auto const frames = static_cast<double>(delivered);
+  auto const frames_per_sec = frames / elapsed.count();
+  benchmark::report("replay/decode", "frames_per_sec", frames_per_sec);
+  benchmark::report(
+    "replay/decode", "ns_per_frame", elapsed.count() * 1e9 / frames);
+}
+}  // namespace hal::rmd
@@ -0,0 +1,307 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <libhal-rmd/any_motor.hpp>
+#include <libhal-rmd/drc.hpp>
+#include <libhal-rmd/mc_x.hpp>
+#include <libhal-rmd/motor.hpp>
+#include <libhal-rmd/motor_bank.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "benchmark.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr can::id_t device_id = 0x141;
+constexpr can::id_t mc_x_response_offset = 0x100;
+
+/// Responds to every frame immediately from within send()
+struct zero_latency_can : public hal::can
+{
+  can::id_t response_offset = 0;
+  hal::callback<handler> receive = [](message_t const&) {};
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  void driver_bus_on() override
+  {
+  }
+
+  void driver_send(message_t const& p_message) override
+  {
+    auto response = p_message;
+    response.id += response_offset;
+    receive(response);
+  }
+
+  void driver_on_receive(hal::callback<handler> p_handler) override
+  {
+    receive = p_handler;
+  }
+};
+
+/// Clock that advances one tick per read, so timeouts never expire early
+struct counting_clock : public hal::steady_clock
+{
+  std::uint64_t ticks = 0;
+
+private:
+  hal::hertz driver_frequency() override
+  {
+    return 1'000'000.0f;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    return ticks++;
+  }
+};
+
+can::message_t response(can::id_t p_id, hal::byte p_command)
+{
+  return {
+    .id = p_id,
+    .payload = { p_command, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77 },
+    .length = 8,
+  };
+}
+
+std::string name(char const* p_group, char const* p_case)
+{
+  return std::string(p_group) + "/" + p_case;
+}
+
+template<class driver>
+void decode_benchmarks(char const* p_group, driver& p_driver, can::id_t p_id)
+{
+  using read = typename driver::read;
+
+  struct decode_case
+  {
+    char const* name;
+    hal::byte command;
+  };
+
+  std::array const cases{
+    decode_case{ "decode_status_2", hal::value(read::status_2) },
+    decode_case{ "decode_status_1",
+                 hal::value(read::status_1_and_error_flags) },
+    decode_case{ "decode_multi_turns_angle",
+                 hal::value(read::multi_turns_angle) },
+    decode_case{ "decode_unknown", 0xFF },
+  };
+
+  for (auto const& decode : cases) {
+    auto const message = response(p_id, decode.command);
+    benchmark::measure(name(p_group, decode.name), [&]() {
+      p_driver(message);
+      benchmark::do_not_optimize(p_driver.feedback());
+    });
+  }
+}
+
+template<class driver>
+void command_benchmarks(char const* p_group, driver& p_driver)
+{
+  using namespace hal::literals;
+
+  float speed = 0.0f;
+  benchmark::measure(name(p_group, "velocity_control"), [&]() {
+    p_driver.velocity_control(speed);
+    speed += 0.25f;
+  });
+
+  float angle = 0.0f;
+  benchmark::measure(name(p_group, "position_control"), [&]() {
+    p_driver.position_control(angle, 10.0_rpm);
+    angle += 0.25f;
+  });
+
+  benchmark::measure(name(p_group, "feedback_request"), [&]() {
+    p_driver.feedback_request(driver::read::status_2);
+  });
+
+  std::array<hal::byte, 8> const payload{ hal::value(driver::read::status_2) };
+  benchmark::measure(name(p_group, "transmit"),
+                     [&]() { p_driver.transmit(payload); });
+}
+
+template<class sensor>
+void read_benchmark(char const* p_group, char const* p_case, sensor&& p_sensor)
+{
+  benchmark::measure(name(p_group, p_case), [&]() {
+    benchmark::do_not_optimize(p_sensor.read());
+  });
+}
+
+void drc_benchmarks()
+{
+  using namespace hal::literals;
+
+  zero_latency_can bus;
+  counting_clock clock;
+  hal::can_router router(bus);
+  drc driver(router, clock, 6.0f, device_id);
+
+  command_benchmarks("drc", driver);
+  decode_benchmarks("drc", driver, device_id);
+  read_benchmark(
+    "drc_adaptors", "temperature_read", make_temperature_sensor(driver));
+  read_benchmark(
+    "drc_adaptors", "rotation_read", make_rotation_sensor(driver));
+  read_benchmark("drc_adaptors",
+                 "angular_velocity_read",
+                 make_angular_velocity_sensor(driver));
+}
+
+/// Compile-time configured motors, compare with the runtime driver groups
+void static_motor_benchmarks()
+{
+  zero_latency_can drc_bus;
+  counting_clock clock;
+  hal::can_router drc_router(drc_bus);
+  motor<drc, 6, device_id> static_drc(drc_router, clock);
+  command_benchmarks("drc_static", static_drc);
+
+  zero_latency_can mc_x_bus;
+  mc_x_bus.response_offset = mc_x_response_offset;
+  hal::can_router mc_x_router(mc_x_bus);
+  motor<mc_x, 36, device_id> static_mc_x(mc_x_router, clock);
+  command_benchmarks("mc_x_static", static_mc_x);
+}
+
+void mc_x_benchmarks()
+{
+  zero_latency_can bus;
+  bus.response_offset = mc_x_response_offset;
+  counting_clock clock;
+  hal::can_router router(bus);
+  mc_x driver(router, clock, 36.0f, device_id);
+
+  command_benchmarks("mc_x", driver);
+  decode_benchmarks("mc_x", driver, device_id + mc_x_response_offset);
+  read_benchmark(
+    "mc_x_adaptors", "temperature_read", make_temperature_sensor(driver));
+  read_benchmark(
+    "mc_x_adaptors", "rotation_read", make_rotation_sensor(driver));
+  read_benchmark(
+    "mc_x_adaptors", "current_read", make_current_sensor(driver));
+}
+
+/// Mixed fleet through any_motor compared with the virtual hal adaptors
+void fleet_benchmarks()
+{
+  using namespace hal::literals;
+
+  zero_latency_can drc_bus;
+  zero_latency_can mc_x_bus;
+  mc_x_bus.response_offset = mc_x_response_offset;
+  counting_clock clock;
+  hal::can_router drc_router(drc_bus);
+  hal::can_router mc_x_router(mc_x_bus);
+  drc drc_a(drc_router, clock, 6.0f, device_id);
+  drc drc_b(drc_router, clock, 6.0f, device_id + 1);
+  mc_x mc_x_a(mc_x_router, clock, 36.0f, device_id + 2);
+  mc_x mc_x_b(mc_x_router, clock, 36.0f, device_id + 3);
+
+  std::array<any_motor, 4> fleet{ drc_a, drc_b, mc_x_a, mc_x_b };
+  auto drc_a_motor = make_motor(drc_a, 100.0_rpm);
+  auto drc_b_motor = make_motor(drc_b, 100.0_rpm);
+  auto mc_x_a_motor = make_motor(mc_x_a, 100.0_rpm);
+  auto mc_x_b_motor = make_motor(mc_x_b, 100.0_rpm);
+  std::array<hal::motor*, 4> const adaptors{
+    &drc_a_motor, &drc_b_motor, &mc_x_a_motor, &mc_x_b_motor
+  };
+  auto drc_a_temperature = make_temperature_sensor(drc_a);
+  auto drc_b_temperature = make_temperature_sensor(drc_b);
+  auto mc_x_a_temperature = make_temperature_sensor(mc_x_a);
+  auto mc_x_b_temperature = make_temperature_sensor(mc_x_b);
+  std::array<hal::temperature_sensor*, 4> const sensors{ &drc_a_temperature,
+                                                         &drc_b_temperature,
+                                                         &mc_x_a_temperature,
+                                                         &mc_x_b_temperature };
+
+  benchmark::measure("fleet/any_motor_velocity_x4", [&]() {
+    for (auto& motor : fleet) {
+      motor.velocity_control(50.0_rpm);
+    }
+  });
+  benchmark::measure("fleet/hal_motor_power_x4", [&]() {
+    for (auto* motor : adaptors) {
+      motor->power(0.5f);
+    }
+  });
+  benchmark::measure("fleet/any_motor_feedback_x4", [&]() {
+    for (auto const& motor : fleet) {
+      benchmark::do_not_optimize(motor.feedback());
+    }
+  });
+  benchmark::measure("fleet/hal_temperature_read_x4", [&]() {
+    for (auto* sensor : sensors) {
+      benchmark::do_not_optimize(sensor->read());
+    }
+  });
+}
+
+/// Scan the feedback of a full bus of motors, in place versus on the heap
+void bank_benchmarks()
+{
+  constexpr std::size_t motor_count = 32;
+
+  zero_latency_can bus;
+  counting_clock clock;
+  hal::can_router router(bus);
+  motor_bank<drc, motor_count> bank;
+  std::vector<std::unique_ptr<drc>> scattered;
+  for (std::size_t i = 0; i < motor_count; i++) {
+    auto const id = static_cast<can::id_t>(device_id + i);
+    bank.emplace(router, clock, 6.0f, id);
+    scattered.push_back(std::make_unique<drc>(router, clock, 6.0f, id));
+  }
+
+  benchmark::measure("fleet/motor_bank_scan_x32", [&]() {
+    std::int32_t total = 0;
+    for (auto const& motor : bank) {
+      total += motor.feedback().raw_speed;
+    }
+    benchmark::do_not_optimize(total);
+  });
+  benchmark::measure("fleet/unique_ptr_scan_x32", [&]() {
+    std::int32_t total = 0;
+    for (auto const& motor : scattered) {
+      total += motor->feedback().raw_speed;
+    }
+    benchmark::do_not_optimize(total);
+  });
+}
+}  // namespace
+
+void driver_microbenchmarks()
+{
+  drc_benchmarks();
+  mc_x_benchmarks();
+  static_motor_benchmarks();
+  fleet_benchmarks();
+  bank_benchmarks();
+}
+}  // namespace hal::rmd
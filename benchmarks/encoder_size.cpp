@@ -0,0 +1,181 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <libhal-rmd/motor.hpp>
+
+#include "benchmark.hpp"
+
+using static_drc = hal::rmd::motor<hal::rmd::drc, 6, 0x141>;
+using static_mc_x = hal::rmd::motor<hal::rmd::mc_x, 36, 0x141>;
+
+// Out of line instances of the compile-time encoders, with the speed and angle
+// only known at runtime, so their size can be looked up by name.
+extern "C"
+{
+  [[gnu::noinline, gnu::used]] void rmd_static_drc_velocity_control(
+    static_drc& p_motor,
+    hal::rpm p_speed)
+  {
+    p_motor.velocity_control(p_speed);
+  }
+
+  [[gnu::noinline, gnu::used]] void rmd_static_drc_position_control(
+    static_drc& p_motor,
+    hal::degrees p_angle,
+    hal::rpm p_speed)
+  {
+    p_motor.position_control(p_angle, p_speed);
+  }
+
+  [[gnu::noinline, gnu::used]] void rmd_static_mc_x_velocity_control(
+    static_mc_x& p_motor,
+    hal::rpm p_speed)
+  {
+    p_motor.velocity_control(p_speed);
+  }
+
+  [[gnu::noinline, gnu::used]] void rmd_static_mc_x_position_control(
+    static_mc_x& p_motor,
+    hal::degrees p_angle,
+    hal::rpm p_speed)
+  {
+    p_motor.position_control(p_angle, p_speed);
+  }
+}
+
+namespace hal::rmd {
+namespace {
+struct encoder_symbol
+{
+  std::string_view benchmark;
+  std::string_view symbol;
+};
+
+// The runtime speed helpers are listed on their own as the compiler may call
+// them or inline them into the commands.
+constexpr std::array encoders{
+  encoder_symbol{ "encoder_size/static_drc/velocity_control",
+                  "rmd_static_drc_velocity_control" },
+  encoder_symbol{ "encoder_size/runtime_drc/velocity_control",
+                  "_ZN3hal3rmd3drc16velocity_controlEf" },
+  encoder_symbol{ "encoder_size/static_drc/position_control",
+                  "rmd_static_drc_position_control" },
+  encoder_symbol{ "encoder_size/runtime_drc/position_control",
+                  "_ZN3hal3rmd3drc16position_controlEff" },
+  encoder_symbol{ "encoder_size/runtime_drc/rpm_to_drc_speed",
+                  "_ZN3hal3rmd16rpm_to_drc_speedEfff" },
+  encoder_symbol{ "encoder_size/static_mc_x/velocity_control",
+                  "rmd_static_mc_x_velocity_control" },
+  encoder_symbol{ "encoder_size/runtime_mc_x/velocity_control",
+                  "_ZN3hal3rmd4mc_x16velocity_controlEf" },
+  encoder_symbol{ "encoder_size/static_mc_x/position_control",
+                  "rmd_static_mc_x_position_control" },
+  encoder_symbol{ "encoder_size/runtime_mc_x/position_control",
+                  "_ZN3hal3rmd4mc_x16position_controlEff" },
+  encoder_symbol{ "encoder_size/runtime_mc_x/rpm_to_mc_x_speed",
+                  "_ZN3hal3rmd17rpm_to_mc_x_speedEff" },
+};
+
+/**
+ * @brief Report the size of each encoder from the symbol table of an ELF file
+ *
+ * Symbols missing from the table, for example in a stripped executable, are
+ * not reported.
+ *
+ * @param p_image - start of the mapped ELF file
+ * @param p_size - size of the mapped ELF file in bytes
+ */
+void report_symbol_sizes(std::byte const* p_image, std::size_t p_size)
+{
+  Elf64_Ehdr header;
+  if (p_size < sizeof(header)) {
+    return;
+  }
+  std::memcpy(&header, p_image, sizeof(header));
+  if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+      header.e_ident[EI_CLASS] != ELFCLASS64 ||
+      header.e_shoff + header.e_shnum * sizeof(Elf64_Shdr) > p_size) {
+    return;
+  }
+
+  auto const section = [&](std::size_t p_index) {
+    Elf64_Shdr section_header;
+    std::memcpy(&section_header,
+                p_image + header.e_shoff + p_index * sizeof(Elf64_Shdr),
+                sizeof(section_header));
+    return section_header;
+  };
+
+  for (std::size_t i = 0; i < header.e_shnum; i++) {
+    auto const symbols = section(i);
+    if (symbols.sh_type != SHT_SYMTAB || symbols.sh_link >= header.e_shnum) {
+      continue;
+    }
+    auto const names = section(symbols.sh_link);
+    auto const* const name_table =
+      reinterpret_cast<char const*>(p_image + names.sh_offset);
+
+    for (std::size_t offset = 0; offset + sizeof(Elf64_Sym) <= symbols.sh_size;
+         offset += sizeof(Elf64_Sym)) {
+      Elf64_Sym symbol;
+      std::memcpy(
+        &symbol, p_image + symbols.sh_offset + offset, sizeof(symbol));
+      if (ELF64_ST_TYPE(symbol.st_info) != STT_FUNC ||
+          symbol.st_name >= names.sh_size) {
+        continue;
+      }
+      std::string_view const name(name_table + symbol.st_name);
+      for (auto const& encoder : encoders) {
+        if (encoder.symbol == name) {
+          benchmark::report(encoder.benchmark,
+                            "text_bytes",
+                            static_cast<double>(symbol.st_size));
+        }
+      }
+    }
+  }
+}
+}  // namespace
+
+void encoder_size_benchmark()
+{
+  int const file = open("/proc/self/exe", O_RDONLY);
+  if (file < 0) {
+    return;
+  }
+
+  struct stat status{};
+  if (fstat(file, &status) == 0 && status.st_size > 0) {
+    auto const size = static_cast<std::size_t>(status.st_size);
+    void* const image = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (image != MAP_FAILED) {
+      report_symbol_sizes(static_cast<std::byte const*>(image), size);
+      munmap(image, size);
+    }
+  }
+
+  close(file);
+}
+}  // namespace hal::rmd
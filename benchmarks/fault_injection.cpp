@@ -0,0 +1,165 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+#include <libhal-rmd/drc.hpp>
+#include <libhal-rmd/fault_injector.hpp>
+#include <libhal-rmd/mc_x.hpp>
+#include <libhal-rmd/simulated_bus.hpp>
+#include <libhal-util/can.hpp>
+#include <libhal/error.hpp>
+
+#include "benchmark.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr can::id_t motor_id = 0x141;
+constexpr can::id_t mc_x_reply_offset = 0x100;
+/// Virtual time each command loop runs for
+constexpr std::uint64_t run_ns = 500'000'000;
+/// Replies held back longer than the adaptive timeout arrive stale
+constexpr auto delay_time = std::chrono::milliseconds(2);
+
+struct profile_t
+{
+  std::string_view name;
+  fault_injector::settings settings;
+};
+
+constexpr std::array profiles{
+  profile_t{ "clean", {} },
+  profile_t{ "loss_1pct", { .loss = 0.01f } },
+  profile_t{ "loss_10pct", { .loss = 0.10f } },
+  profile_t{ "delay_10pct", { .delay = 0.10f, .delay_time = delay_time } },
+  profile_t{ "duplicate_10pct", { .duplicate = 0.10f } },
+  profile_t{ "corrupt_10pct", { .corrupt = 0.10f } },
+  profile_t{ "mixed_2pct",
+             { .loss = 0.02f,
+               .delay = 0.02f,
+               .duplicate = 0.02f,
+               .corrupt = 0.02f,
+               .delay_time = delay_time } },
+};
+
+struct outcome_t
+{
+  std::uint64_t completed = 0;
+  std::uint64_t timeouts = 0;
+  std::uint64_t wasted_ns = 0;
+};
+
+/**
+ * @brief Send feedback requests back to back for a fixed amount of time
+ *
+ * @param p_bus - simulated bus, also the clock of the simulation
+ * @param p_request - function that performs a single blocking request
+ * @return outcome_t - requests that completed or timed out
+ */
+template<class request>
+outcome_t command_loop(simulated_bus& p_bus, request&& p_request)
+{
+  outcome_t outcome;
+  while (p_bus.now() < run_ns) {
+    auto const start = p_bus.now();
+    try {
+      p_request();
+      outcome.completed++;
+    } catch (hal::timed_out const&) {
+      outcome.timeouts++;
+      outcome.wasted_ns += p_bus.now() - start;
+    }
+  }
+  return outcome;
+}
+
+void report_outcome(std::string_view p_driver,
+                    profile_t const& p_profile,
+                    outcome_t const& p_outcome)
+{
+  std::array<char, 96> name{};
+  std::snprintf(name.data(),
+                name.size(),
+                "fault_injection/%.*s_%.*s",
+                static_cast<int>(p_driver.size()),
+                p_driver.data(),
+                static_cast<int>(p_profile.name.size()),
+                p_profile.name.data());
+
+  auto const seconds = static_cast<double>(run_ns) / 1e9;
+  benchmark::report(name.data(),
+                    "completed_per_sec",
+                    static_cast<double>(p_outcome.completed) / seconds);
+  benchmark::report(
+    name.data(), "timeouts", static_cast<double>(p_outcome.timeouts));
+  benchmark::report(name.data(),
+                    "wasted_wait_ms",
+                    static_cast<double>(p_outcome.wasted_ns) / 1e6);
+}
+
+void drc_loop(profile_t const& p_profile, bool p_adaptive)
+{
+  simulated_bus bus;
+  bus.add_device({ .id = motor_id, .reply_id = motor_id });
+  fault_injector injector(bus.host(), bus, p_profile.settings);
+  hal::can_router router(injector);
+  drc motor(router,
+            injector,
+            1.0f,
+            motor_id,
+            std::chrono::milliseconds(10),
+            drc::startup::attach);
+  if (p_adaptive) {
+    motor.adaptive_timeout({});
+  }
+
+  auto const outcome = command_loop(
+    bus, [&motor] { motor.feedback_request(drc::read::status_2); });
+  report_outcome(p_adaptive ? "drc_adaptive" : "drc", p_profile, outcome);
+}
+
+void mc_x_loop(profile_t const& p_profile)
+{
+  simulated_bus bus;
+  bus.add_device(
+    { .id = motor_id, .reply_id = motor_id + mc_x_reply_offset });
+  fault_injector injector(bus.host(), bus, p_profile.settings);
+  hal::can_router router(injector);
+  mc_x motor(router, injector, 1.0f, motor_id);
+
+  auto const outcome = command_loop(
+    bus, [&motor] { motor.feedback_request(mc_x::read::status_2); });
+  report_outcome("mc_x", p_profile, outcome);
+}
+}  // namespace
+
+void fault_injection_benchmark()
+{
+  // Feedback requests on the simulated 1 Mbit/s bus with a 10ms fixed timeout
+  // or an adaptive timeout, faults apply to requests and replies alike.
+  //
+  // The drivers count any reply from the motor as the completion of the
+  // request in flight, so duplicated and late replies complete the following
+  // request early with the data of an older request. This shows up as more
+  // completions per second than the clean profile.
+  for (auto const& profile : profiles) {
+    drc_loop(profile, false);
+    drc_loop(profile, true);
+    mc_x_loop(profile);
+  }
+}
+}  // namespace hal::rmd
@@ -0,0 +1,42 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+namespace hal::rmd {
+extern void stop_latency_benchmark();
+extern void decode_throughput_benchmark();
+extern void driver_microbenchmarks();
+extern void bus_simulation_benchmark();
+extern void fault_injection_benchmark();
+extern void telemetry_log_benchmark();
+#if defined(__linux__)
+extern void command_server_benchmark();
+extern void shared_telemetry_benchmark();
+extern void encoder_size_benchmark();
+#endif
+}  // namespace hal::rmd
+
+int main()
+{
+  hal::rmd::driver_microbenchmarks();
+  hal::rmd::stop_latency_benchmark();
+  hal::rmd::decode_throughput_benchmark();
+  hal::rmd::bus_simulation_benchmark();
+  hal::rmd::fault_injection_benchmark();
+  hal::rmd::telemetry_log_benchmark();
+#if defined(__linux__)
+  hal::rmd::command_server_benchmark();
+  hal::rmd::shared_telemetry_benchmark();
+  hal::rmd::encoder_size_benchmark();
+#endif
+}
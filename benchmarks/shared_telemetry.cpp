@@ -0,0 +1,108 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include <libhal-rmd/linux/shared_telemetry.hpp>
+
+#include "benchmark.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr auto contended_time = std::chrono::milliseconds(200);
+
+struct host_clock : public hal::steady_clock
+{
+private:
+  hal::hertz driver_frequency() override
+  {
+    return 1'000'000'000.0f;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    auto const now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  }
+};
+
+/**
+ * @brief A reader spinning on the slot a writer publishes into as fast as it
+ * can, the worst case for retries.
+ *
+ * @param p_exporter - exporter of the segment
+ * @param p_reader - reader of the same segment
+ */
+void contended(telemetry_exporter& p_exporter, telemetry_reader& p_reader)
+{
+  std::atomic<bool> done = false;
+  std::uint64_t written = 0;
+
+  std::jthread writer([&]() {
+    drc::feedback_t feedback{};
+    while (not done.load(std::memory_order_relaxed)) {
+      feedback.message_number++;
+      p_exporter.publish(0, 0x141, feedback);
+      written++;
+    }
+  });
+
+  std::uint64_t reads = 0;
+  auto const retries_before = p_reader.retries();
+  auto const start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start < contended_time) {
+    benchmark::do_not_optimize(p_reader.read(0));
+    reads++;
+  }
+  done = true;
+  writer.join();
+
+  auto const seconds = std::chrono::duration<double>(contended_time).count();
+  auto const retries = p_reader.retries() - retries_before;
+  benchmark::report("shared_telemetry/contended",
+                    "reads_per_sec",
+                    static_cast<double>(reads) / seconds);
+  benchmark::report("shared_telemetry/contended",
+                    "publishes_per_sec",
+                    static_cast<double>(written) / seconds);
+  benchmark::report("shared_telemetry/contended",
+                    "retries_per_read",
+                    static_cast<double>(retries) / static_cast<double>(reads));
+}
+}  // namespace
+
+void shared_telemetry_benchmark()
+{
+  host_clock clock;
+  auto const name = "/libhal_rmd_benchmark_" + std::to_string(getpid());
+  telemetry_exporter exporter(name, clock);
+  telemetry_reader reader(name);
+  drc::feedback_t feedback{};
+
+  benchmark::measure("shared_telemetry/publish", [&]() {
+    feedback.message_number++;
+    exporter.publish(1, 0x142, feedback);
+  });
+
+  benchmark::measure("shared_telemetry/read",
+                     [&]() { benchmark::do_not_optimize(reader.read(1)); });
+
+  contended(exporter, reader);
+}
+}  // namespace hal::rmd
@@ -0,0 +1,199 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <libhal-rmd/scheduler.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "benchmark.hpp"
+
+namespace hal::rmd {
+namespace {
+/// Each call to uptime() consumes one tick of 1us
+constexpr hal::hertz tick_frequency = 1'000'000.0f;
+/// Time between a request being sent and its response arriving
+constexpr std::uint64_t round_trip_ticks = 250;
+constexpr std::size_t motor_count = 8;
+constexpr can::id_t first_id = 0x141;
+
+/**
+ * @brief A can bus where every motor echos requests back after a fixed delay
+ *
+ * Time only advances when the clock is read, which is what every busy wait in
+ * the drivers does, making the results deterministic.
+ */
+struct echo_bus
+  : public hal::can
+  , public hal::steady_clock
+{
+  std::uint64_t now = 0;
+  /// Tick at which the first stop command was sent, 0 if not sent yet
+  std::uint64_t stop_sent_at = 0;
+  std::deque<std::pair<std::uint64_t, message_t>> in_flight;
+  hal::callback<handler> receive = [](message_t const&) {};
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  void driver_bus_on() override
+  {
+  }
+
+  void driver_send(message_t const& p_message) override
+  {
+    if (p_message.payload[0] == hal::value(drc::system::stop) &&
+        stop_sent_at == 0) {
+      stop_sent_at = now;
+    }
+    in_flight.emplace_back(now + round_trip_ticks, p_message);
+  }
+
+  void driver_on_receive(hal::callback<handler> p_handler) override
+  {
+    receive = p_handler;
+  }
+
+  hal::hertz driver_frequency() override
+  {
+    return tick_frequency;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    now++;
+    while (not in_flight.empty() && in_flight.front().first <= now) {
+      auto const response = in_flight.front().second;
+      in_flight.pop_front();
+      receive(response);
+    }
+    return now;
+  }
+};
+
+struct rig
+{
+  rig()
+  {
+    router = std::make_unique<hal::can_router>(bus);
+    for (std::size_t i = 0; i < motor_count; i++) {
+      motors.push_back(
+        std::make_unique<drc>(*router,
+                              bus,
+                              1.0f,
+                              static_cast<can::id_t>(first_id + i),
+                              std::chrono::milliseconds(10),
+                              drc::startup::attach));
+    }
+  }
+
+  echo_bus bus;
+  std::unique_ptr<hal::can_router> router;
+  std::vector<std::unique_ptr<drc>> motors;
+};
+
+/**
+ * @brief Blocking telemetry loop that checks for a stop request between calls
+ *
+ * @param p_request_at - tick at which the stop is requested
+ * @return std::uint64_t - ticks between the stop request and the stop frame
+ */
+std::uint64_t blocking_stop_latency(std::uint64_t p_request_at)
+{
+  rig setup;
+  auto& bus = setup.bus;
+
+  while (true) {
+    for (auto& motor : setup.motors) {
+      if (p_request_at <= bus.now) {
+        setup.motors[0]->system_control(drc::system::stop);
+        return bus.stop_sent_at - p_request_at;
+      }
+      motor->feedback_request(drc::read::status_2);
+    }
+  }
+}
+
+/**
+ * @brief Scheduler kept saturated with telemetry while a stop is requested
+ *
+ * @param p_request_at - tick at which the stop is requested
+ * @return std::uint64_t - ticks between the stop request and the stop frame
+ */
+std::uint64_t scheduled_stop_latency(std::uint64_t p_request_at)
+{
+  rig setup;
+  auto& bus = setup.bus;
+  scheduler bus_scheduler(bus);
+  std::array<hal::byte, 8> const status_2{ hal::value(drc::read::status_2) };
+  std::array<hal::byte, 8> const stop{ hal::value(drc::system::stop) };
+  std::size_t next_motor = 0;
+  bool stop_submitted = false;
+
+  while (bus.stop_sent_at == 0) {
+    // Keep the telemetry queue full to simulate a saturated bus
+    while (bus_scheduler.submit(setup.motors[next_motor].get(), status_2)) {
+      next_motor = (next_motor + 1) % motor_count;
+    }
+
+    if (not stop_submitted && p_request_at <= bus.now) {
+      bus_scheduler.submit(setup.motors[0].get(), stop);
+      stop_submitted = true;
+    }
+
+    bus_scheduler.service();
+  }
+
+  return bus.stop_sent_at - p_request_at;
+}
+
+void report(std::string_view p_name,
+            std::vector<std::uint64_t> const& p_samples)
+{
+  auto const [min, max] = std::ranges::minmax(p_samples);
+  std::uint64_t sum = 0;
+  for (auto const sample : p_samples) {
+    sum += sample;
+  }
+  auto const mean = static_cast<double>(sum) / p_samples.size();
+
+  benchmark::report(p_name, "worst_us", static_cast<double>(max));
+  benchmark::report(p_name, "mean_us", mean);
+  benchmark::report(p_name, "best_us", static_cast<double>(min));
+}
+}  // namespace
+
+void stop_latency_benchmark()
+{
+  std::vector<std::uint64_t> blocking;
+  std::vector<std::uint64_t> scheduled;
+
+  // Sweep the stop request across two full telemetry sweeps of the bus
+  constexpr std::uint64_t sweep = 2 * motor_count * round_trip_ticks;
+  for (std::uint64_t request_at = 1; request_at < sweep; request_at += 7) {
+    blocking.push_back(blocking_stop_latency(request_at));
+    scheduled.push_back(scheduled_stop_latency(request_at));
+  }
+
+  // 8 motors with a 250us round trip and saturated telemetry
+  report("stop_latency/blocking_loop", blocking);
+  report("stop_latency/scheduler", scheduled);
+}
+}  // namespace hal::rmd
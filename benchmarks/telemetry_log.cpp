@@ -0,0 +1,168 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include <libhal-rmd/telemetry_log.hpp>
+
+#include "benchmark.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr std::size_t motor_count = 16;
+/// One second of feedback at 1 kHz from every motor
+constexpr std::size_t samples_per_motor = 1000;
+/// Logging clock of 1 MHz
+constexpr std::uint64_t period_ticks = 1000;
+
+/// What a raw dump stores for each sample
+struct raw_record
+{
+  std::uint64_t timestamp;
+  can::id_t device_id;
+  drc::feedback_t feedback;
+};
+
+/**
+ * @brief Feedback of motors following smooth trajectories with sensor noise
+ *
+ * @return std::vector<telemetry_sample> - samples interleaved by motor
+ */
+std::vector<telemetry_sample> workload()
+{
+  std::vector<telemetry_sample> samples;
+  samples.reserve(motor_count * samples_per_motor);
+  std::array<telemetry_sample, motor_count> state{};
+  std::uint32_t noise = 1;
+  auto const next_noise = [&noise]() {
+    noise = noise * 1'664'525 + 1'013'904'223;
+    return static_cast<std::int16_t>((noise >> 16) % 5) - 2;
+  };
+
+  for (std::size_t i = 0; i < samples_per_motor; i++) {
+    for (std::size_t m = 0; m < motor_count; m++) {
+      auto& motor = state[m];
+      auto const phase =
+        static_cast<float>(i) / 200.0f + static_cast<float>(m);
+      motor.timestamp = i * period_ticks + m * 3;
+      motor.device_id = static_cast<can::id_t>(0x141 + m);
+      motor.message_number++;
+      motor.raw_speed = static_cast<std::int16_t>(600.0f * std::sin(phase));
+      motor.raw_multi_turn_angle += motor.raw_speed;
+      motor.encoder = static_cast<std::int16_t>(motor.raw_multi_turn_angle);
+      motor.raw_current =
+        static_cast<std::int16_t>(motor.raw_speed / 4 + next_noise());
+      motor.raw_volts = static_cast<std::int16_t>(480 + (i % 100 == 0));
+      motor.raw_motor_temperature = static_cast<std::int8_t>(35 + i / 400);
+      samples.push_back(motor);
+    }
+  }
+  return samples;
+}
+
+raw_record to_raw(telemetry_sample const& p_sample)
+{
+  raw_record record{ .timestamp = p_sample.timestamp,
+                     .device_id = p_sample.device_id,
+                     .feedback = {} };
+  record.feedback.message_number = p_sample.message_number;
+  record.feedback.raw_multi_turn_angle = p_sample.raw_multi_turn_angle;
+  record.feedback.raw_current = p_sample.raw_current;
+  record.feedback.raw_speed = p_sample.raw_speed;
+  record.feedback.raw_volts = p_sample.raw_volts;
+  record.feedback.encoder = p_sample.encoder;
+  record.feedback.raw_motor_temperature = p_sample.raw_motor_temperature;
+  return record;
+}
+}  // namespace
+
+void telemetry_log_benchmark()
+{
+  auto const samples = workload();
+  std::vector<hal::byte> log;
+  log.reserve(samples.size() * telemetry_log_writer::max_record_size);
+
+  // Size of one second of logging against a raw dump of the structs
+  {
+    telemetry_log_writer writer([&log](std::span<hal::byte const> p_chunk) {
+      log.insert(log.end(), p_chunk.begin(), p_chunk.end());
+    });
+    for (auto const& sample : samples) {
+      writer.write(sample);
+    }
+  }
+  auto const count = static_cast<double>(samples.size());
+  auto const raw_bytes = count * sizeof(raw_record);
+  auto const log_bytes = static_cast<double>(log.size());
+  benchmark::report(
+    "telemetry_log/size", "raw_bytes_per_sample", raw_bytes / count);
+  benchmark::report(
+    "telemetry_log/size", "log_bytes_per_sample", log_bytes / count);
+  benchmark::report(
+    "telemetry_log/size", "compression_ratio", raw_bytes / log_bytes);
+  // 16 motors at 1 kHz
+  benchmark::report("telemetry_log/size",
+                    "log_mib_per_hour",
+                    log_bytes * 3600.0 / (1024.0 * 1024.0));
+  benchmark::report("telemetry_log/size",
+                    "raw_mib_per_hour",
+                    raw_bytes * 3600.0 / (1024.0 * 1024.0));
+
+  // Encode cost, the sink overwrites a fixed buffer like a ring buffer would
+  {
+    std::array<hal::byte, 4096> sink_buffer{};
+    std::size_t sink_offset = 0;
+    auto const sink = [&](std::span<hal::byte const> p_chunk) {
+      if (sink_buffer.size() < sink_offset + p_chunk.size()) {
+        sink_offset = 0;
+      }
+      std::memcpy(
+        sink_buffer.data() + sink_offset, p_chunk.data(), p_chunk.size());
+      sink_offset += p_chunk.size();
+    };
+
+    telemetry_log_writer writer(sink);
+    std::size_t next = 0;
+    benchmark::measure("telemetry_log/encode", [&]() {
+      writer.write(samples[next]);
+      next = (next + 1) % samples.size();
+    });
+
+    next = 0;
+    benchmark::measure("telemetry_log/raw_dump", [&]() {
+      auto const record = to_raw(samples[next]);
+      auto const* bytes = reinterpret_cast<hal::byte const*>(&record);
+      sink(std::span(bytes, sizeof(record)));
+      next = (next + 1) % samples.size();
+    });
+  }
+
+  // Decode cost, restarting at the beginning of the log at its end
+  {
+    std::optional<telemetry_log_reader> reader(log);
+    benchmark::measure("telemetry_log/decode", [&]() {
+      auto sample = reader->next();
+      if (not sample) {
+        reader.emplace(log);
+        sample = reader->next();
+      }
+      benchmark::do_not_optimize(*sample);
+    });
+  }
+}
+}  // namespace hal::rmd
@@ -37,3 +37,6 @@ class libhal_rmd_conan(ConanFile):
     def package_info(self):
         self.cpp_info.libs = ["libhal-rmd"]
         self.cpp_info.set_property("cmake_target_name", "libhal::rmd")
+        # command_server and shared_telemetry use threads and shm_open()
+        if self.settings.os == "Linux":
+            self.cpp_info.system_libs = ["pthread", "rt"]
@@ -0,0 +1,289 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include <libhal/units.hpp>
+
+#include "drc.hpp"
+#include "mc_x.hpp"
+#include "motor.hpp"
+
+namespace hal::rmd {
+/**
+ * @brief A driver with the motion and feedback operations common to all RMD
+ * motors
+ *
+ * Satisfied by drc, mc_x and the compile-time configured motor template.
+ * Generic fleet code constrained on this concept is instantiated per motor
+ * type, so every call is resolved at compile time.
+ */
+template<class driver>
+concept motor_driver =
+  requires(driver& p_driver, rpm p_speed, degrees p_angle) {
+    p_driver.velocity_control(p_speed);
+    p_driver.position_control(p_angle, p_speed);
+    p_driver.incremental_position_control(p_angle, p_speed);
+    p_driver.feedback_request(driver::read::status_2);
+    p_driver.system_control(driver::system::stop);
+    p_driver.feedback();
+  };
+
+/**
+ * @brief Model independent view of the feedback of a motor
+ *
+ * The values are decoded with the units of the motor's model, so feedback of
+ * drc and mc_x motors can be compared directly.
+ */
+struct motor_feedback
+{
+  enum class model_t : std::uint8_t
+  {
+    drc,
+    mc_x,
+  };
+
+  /// Model of the motor that produced the feedback
+  model_t model = model_t::drc;
+  /// Number of responses received from the motor
+  std::uint32_t message_number = 0;
+  /// Multi-turn angle of the rotor
+  hal::degrees angle = 0.0f;
+  /// Speed of the rotor
+  hal::rpm speed = 0.0f;
+  hal::ampere current = 0.0f;
+  hal::volts volts = 0.0f;
+  hal::celsius temperature = 0.0f;
+  /// Signed 16-bit raw encoder count value of the motor
+  std::int16_t encoder = 0;
+  /// Error flags of the motor, the bit layout is specific to its model
+  std::uint16_t raw_error_state = 0;
+
+  /// True if the motor reports any error flag
+  bool faulted() const noexcept
+  {
+    return raw_error_state != 0;
+  }
+};
+
+/**
+ * @brief Decode the feedback of a drc or mc_x motor into the common view
+ *
+ * @param p_feedback - feedback of the motor
+ * @return motor_feedback - the model independent view
+ */
+template<class feedback_type>
+motor_feedback make_motor_feedback(feedback_type const& p_feedback)
+{
+  constexpr auto model = std::is_same_v<feedback_type, drc::feedback_t>
+                           ? motor_feedback::model_t::drc
+                           : motor_feedback::model_t::mc_x;
+  return {
+    .model = model,
+    .message_number = p_feedback.message_number,
+    .angle = p_feedback.angle(),
+    .speed = p_feedback.speed(),
+    .current = p_feedback.current(),
+    .volts = p_feedback.volts(),
+    .temperature = p_feedback.temperature(),
+    .encoder = p_feedback.encoder,
+    .raw_error_state = static_cast<std::uint16_t>(p_feedback.raw_error_state),
+  };
+}
+
+/**
+ * @brief Non-owning handle to a drc or mc_x motor with static dispatch
+ *
+ * Holds a `std::variant` of driver pointers, the same representation as
+ * `scheduler::motor_t`. Each operation is a `std::visit` that resolves to a
+ * direct call on the concrete driver, so a mixed fleet can be stored in a
+ * plain array and driven without the virtual calls and extra feedback round
+ * trips of the `hal::motor` and `hal::servo` adaptors.
+ *
+ * The handle must not outlive the driver it refers to.
+ */
+class any_motor
+{
+public:
+  using variant_t = std::variant<drc*, mc_x*>;
+
+  any_motor(drc& p_drc)  // NOLINT(google-explicit-constructor)
+    : m_driver(&p_drc)
+  {
+  }
+
+  any_motor(mc_x& p_mc_x)  // NOLINT(google-explicit-constructor)
+    : m_driver(&p_mc_x)
+  {
+  }
+
+  /**
+   * @brief Refer to the runtime driver of a compile-time configured motor
+   *
+   * Commands go through the runtime driver's encoders.
+   *
+   * @param p_motor - motor to refer to
+   */
+  template<class driver, std::uint32_t gear, can::id_t device>
+  any_motor(motor<driver, gear, device>& p_motor)  // NOLINT
+    : m_driver(&p_motor.runtime())
+  {
+  }
+
+  /**
+   * @brief Rotate the motor shaft at the designated speed
+   *
+   * @param p_speed - speed of the output shaft
+   * @throws hal::timed_out - if the motor does not respond in time
+   */
+  void velocity_control(rpm p_speed)
+  {
+    std::visit(
+      [p_speed](auto* p_driver) { p_driver->velocity_control(p_speed); },
+      m_driver);
+  }
+
+  /**
+   * @brief Move the motor shaft to a specific angle
+   *
+   * @param p_angle - angle of the output shaft
+   * @param p_speed - maximum speed of the output shaft while moving
+   * @throws hal::timed_out - if the motor does not respond in time
+   */
+  void position_control(degrees p_angle, rpm p_speed)
+  {
+    std::visit(
+      [p_angle, p_speed](auto* p_driver) {
+        p_driver->position_control(p_angle, p_speed);
+      },
+      m_driver);
+  }
+
+  /**
+   * @brief Move the motor shaft by an angle from its current position
+   *
+   * @param p_angle - angle to move the output shaft by
+   * @param p_speed - maximum speed of the output shaft while moving
+   * @throws hal::timed_out - if the motor does not respond in time
+   */
+  void incremental_position_control(degrees p_angle, rpm p_speed)
+  {
+    std::visit(
+      [p_angle, p_speed](auto* p_driver) {
+        p_driver->incremental_position_control(p_angle, p_speed);
+      },
+      m_driver);
+  }
+
+  /**
+   * @brief Request the speed, current, temperature and encoder of the motor
+   *
+   * @throws hal::timed_out - if the motor does not respond in time
+   */
+  void refresh()
+  {
+    std::visit(
+      [](auto* p_driver) {
+        using driver = std::remove_pointer_t<decltype(p_driver)>;
+        p_driver->feedback_request(driver::read::status_2);
+      },
+      m_driver);
+  }
+
+  /**
+   * @brief Request the multi-turn angle of the motor
+   *
+   * @throws hal::timed_out - if the motor does not respond in time
+   */
+  void refresh_angle()
+  {
+    std::visit(
+      [](auto* p_driver) {
+        using driver = std::remove_pointer_t<decltype(p_driver)>;
+        p_driver->feedback_request(driver::read::multi_turns_angle);
+      },
+      m_driver);
+  }
+
+  /**
+   * @brief Stop the motor, holding its position
+   *
+   * @throws hal::timed_out - if the motor does not respond in time
+   */
+  void stop()
+  {
+    std::visit(
+      [](auto* p_driver) {
+        using driver = std::remove_pointer_t<decltype(p_driver)>;
+        p_driver->system_control(driver::system::stop);
+      },
+      m_driver);
+  }
+
+  /**
+   * @brief Get the latest feedback of the motor
+   *
+   * @return motor_feedback - the feedback decoded with the units of the model
+   */
+  motor_feedback feedback() const
+  {
+    return std::visit(
+      [](auto* p_driver) { return make_motor_feedback(p_driver->feedback()); },
+      m_driver);
+  }
+
+  /**
+   * @brief Number of responses received from the motor
+   *
+   * Cheaper than `feedback()` when only checking for a new response.
+   *
+   * @return std::uint32_t - the message number of the motor's feedback
+   */
+  std::uint32_t message_number() const
+  {
+    return std::visit(
+      [](auto* p_driver) { return p_driver->feedback().message_number; },
+      m_driver);
+  }
+
+  /**
+   * @brief Call a function with the concrete driver
+   *
+   * @param p_visitor - callable accepting `drc*` and `mc_x*`
+   * @return decltype(auto) - the result of the visitor
+   */
+  template<class visitor>
+  decltype(auto) visit(visitor&& p_visitor) const
+  {
+    return std::visit(std::forward<visitor>(p_visitor), m_driver);
+  }
+
+  /**
+   * @return variant_t - the driver, usable wherever `scheduler::motor_t` is
+   */
+  variant_t driver() const
+  {
+    return m_driver;
+  }
+
+private:
+  variant_t m_driver;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,142 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <libhal/can.hpp>
+#include <libhal/units.hpp>
+
+namespace hal::rmd {
+/**
+ * @brief Computes the bus load of a schedule of RMD commands
+ *
+ * Each stream describes a command sent to a motor at a fixed rate along with
+ * the replies it produces. The bus time of each frame is computed from the
+ * CAN bit timing of its ID format and payload length, including worst case bit
+ * stuffing by default. Streams that would push the bus utilization above the
+ * configured limit are rejected, and the rate each stream can achieve when
+ * the bus is shared fairly is reported.
+ *
+ * A standard ID frame with 8 data bytes is 111 bits plus up to 24 stuff bits,
+ * so a command and its reply cost about 0.27 ms at 1 Mbit/s.
+ */
+class bus_planner
+{
+public:
+  struct settings
+  {
+    /// Bit rate of the bus. Zero uses the operating baudrate of RMD motors.
+    hal::hertz baudrate = 0.0f;
+    /// Highest fraction of the bus time the schedule may use, within
+    /// (0.0f, 1.0f]. Leave headroom for retransmissions and unplanned
+    /// traffic.
+    float utilization_limit = 0.7f;
+    /// Account for the worst case number of stuff bits in each frame
+    bool worst_case_stuffing = true;
+  };
+
+  /// A command sent periodically and the replies it produces
+  struct stream_t
+  {
+    /// CAN ID the command is sent to
+    can::id_t id = 0;
+    /// Number of times per second the command is sent
+    hal::hertz rate = 0.0f;
+    /// Payload length of the command and its replies
+    std::uint8_t length = 8;
+    /// Number of replies each command produces. A broadcast to many motors
+    /// produces one reply per motor.
+    std::uint8_t replies = 1;
+    /// Use 29-bit extended IDs
+    bool extended = false;
+  };
+
+  /// Most streams that can be planned
+  static constexpr std::size_t max_streams = 64;
+
+  /**
+   * @brief Compute the number of bits a frame occupies on the bus
+   *
+   * Includes the interframe space.
+   *
+   * @param p_length - payload length, at most 8
+   * @param p_extended - frame uses a 29-bit extended ID
+   * @param p_worst_case_stuffing - include the most stuff bits the frame could
+   * need
+   * @return std::uint32_t - number of bit times the frame occupies
+   */
+  static std::uint32_t frame_bits(std::uint8_t p_length,
+                                  bool p_extended,
+                                  bool p_worst_case_stuffing);
+
+  /**
+   * @brief Construct a new bus planner
+   *
+   * @param p_settings - bus parameters and utilization limit
+   */
+  bus_planner(settings const& p_settings);
+
+  /**
+   * @brief Add a stream to the plan if the bus has room for it
+   *
+   * @param p_stream - stream to add
+   * @return true - the stream was added
+   * @return false - adding the stream would exceed the utilization limit or
+   * the plan is full, the stream was not added.
+   */
+  bool admit(stream_t const& p_stream);
+
+  /**
+   * @param p_stream - a stream that may or may not be planned
+   * @return float - fraction of the bus time the stream uses
+   */
+  float utilization(stream_t const& p_stream) const;
+
+  /**
+   * @return float - fraction of the bus time used by the planned streams
+   */
+  float utilization() const;
+
+  /**
+   * @brief Rate a stream can achieve when the bus is saturated
+   *
+   * If every stream scaled its rate up by the same factor until the
+   * utilization limit was reached, this is the rate this stream would reach.
+   *
+   * @param p_index - index of the stream in the order it was admitted
+   * @return hal::hertz - achievable rate of the stream
+   */
+  hal::hertz achievable_rate(std::size_t p_index) const;
+
+  /**
+   * @return std::size_t - number of planned streams
+   */
+  std::size_t size() const;
+
+  /**
+   * @param p_index - index of the stream in the order it was admitted
+   * @return stream_t const& - the planned stream
+   */
+  stream_t const& operator[](std::size_t p_index) const;
+
+private:
+  settings m_settings;
+  std::array<stream_t, max_streams> m_streams{};
+  std::size_t m_count = 0;
+  float m_utilization = 0.0f;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,294 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <libhal/can.hpp>
+#include <libhal/functional.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
+
+namespace hal::rmd {
+/**
+ * Compact binary CAN trace format
+ *
+ * A trace starts with a header:
+ *
+ *    | "RMDT" (4 bytes) | version (1 byte) | clock frequency (float, 4 bytes) |
+ *
+ * Followed by a sequence of records:
+ *
+ *    | timestamp delta (varint) | flags (1 byte) | id (2 or 4 bytes) |
+ *    | payload (length bytes) |
+ *
+ * - The timestamp delta is the number of clock ticks since the previous record
+ *   (or since zero for the first record) encoded as an unsigned LEB128 varint.
+ * - flags bit 0 is the direction (0 = transmitted, 1 = received), bit 1 is
+ *   set for remote requests, bit 2 is set for extended IDs, and bits 4 to 7
+ *   hold the payload length.
+ * - The ID is 2 bytes for standard IDs and 4 bytes for extended IDs, both
+ *   little endian.
+ *
+ * Multi-byte values are little endian.
+ */
+
+/// Version of the trace format produced by this library
+inline constexpr hal::byte trace_version = 1;
+/// Number of bytes in a trace header
+inline constexpr std::size_t trace_header_size = 9;
+/// Largest number of bytes a single encoded trace record can occupy
+inline constexpr std::size_t max_trace_record_size = 10 + 1 + 4 + 8;
+
+/// Direction of a traced frame relative to the host
+enum class trace_direction : hal::byte
+{
+  transmit = 0,
+  receive = 1,
+};
+
+/// A single frame captured in a trace
+struct trace_record
+{
+  /// Uptime of the recording clock in ticks when the frame was captured
+  std::uint64_t timestamp = 0;
+  /// Whether the frame was sent or received by the host
+  trace_direction direction = trace_direction::transmit;
+  /// The frame itself
+  can::message_t message{};
+};
+
+/**
+ * @brief Encode a trace header
+ *
+ * @param p_frequency - frequency of the clock used to timestamp records
+ * @return std::array<hal::byte, trace_header_size> - encoded header
+ */
+std::array<hal::byte, trace_header_size> encode_trace_header(
+  hal::hertz p_frequency);
+
+/**
+ * @brief Encode a trace record
+ *
+ * @param p_record - record to encode
+ * @param p_previous_timestamp - timestamp of the previously encoded record, 0
+ * for the first record.
+ * @param p_buffer - buffer of at least max_trace_record_size bytes
+ * @return std::span<hal::byte> - portion of p_buffer holding the record
+ * @throws hal::argument_out_of_domain - if p_buffer is too small
+ */
+std::span<hal::byte> encode_trace_record(trace_record const& p_record,
+                                         std::uint64_t p_previous_timestamp,
+                                         std::span<hal::byte> p_buffer);
+
+/**
+ * @brief Format a trace record as a line of candump log text
+ *
+ * Produces lines like `(0000000001.000250) can0 141#9C00000000000000\n` which
+ * can be consumed by can-utils such as canplayer and by the host tools.
+ *
+ * @param p_record - record to format
+ * @param p_frequency - frequency of the clock used to timestamp the record
+ * @param p_buffer - buffer of at least 64 bytes to hold the text
+ * @param p_interface - name of the interface to place in the line
+ * @return std::string_view - the formatted line within p_buffer
+ * @throws hal::argument_out_of_domain - if p_buffer is too small or
+ * p_frequency is below 1Hz
+ */
+std::string_view format_candump(trace_record const& p_record,
+                                hal::hertz p_frequency,
+                                std::span<char> p_buffer,
+                                std::string_view p_interface = "can0");
+
+/**
+ * @brief Parse a line of candump log text
+ *
+ * Accepts lines in the format produced by `candump -l` and `format_candump()`,
+ * such as `(1700000000.000250) can0 141#9C00000000000000`. The timestamp is
+ * returned in microseconds, ticks of a 1 MHz clock. candump logs do not record
+ * the direction of a frame, so every record is marked as received.
+ *
+ * @param p_line - a single line with or without its line ending
+ * @return std::optional<trace_record> - the frame, or std::nullopt if the line
+ * is not a classic CAN frame in candump log format.
+ */
+std::optional<trace_record> parse_candump(std::string_view p_line);
+
+/**
+ * @brief Iterates over the records of an encoded trace
+ *
+ */
+class can_trace_reader
+{
+public:
+  /**
+   * @brief Construct a new trace reader
+   *
+   * @param p_trace - encoded trace including its header. The memory must
+   * outlive this object.
+   * @throws hal::argument_out_of_domain - if the header is missing, has the
+   * wrong magic, or an unsupported version.
+   */
+  can_trace_reader(std::span<hal::byte const> p_trace);
+
+  /**
+   * @brief Decode the next record in the trace
+   *
+   * @return std::optional<trace_record> - the next record or std::nullopt if
+   * the end of the trace (or a truncated record) has been reached.
+   */
+  std::optional<trace_record> next();
+
+  /**
+   * @brief Restart iteration from the first record
+   *
+   */
+  void rewind();
+
+  /**
+   * @return hal::hertz - frequency of the clock used to record the trace
+   */
+  hal::hertz frequency() const;
+
+private:
+  std::span<hal::byte const> m_trace;
+  std::size_t m_offset = trace_header_size;
+  std::uint64_t m_timestamp = 0;
+  hal::hertz m_frequency = 0.0f;
+};
+
+/**
+ * @brief hal::can decorator that records every frame passing through it
+ *
+ * Sent and received frames are timestamped, encoded with the compact trace
+ * format and passed to a sink. The header is passed to the sink on
+ * construction. The sink should be quick, such as copying into a ring buffer
+ * or writing to a file on a host.
+ *
+ * Each record is delta encoded against the previous one, so recording is not
+ * reentrant. `send()` and the receive handler of the wrapped can driver must
+ * run in the same context. Do not wrap a driver whose receive handler runs in
+ * an interrupt unless sends are also made with that interrupt masked.
+ */
+class can_trace_recorder : public hal::can
+{
+public:
+  /// Receives each encoded chunk of the trace
+  using sink_t = hal::callback<void(std::span<hal::byte const>)>;
+
+  /**
+   * @brief Construct a new can trace recorder
+   *
+   * @param p_can - can bus to record. Its lifetime must exceed this object.
+   * @param p_clock - clock used to timestamp frames
+   * @param p_sink - destination for the encoded trace
+   */
+  can_trace_recorder(hal::can& p_can,
+                     hal::steady_clock& p_clock,
+                     sink_t p_sink);
+
+  /**
+   * @return std::uint32_t - number of frames recorded so far
+   */
+  std::uint32_t frames() const;
+
+private:
+  void driver_configure(settings const& p_settings) override;
+  void driver_bus_on() override;
+  void driver_send(message_t const& p_message) override;
+  void driver_on_receive(hal::callback<handler> p_handler) override;
+  void record(trace_direction p_direction, message_t const& p_message);
+
+  hal::can* m_can;
+  hal::steady_clock* m_clock;
+  sink_t m_sink;
+  hal::callback<handler> m_handler = [](message_t const&) {};
+  std::uint64_t m_previous_timestamp = 0;
+  std::uint32_t m_frames = 0;
+};
+
+/**
+ * @brief hal::can implementation that plays back the received frames of a
+ * recorded trace
+ *
+ * Use this as the bus of a can router to feed a recorded session back into
+ * drc and mc_x drivers. Frames sent through this can are discarded, and
+ * transmitted records in the trace are skipped during playback.
+ */
+class can_trace_replay : public hal::can
+{
+public:
+  /**
+   * @brief Construct a new can trace replay
+   *
+   * @param p_trace - encoded trace including its header. The memory must
+   * outlive this object.
+   * @throws hal::argument_out_of_domain - if the trace header is invalid
+   */
+  can_trace_replay(std::span<hal::byte const> p_trace);
+
+  /**
+   * @brief Deliver the next received frame to the receive handler
+   *
+   * @return true - a frame was delivered
+   * @return false - the end of the trace has been reached
+   */
+  bool step();
+
+  /**
+   * @brief Deliver every remaining received frame as fast as possible
+   *
+   * @return std::size_t - number of frames delivered
+   */
+  std::size_t replay_all();
+
+  /**
+   * @brief Deliver every remaining received frame with its original timing
+   *
+   * Frames are delivered when the elapsed time on p_clock matches the elapsed
+   * time between the frame and the first delivered frame of the trace.
+   *
+   * @param p_clock - clock used to pace the playback
+   * @return std::size_t - number of frames delivered
+   */
+  std::size_t replay_realtime(hal::steady_clock& p_clock);
+
+  /**
+   * @brief Restart playback from the beginning of the trace
+   *
+   */
+  void rewind();
+
+  /**
+   * @return std::uint32_t - number of frames sent to this can
+   */
+  std::uint32_t frames_sent() const;
+
+private:
+  void driver_configure(settings const& p_settings) override;
+  void driver_bus_on() override;
+  void driver_send(message_t const& p_message) override;
+  void driver_on_receive(hal::callback<handler> p_handler) override;
+  std::optional<trace_record> next_received();
+
+  can_trace_reader m_reader;
+  hal::callback<handler> m_handler = [](message_t const&) {};
+  std::uint32_t m_frames_sent = 0;
+};
+}  // namespace hal::rmd
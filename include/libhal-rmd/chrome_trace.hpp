@@ -0,0 +1,109 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include <libhal/functional.hpp>
+#include <libhal/units.hpp>
+
+#include "trace.hpp"
+
+namespace hal::rmd {
+/**
+ * @brief Writes trace events as Chrome trace event JSON
+ *
+ * The output can be opened with chrome://tracing or https://ui.perfetto.dev.
+ * Each motor gets its own track (thread ID = CAN ID). Every request appears as
+ * a slice that starts when the frame is sent and ends when the reply is
+ * decoded or the request times out, making round trip times and bus gaps
+ * visible across a multi-motor session.
+ *
+ * Usage with the link time trace hook:
+ *
+ *    hal::rmd::chrome_trace_writer writer(clock.frequency(), file_sink);
+ *
+ *    void hal::rmd::trace(trace_event p_event, can::id_t p_id,
+ *                         hal::byte p_command, std::uint64_t p_time) noexcept
+ *    {
+ *      writer(p_event, p_id, p_command, p_time);
+ *    }
+ */
+class chrome_trace_writer
+{
+public:
+  /// Receives each chunk of JSON text
+  using sink_t = hal::callback<void(std::span<char const>)>;
+
+  /**
+   * @brief Construct a new chrome trace writer
+   *
+   * The opening of the JSON document is written to the sink immediately.
+   *
+   * @param p_frequency - frequency of the clock used to timestamp events
+   * @param p_sink - destination for the JSON text
+   * @throws hal::argument_out_of_domain - if p_frequency is below 1Hz
+   */
+  chrome_trace_writer(hal::hertz p_frequency, sink_t p_sink);
+
+  chrome_trace_writer(chrome_trace_writer&) = delete;
+  chrome_trace_writer& operator=(chrome_trace_writer&) = delete;
+
+  /**
+   * @brief Write the closing of the JSON document
+   *
+   * Calls finish() if it has not already been called.
+   */
+  ~chrome_trace_writer();
+
+  /**
+   * @brief Write a trace event
+   *
+   * @param p_event - the event that occurred
+   * @param p_device_id - CAN ID of the motor the event is associated with
+   * @param p_command - command byte of the frame associated with the event
+   * @param p_timestamp - uptime of the clock in ticks
+   */
+  void operator()(trace_event p_event,
+                  can::id_t p_device_id,
+                  hal::byte p_command,
+                  std::uint64_t p_timestamp);
+
+  /**
+   * @brief Write the closing of the JSON document
+   *
+   * No events can be written after this is called.
+   */
+  void finish();
+
+  /**
+   * @return std::uint32_t - number of events written
+   */
+  std::uint32_t events() const;
+
+private:
+  void write(char const* p_phase,
+             char const* p_name,
+             can::id_t p_device_id,
+             hal::byte p_command,
+             std::uint64_t p_timestamp);
+
+  sink_t m_sink;
+  std::uint64_t m_frequency = 1;
+  std::uint32_t m_events = 0;
+  bool m_finished = false;
+};
+}  // namespace hal::rmd
@@ -14,7 +14,10 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <optional>
+#include <span>
 
 #include <libhal-canrouter/can_router.hpp>
 #include <libhal/angular_velocity_sensor.hpp>
@@ -26,6 +29,12 @@
 #include <libhal/temperature_sensor.hpp>
 #include <libhal/units.hpp>
 
+#include "motion_estimator.hpp"
+#include "multi_turn_tracker.hpp"
+#include "rtt_estimator.hpp"
+#include "stall_detector.hpp"
+#include "stop_report.hpp"
+
 namespace hal::rmd {
 /**
  * @brief Driver for RMD motors equip with the DRC motor drivers
@@ -37,6 +46,22 @@ public:
   /// Commands that can be issued to a RMD-X motor
   enum class read : hal::byte
   {
+    /**
+     * @brief PID gains read request command
+     *
+     * Sending this request will update the following fields in the feedback_t:
+     *
+     *    - pid
+     */
+    pid = 0x30,
+    /**
+     * @brief Acceleration read request command
+     *
+     * Sending this request will update the following fields in the feedback_t:
+     *
+     *    - raw_acceleration
+     */
+    acceleration = 0x33,
     /**
      * @brief Status1 + error flag information read request command
      *
@@ -73,6 +98,7 @@ public:
   {
     speed = 0xA2,
     position_2 = 0xA4,
+    incremental_position = 0xA8,
   };
 
   /// Commands for updating motor configuration data
@@ -94,6 +120,54 @@ public:
     running = 0x88,
   };
 
+  /// Determines what the driver does with the motor when it is constructed
+  enum class startup : hal::byte
+  {
+    /// Power cycle the motor by sending system::off followed by
+    /// system::running. This costs two round trips and will interrupt any
+    /// motion in progress.
+    power_cycle,
+    /// Attach to a motor that is already running. Nothing is sent to the motor
+    /// on construction. Use `drc::verify_alive()` to confirm that the motor is
+    /// present.
+    attach,
+  };
+
+  /// Gains of the motor's position, speed and current control loops
+  struct pid_gains
+  {
+    hal::byte angle_kp = 0;
+    hal::byte angle_ki = 0;
+    hal::byte speed_kp = 0;
+    hal::byte speed_ki = 0;
+    hal::byte current_kp = 0;
+    hal::byte current_ki = 0;
+
+    bool operator==(pid_gains const&) const = default;
+  };
+
+  /// Groups of feedback fields that are refreshed together. Each value is a
+  /// bit of `feedback_t::updated` and `feedback_t::received`.
+  enum class field_group : std::uint8_t
+  {
+    /// raw_current, raw_speed and encoder. Refreshed by read::status_2 and the
+    /// responses to actuate commands.
+    motion = 1 << 0,
+    /// raw_motor_temperature. Refreshed by the same responses as motion and by
+    /// read::status_1_and_error_flags.
+    temperature = 1 << 1,
+    /// raw_volts and raw_error_state. Refreshed by
+    /// read::status_1_and_error_flags.
+    status = 1 << 2,
+    /// raw_multi_turn_angle. Refreshed by read::multi_turns_angle.
+    angle = 1 << 3,
+  };
+
+  /// Number of field groups
+  static constexpr std::size_t field_groups = 4;
+  /// Bit mask of every field group
+  static constexpr std::uint8_t all_field_groups = 0b1111;
+
   /// Structure containing all of the forms of feedback acquired by an RMD-X
   /// motor
   struct feedback_t
@@ -102,6 +176,10 @@ public:
     /// This can be used to indicate if the feedback has updated since the last
     /// time it was read.
     std::uint32_t message_number = 0;
+    /// Value of message_number when our motor last responded with the command
+    /// byte of the most recent frame transmitted to it. Unlike message_number,
+    /// late responses to earlier commands do not change it.
+    std::uint32_t acknowledged_number = 0;
     /// Raw multi-turn angle (0.01°/LSB)
     std::int64_t raw_multi_turn_angle{ 0 };
     /// Current flowing through the motor windings
@@ -117,6 +195,22 @@ public:
     std::int8_t raw_motor_temperature{ 0 };
     /// 8-bit value containing error flag information
     std::uint8_t raw_error_state{ 0 };
+    /// PID gains of the motor. Updated by read::pid requests and by the
+    /// responses to PID writes. Empty until one of those has been received.
+    std::optional<pid_gains> pid{};
+    /// Acceleration used by speed and position control (1 dps/s per LSB).
+    /// Updated by read::acceleration requests and by the responses to
+    /// acceleration writes. Empty until one of those has been received.
+    std::optional<std::int32_t> raw_acceleration{};
+    /// Bit mask of the field groups updated since `take_updated()` was last
+    /// called.
+    std::uint8_t updated{ 0 };
+    /// Bit mask of the field groups received at least once
+    std::uint8_t received{ 0 };
+    /// Uptime of the driver's clock when each field group was last updated,
+    /// indexed by the bit position of the group. Only meaningful for groups
+    /// set in `received`.
+    std::array<std::uint64_t, field_groups> updated_at{};
 
     hal::ampere current() const noexcept;
     hal::rpm speed() const noexcept;
@@ -150,7 +244,7 @@ public:
   /**
    * @brief Create a new device driver drc
    *
-   * This factory function will power cycle the motor
+   * By default, this constructor will power cycle the motor.
    *
    * @param p_router - can router to use
    * @param p_clock - clocked used to determine timeouts
@@ -158,18 +252,29 @@ public:
    * @param p_device_id - The CAN ID of the motor
    * @param p_max_response_time - maximum amount of time to wait for a response
    * from the motor.
+   * @param p_startup - power cycle the motor or attach to an already running
+   * motor.
    * @throws hal::timed_out - if the p_max_response_time is exceeded
    */
   drc(hal::can_router& p_router,
       hal::steady_clock& p_clock,
       float p_gear_ratio,
       can::id_t p_device_id,
-      hal::time_duration p_max_response_time = std::chrono::milliseconds(10));
+      hal::time_duration p_max_response_time = std::chrono::milliseconds(10),
+      startup p_startup = startup::power_cycle);
 
   drc(drc&) = delete;
   drc& operator=(drc&) = delete;
-  drc(drc&&) noexcept = delete;
-  drc& operator=(drc&&) noexcept = delete;
+  /**
+   * @brief Move the driver, re-binding its can router callback
+   *
+   * Responses are delivered to the new object. Adaptors, schedulers and other
+   * objects that hold a pointer to the moved from driver must be recreated.
+   * The moved from driver must not be used other than to be destroyed or
+   * assigned to.
+   */
+  drc(drc&& p_other) noexcept;
+  drc& operator=(drc&& p_other) noexcept;
 
   /**
    * @brief Request feedback from the motor
@@ -201,6 +306,20 @@ public:
    */
   void position_control(degrees p_angle, rpm p_speed);
 
+  /**
+   * @brief Move motor shaft by an angle relative to its current position
+   *
+   * Unlike position_control(), the current position of the motor does not
+   * need to be known, saving a multi-turn angle request before each move.
+   *
+   * @param p_angle - angle in degrees to move by. Positive values rotate the
+   * shaft clockwise.
+   * @param p_speed - maximum speed in rpm's
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time set at creation.
+   */
+  void incremental_position_control(degrees p_angle, rpm p_speed);
+
   /**
    * @brief Send system control commands to the device
    *
@@ -211,8 +330,228 @@ public:
    */
   void system_control(system p_system_command);
 
+  /**
+   * @brief Write the gains of the motor's control loops
+   *
+   * @param p_gains - gains to write
+   * @param p_persist - write the gains to ROM so they survive a power cycle.
+   * Otherwise the gains are written to RAM. Writing ROM wears the motor's
+   * flash, avoid doing so repeatedly, see `drc_configuration`.
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time set at creation.
+   */
+  void write_pid(pid_gains const& p_gains, bool p_persist = false);
+
+  /**
+   * @brief Write the acceleration used by speed and position control to RAM
+   *
+   * @param p_acceleration - acceleration in 1 dps/s per LSB
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time set at creation.
+   */
+  void write_acceleration(std::int32_t p_acceleration);
+
+  /**
+   * @brief Get and clear the field groups updated since the last call
+   *
+   * @return std::uint8_t - bit mask of the field_group values updated
+   */
+  std::uint8_t take_updated();
+
+  /**
+   * @brief Request only the field groups older than a maximum age
+   *
+   * The read commands that refresh the stale groups are sent back to back and
+   * their responses are awaited together, so refreshing every group costs a
+   * single round trip. Groups that have never been received are stale. Nothing
+   * is sent if every group is fresh.
+   *
+   * @param p_max_age - oldest acceptable age of a field group
+   * @param p_groups - bit mask of the field groups to consider
+   * @return std::uint8_t - bit mask of the field groups that were requested
+   * @throws hal::timed_out - if the motor does not respond to every request
+   * within its response timeout.
+   */
+  std::uint8_t request_stale(hal::time_duration p_max_age,
+                             std::uint8_t p_groups = all_field_groups);
+
+  /**
+   * @brief Request the stale field groups of many motors in one burst
+   *
+   * The read commands of every motor are sent back to back and all of the
+   * responses are awaited together. Motors whose groups are all fresh are
+   * skipped. The clock of the first motor and the longest response timeout of
+   * all of the motors are used.
+   *
+   * @param p_motors - motors to refresh, at most 32 motors
+   * @param p_max_age - oldest acceptable age of a field group
+   * @param p_groups - bit mask of the field groups to consider
+   * @throws hal::argument_out_of_domain - if more than 32 motors are passed
+   * @throws hal::timed_out - if any motor fails to respond in time
+   */
+  static void request_stale(std::span<drc* const> p_motors,
+                            hal::time_duration p_max_age,
+                            std::uint8_t p_groups = all_field_groups);
+
+  /**
+   * @brief Send a command to the motor without waiting for its response
+   *
+   * The response will still be decoded into `feedback()` when it arrives and
+   * `feedback().message_number` will increment. This allows commands to be
+   * issued to many motors back to back before waiting on any of them. A stop
+   * requested by stall detection is sent first, see `send_pending_stop()`.
+   *
+   * @param p_payload - command data to be sent to the device
+   */
+  void transmit(std::array<hal::byte, 8> p_payload);
+
+  /**
+   * @brief Confirm that a set of motors are present and responding
+   *
+   * A status_1_and_error_flags request is sent to every motor back to back,
+   * then all of the responses are awaited together. The verification costs a
+   * single round trip regardless of the number of motors. Pairs well with
+   * `startup::attach`.
+   *
+   * The clock of the first motor is used and the longest max response time of
+   * all of the motors is used as the deadline.
+   *
+   * @param p_motors - motors to verify, at most 32 motors.
+   * @throws hal::timed_out - if any of the motors fail to respond in time.
+   * @throws hal::argument_out_of_domain - if more than 32 motors are passed.
+   */
+  static void verify_alive(std::span<drc* const> p_motors);
+
+  /**
+   * @brief Stop every motor as quickly as possible
+   *
+   * A system::stop command is sent to every motor back to back and the
+   * acknowledgements are verified together afterwards. Motors that do not
+   * acknowledge the stop are sent the command again, up to p_retries times.
+   * This function does not throw on timeout, check the returned report.
+   *
+   * The clock of the first motor is used and the longest response timeout of
+   * all of the motors is used as the deadline for each attempt.
+   *
+   * @param p_motors - motors to stop, at most 32 motors.
+   * @param p_retries - number of additional attempts for motors that did not
+   * acknowledge the stop.
+   * @return stop_report - latency of the stop and motors that did not respond
+   * @throws hal::argument_out_of_domain - if more than 32 motors are passed.
+   */
+  static stop_report emergency_stop_all(std::span<drc* const> p_motors,
+                                        std::uint8_t p_retries = 2);
+
   feedback_t const& feedback() const;
 
+  /**
+   * @brief Replace the fixed max response time with an adaptive timeout
+   *
+   * The amount of time to wait for a response will be learned from the round
+   * trip times observed by this driver. See `hal::rmd::rtt_estimator` for
+   * details. The max response time passed at construction is no longer used
+   * after this is called.
+   *
+   * @param p_settings - bounds and tuning of the adaptive timeout
+   */
+  void adaptive_timeout(rtt_estimator::settings const& p_settings);
+
+  /**
+   * @brief Get the round trip time statistics of this motor
+   *
+   * @return std::optional<rtt_estimator> const& - round trip time statistics,
+   * only available if `adaptive_timeout()` has been called.
+   */
+  std::optional<rtt_estimator> const& round_trip_time() const;
+
+  /**
+   * @brief Estimate position, velocity and acceleration from feedback
+   *
+   * Every multi-turn angle reply and every reply carrying the motor speed
+   * that this driver receives will be timestamped and fed into a
+   * `hal::rmd::motion_estimator`. No additional requests are made.
+   *
+   * @param p_settings - gains of the estimator
+   */
+  void estimate_motion(motion_estimator::settings const& p_settings);
+
+  /**
+   * @brief Get the motion estimate of this motor
+   *
+   * Use `motion_estimator::extrapolate()` with the uptime of the clock passed
+   * to this driver to predict the motion at the current time.
+   *
+   * @return std::optional<motion_estimator> const& - motion estimate, only
+   * available if `estimate_motion()` has been called.
+   */
+  std::optional<motion_estimator> const& motion() const;
+
+  /**
+   * @brief Track the multi-turn output shaft angle from encoder readings
+   *
+   * Each multi-turn angle reply seeds the tracker and each reply carrying the
+   * encoder position advances it. Request `read::multi_turns_angle` once to
+   * start tracking and again whenever `multi_turn()->resync_due()` returns
+   * true. See `hal::rmd::multi_turn_tracker` for details.
+   *
+   * @param p_settings - encoder resolution and resync interval
+   */
+  void track_multi_turn(multi_turn_tracker::settings const& p_settings);
+
+  /**
+   * @brief Get the multi-turn tracker of this motor
+   *
+   * @return std::optional<multi_turn_tracker> const& - output shaft angle
+   * tracker, only available if `track_multi_turn()` has been called.
+   */
+  std::optional<multi_turn_tracker> const& multi_turn() const;
+
+  /**
+   * @brief Detect stalls from the current and speed of every reply
+   *
+   * Speed commands arm the detector with the commanded speed, any other
+   * motion or system command disarms it. Each reply carrying current and
+   * speed is checked, see `hal::rmd::stall_detector`. When a stall is
+   * detected, the detector is disarmed and a system::stop is requested if
+   * `stop_on_stall` is set, then p_on_stall is called. The stop is not sent
+   * from the can receive handler, which may run in an interrupt, see
+   * `send_pending_stop()`.
+   *
+   * @param p_settings - thresholds and window of the detector
+   * @param p_on_stall - called from the can receive handler when a stall is
+   * detected, keep it short as this may run in interrupt context.
+   */
+  void detect_stall(stall_detector::settings const& p_settings,
+                    hal::callback<void()> p_on_stall);
+
+  /**
+   * @brief Get the stall detector of this motor
+   *
+   * @return std::optional<stall_detector> const& - stall detector, only
+   * available if `detect_stall()` has been called.
+   */
+  std::optional<stall_detector> const& stall() const;
+
+  /**
+   * @brief Transmit the system::stop requested by stall detection, if any
+   *
+   * The stop is sent by whichever comes first, this function or the next
+   * frame transmitted to the motor, so it goes out before that frame. Call
+   * this from the control loop if it may not command the motor again soon.
+   *
+   * @return true - a stop was transmitted
+   * @return false - no stop was requested
+   */
+  bool send_pending_stop();
+
+  /**
+   * @brief Get the amount of time the driver will wait for the next response
+   *
+   * @return hal::time_duration - the adaptive timeout if enabled, otherwise
+   * the max response time passed at construction.
+   */
+  hal::time_duration response_timeout() const;
+
   /**
    * @brief Handle messages from the canbus with this devices ID
    *
@@ -230,13 +569,113 @@ private:
    */
   void send(std::array<hal::byte, 8> p_payload);
 
+  template<class driver, std::uint32_t gear, can::id_t device>
+  friend class motor;
+  template<class driver>
+  friend void run_motion_reply_hooks(driver& p_driver, std::uint64_t p_now);
+  template<class driver>
+  friend void run_angle_reply_hooks(driver& p_driver,
+                                    std::uint64_t p_now,
+                                    hal::degrees p_output_angle);
+
   feedback_t m_feedback{};
   hal::steady_clock* m_clock;
   hal::can_router* m_router;
   hal::can_router::route_item m_route_item;
   float m_gear_ratio;
   can::id_t m_device_id;
+  hal::byte m_transmitted_command = 0;
   hal::time_duration m_max_response_time;
+  std::optional<rtt_estimator> m_rtt{};
+  std::optional<motion_estimator> m_motion{};
+  std::optional<multi_turn_tracker> m_multi_turn{};
+  std::optional<stall_detector> m_stall{};
+  hal::callback<void()> m_on_stall = []() {};
+  /// Set by the receive handler, see send_pending_stop()
+  bool m_stop_pending = false;
+};
+
+/**
+ * @brief Batches configuration writes across many DRC motors
+ *
+ * Stage the desired PID gains and acceleration of each motor, then call
+ * `commit()`. The commit reads the values of motors whose configuration has
+ * not been seen yet, skips motors whose configuration already matches and
+ * writes the rest. Each step issues its commands to every motor back to back
+ * and awaits the responses together, so configuring a bus of motors costs a
+ * handful of round trips rather than several per motor. ROM is only written
+ * for values that differ from what the motor reports, saving flash wear.
+ */
+class drc_configuration
+{
+public:
+  /// Number of frames each step of a commit sent
+  struct report_t
+  {
+    /// Read requests for configuration that was not yet cached
+    std::uint32_t reads = 0;
+    /// Writes to RAM
+    std::uint32_t ram_writes = 0;
+    /// Writes to ROM
+    std::uint32_t rom_writes = 0;
+    /// Staged values that already matched the motor and were not written
+    std::uint32_t skipped = 0;
+  };
+
+  /// Most motors that can be staged, the number of IDs on a bus
+  static constexpr std::size_t max_motors = 32;
+
+  /**
+   * @brief Construct a new configuration transaction
+   *
+   * @param p_clock - clock used to determine timeouts
+   */
+  drc_configuration(hal::steady_clock& p_clock);
+
+  /**
+   * @brief Stage PID gains for a motor
+   *
+   * @param p_motor - motor to configure
+   * @param p_gains - desired gains
+   * @param p_persist - write the gains to ROM if they differ
+   * @throws hal::argument_out_of_domain - if more than 32 motors are staged
+   */
+  void pid(drc& p_motor, drc::pid_gains const& p_gains, bool p_persist = false);
+
+  /**
+   * @brief Stage an acceleration for a motor
+   *
+   * @param p_motor - motor to configure
+   * @param p_acceleration - desired acceleration in 1 dps/s per LSB
+   * @throws hal::argument_out_of_domain - if more than 32 motors are staged
+   */
+  void acceleration(drc& p_motor, std::int32_t p_acceleration);
+
+  /**
+   * @brief Read, compare and write all staged configuration
+   *
+   * The staged configuration is cleared afterwards, even on failure.
+   *
+   * @return report_t - frames sent by each step
+   * @throws hal::timed_out - if any motor fails to respond in time. The
+   * pointer passed to the exception is the motor that failed.
+   */
+  report_t commit();
+
+private:
+  struct entry_t
+  {
+    std::optional<drc::pid_gains> pid{};
+    std::optional<std::int32_t> acceleration{};
+    bool persist = false;
+  };
+
+  entry_t& stage(drc& p_motor);
+
+  hal::steady_clock* m_clock;
+  std::array<drc*, max_motors> m_motors{};
+  std::array<entry_t, max_motors> m_entries{};
+  std::size_t m_count = 0;
 };
 
 /**
@@ -316,6 +755,18 @@ drc_motor make_motor(drc& p_drc, hal::rpm p_max_speed);
  */
 class drc_servo : public hal::servo
 {
+public:
+  /**
+   * @brief Move the servo by an angle relative to its current position
+   *
+   * See `drc::incremental_position_control()`.
+   *
+   * @param p_angle - angle in degrees to move by
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time of the drc driver.
+   */
+  void move_by(hal::degrees p_angle);
+
 private:
   drc_servo(drc& p_drc, hal::rpm p_max_speed);
   void driver_position(hal::degrees p_position) override;
@@ -0,0 +1,144 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <libhal/can.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
+
+namespace hal::rmd {
+/**
+ * @brief A can bus decorator that injects faults into the frames it carries
+ *
+ * Frames sent through the injector and frames received from the wrapped bus
+ * can be dropped, delayed, duplicated or corrupted at programmable rates.
+ * Corruption changes either the ID or the length of the frame, which are the
+ * faults that survive the CAN CRC in practice, such as a misconfigured motor
+ * ID or a truncated frame from a faulty driver. Faults are drawn from a
+ * seeded generator so a fault profile is reproducible.
+ *
+ * The injector is also a steady clock wrapping the real clock. Delayed frames
+ * are released when the clock is read, so drivers must be given the injector
+ * as their clock for delays to take effect. The busy waits in the drivers read
+ * the clock continuously.
+ *
+ * Use this to verify the timeout and recovery paths of a control loop on a
+ * real bus or in a simulation. This class is not thread safe.
+ */
+class fault_injector
+  : public hal::can
+  , public hal::steady_clock
+{
+public:
+  struct settings
+  {
+    /// Probability of a frame being dropped, within [0.0f, 1.0f]
+    float loss = 0.0f;
+    /// Probability of a frame being held back by `delay_time`, within
+    /// [0.0f, 1.0f]
+    float delay = 0.0f;
+    /// Probability of a frame being delivered twice, within [0.0f, 1.0f]
+    float duplicate = 0.0f;
+    /// Probability of a frame having its ID or length corrupted, within
+    /// [0.0f, 1.0f]
+    float corrupt = 0.0f;
+    /// Time a delayed frame is held back
+    hal::time_duration delay_time = std::chrono::milliseconds(1);
+    /// Inject faults into frames sent through the injector
+    bool outgoing = true;
+    /// Inject faults into frames received from the wrapped bus
+    bool incoming = true;
+    /// Seed of the fault generator, the same seed and traffic produce the
+    /// same faults.
+    std::uint32_t seed = 1;
+  };
+
+  /// Number of frames each kind of fault was applied to
+  struct stats_t
+  {
+    /// Frames delivered without any fault
+    std::uint32_t passed = 0;
+    std::uint32_t dropped = 0;
+    std::uint32_t delayed = 0;
+    std::uint32_t duplicated = 0;
+    std::uint32_t corrupted = 0;
+  };
+
+  /// Most frames that can be delayed at once, frames that would be delayed
+  /// while this many are held back are delivered immediately.
+  static constexpr std::size_t max_delayed = 16;
+
+  /**
+   * @brief Wrap a can bus and its clock
+   *
+   * @param p_bus - can bus to inject faults into
+   * @param p_clock - clock used to time delayed frames
+   * @param p_settings - fault rates
+   * @throws hal::argument_out_of_domain - if a rate is outside of [0.0f, 1.0f]
+   */
+  fault_injector(hal::can& p_bus,
+                 hal::steady_clock& p_clock,
+                 settings const& p_settings);
+
+  fault_injector(fault_injector&) = delete;
+  fault_injector& operator=(fault_injector&) = delete;
+
+  /**
+   * @brief Deliver every delayed frame that is due
+   *
+   * Called on every read of the clock, call this directly if the drivers
+   * use a different clock.
+   */
+  void release();
+
+  /**
+   * @return stats_t const& - faults injected since construction
+   */
+  stats_t const& stats() const;
+
+private:
+  struct delayed_t
+  {
+    std::uint64_t due = 0;
+    message_t message{};
+    bool incoming = false;
+  };
+
+  void driver_configure(hal::can::settings const& p_settings) override;
+  void driver_bus_on() override;
+  void driver_send(message_t const& p_message) override;
+  void driver_on_receive(hal::callback<handler> p_handler) override;
+  hal::hertz driver_frequency() override;
+  std::uint64_t driver_uptime() override;
+
+  void release(std::uint64_t p_now);
+  void inject(message_t p_message, bool p_incoming);
+  void deliver(message_t const& p_message, bool p_incoming);
+  bool roll(float p_probability);
+
+  hal::can* m_bus;
+  hal::steady_clock* m_clock;
+  settings m_settings;
+  hal::callback<handler> m_handler = [](message_t const&) {};
+  std::array<delayed_t, max_delayed> m_delayed{};
+  std::size_t m_delayed_count = 0;
+  std::uint64_t m_delay_ticks = 0;
+  stats_t m_stats{};
+  std::uint32_t m_random;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,158 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include <libhal/functional.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
+
+#include "scheduler.hpp"
+
+namespace hal::rmd {
+/**
+ * @brief Keeps the error flags and supply health of a fleet of motors current
+ *
+ * The error flags, supply voltage and temperature of a motor only update when
+ * a status_1_and_error_flags request is made. The health monitor makes those
+ * requests through a scheduler, one motor at a time in round robin order, and
+ * only when the scheduler has nothing else to do. The interval between
+ * requests sets the duty cycle, so fault detection never competes with the
+ * control loop for the bus.
+ *
+ * When a request completes, changes in the error flags are reported through
+ * the flag change callback and the voltage and temperature trends are updated.
+ *
+ * Call `service()` alongside `scheduler::service()` in the control loop.
+ */
+class health_monitor
+{
+public:
+  using motor_t = scheduler::motor_t;
+
+  struct settings
+  {
+    /// Time between status requests across the whole fleet. Each motor is
+    /// sampled once every `interval * number of motors`.
+    hal::time_duration interval = std::chrono::milliseconds(50);
+    /// Weight given to each new slope when updating the trends. Must be within
+    /// (0.0f, 1.0f].
+    float trend_gain = 0.2f;
+  };
+
+  /// Latest health information of a motor
+  struct health_t
+  {
+    /// Error flags reported by the motor, see each driver's feedback_t
+    std::uint16_t error_flags = 0;
+    /// Supply voltage
+    hal::volts volts = 0.0f;
+    /// Motor temperature
+    hal::celsius temperature = 0.0f;
+    /// Smoothed rate of change of the supply voltage in volts per second
+    float volts_trend = 0.0f;
+    /// Smoothed rate of change of the temperature in celsius per second
+    float temperature_trend = 0.0f;
+    /// Number of status requests that received a response
+    std::uint32_t samples = 0;
+    /// Number of status requests that did not receive a response
+    std::uint32_t missed = 0;
+  };
+
+  /**
+   * @brief Called when the error flags of a motor change
+   *
+   * @param p_motor - the motor whose flags changed
+   * @param p_raised - flags that are now set and were not before
+   * @param p_cleared - flags that are no longer set
+   */
+  using flag_handler = void(motor_t p_motor,
+                            std::uint16_t p_raised,
+                            std::uint16_t p_cleared);
+
+  /// Most motors that can be monitored, the number of IDs on a bus
+  static constexpr std::size_t max_motors = 32;
+
+  /**
+   * @brief Construct a new health monitor
+   *
+   * @param p_scheduler - scheduler to submit status requests to
+   * @param p_clock - clock used to pace requests and compute trends
+   * @param p_settings - duty cycle and trend tuning
+   */
+  health_monitor(scheduler& p_scheduler,
+                 hal::steady_clock& p_clock,
+                 settings const& p_settings);
+
+  /**
+   * @brief Add a motor to the fleet being monitored
+   *
+   * @param p_motor - motor to monitor. The motor's lifetime must exceed the
+   * lifetime of this object.
+   * @return std::size_t - index of the motor used by `health()`
+   * @throws hal::argument_out_of_domain - if more than 32 motors are added
+   */
+  std::size_t add(motor_t p_motor);
+
+  /**
+   * @brief Set the callback for error flag changes
+   *
+   * @param p_handler - called from `service()` when a motor's flags change
+   */
+  void on_flag_change(hal::callback<flag_handler> p_handler);
+
+  /**
+   * @brief Make progress on health monitoring without blocking
+   *
+   * Evaluates the last status request once the scheduler has completed it and
+   * submits the next request when the scheduler is idle and the interval has
+   * elapsed.
+   */
+  void service();
+
+  /**
+   * @param p_index - index returned by `add()`
+   * @return health_t const& - latest health information of the motor
+   */
+  health_t const& health(std::size_t p_index) const;
+
+  /**
+   * @return std::size_t - number of motors being monitored
+   */
+  std::size_t size() const;
+
+private:
+  void evaluate();
+
+  scheduler* m_scheduler;
+  hal::steady_clock* m_clock;
+  settings m_settings;
+  hal::callback<flag_handler> m_on_flag_change = [](motor_t,
+                                                    std::uint16_t,
+                                                    std::uint16_t) {};
+  std::array<motor_t, max_motors> m_motors{};
+  std::array<health_t, max_motors> m_health{};
+  std::array<std::uint64_t, max_motors> m_last_sample{};
+  std::uint64_t m_next_request = 0;
+  std::optional<std::uint64_t> m_snapshot{};
+  std::uint8_t m_count = 0;
+  std::uint8_t m_next = 0;
+  std::uint8_t m_in_flight = 0;
+  bool m_waiting = false;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,122 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <span>
+#include <thread>
+#include <variant>
+
+#include <libhal/steady_clock.hpp>
+
+#include "../scheduler.hpp"
+#include "mpsc_queue.hpp"
+
+namespace hal::rmd {
+/**
+ * @brief Thread safe front end for commanding RMD motors from many threads
+ *
+ * The drivers have no synchronization, so only one thread may use a driver
+ * and its can router at a time. The command server owns an I/O thread that
+ * is the only user of the drivers after the server is constructed. Any thread
+ * may submit commands through a lock-free queue and receive the feedback of
+ * the motor through a future once the motor responds.
+ *
+ * The I/O thread drains the queue in batches of commands to distinct motors.
+ * Every command of a batch is transmitted back to back and the responses are
+ * awaited together, so commands from different threads to different motors
+ * share a single round trip.
+ *
+ * The can bus must deliver received messages on the I/O thread, for example
+ * by polling the bus when the clock is read, or otherwise synchronize with
+ * the I/O thread.
+ *
+ * Available on Linux hosts only.
+ */
+class command_server
+{
+public:
+  /// Motor a command will be sent to
+  using motor_t = scheduler::motor_t;
+  /// Feedback of the motor after it responded to a command
+  using feedback_t = std::variant<drc::feedback_t, mc_x::feedback_t>;
+
+  /// Number of commands that can wait in the queue
+  static constexpr std::size_t queue_depth = 256;
+
+  /**
+   * @brief Start the I/O thread
+   *
+   * @param p_clock - clock used to determine response deadlines, only used by
+   * the I/O thread.
+   */
+  command_server(hal::steady_clock& p_clock);
+
+  command_server(command_server&) = delete;
+  command_server& operator=(command_server&) = delete;
+
+  /**
+   * @brief Stop the I/O thread
+   *
+   * Commands that are still queued are abandoned and their futures report
+   * std::future_errc::broken_promise.
+   */
+  ~command_server();
+
+  /**
+   * @brief Queue a command for a motor, safe from any thread
+   *
+   * @param p_motor - motor to send the command to. The motor's lifetime must
+   * exceed the lifetime of the server.
+   * @param p_payload - command to send to the motor
+   * @return std::optional<std::future<feedback_t>> - the feedback of the motor
+   * once it responds, or std::nullopt if the queue is full. The future throws
+   * hal::timed_out if the motor does not respond within its response
+   * timeout.
+   */
+  std::optional<std::future<feedback_t>> submit(
+    motor_t p_motor,
+    std::array<hal::byte, 8> p_payload);
+
+  /**
+   * @return std::uint64_t - number of commands that completed or timed out
+   */
+  std::uint64_t completed() const;
+
+private:
+  struct command_t
+  {
+    motor_t motor{};
+    std::array<hal::byte, 8> payload{};
+    std::promise<feedback_t> promise{};
+  };
+
+  void run(std::stop_token p_stop);
+  void exchange(std::span<command_t> p_batch);
+
+  hal::steady_clock* m_clock;
+  mpsc_queue<command_t, queue_depth> m_queue;
+  /// Incremented on every submit so the I/O thread can sleep while idle
+  std::atomic<std::uint32_t> m_submitted = 0;
+  std::atomic<std::uint64_t> m_completed = 0;
+  /// Command popped by the I/O thread that did not fit in the last batch
+  std::optional<command_t> m_carry{};
+  std::jthread m_thread;
+};
+}  // namespace hal::rmd
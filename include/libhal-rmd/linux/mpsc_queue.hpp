@@ -0,0 +1,129 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace hal::rmd {
+/**
+ * @brief Bounded lock-free queue for many producers and a single consumer
+ *
+ * Each cell carries a sequence number that tells producers whether the cell
+ * is free and tells the consumer whether the cell has been written. Producers
+ * claim a cell with a single compare and swap on the tail, so no producer
+ * waits on a lock held by another thread. A producer that is preempted
+ * between claiming and publishing a cell only delays the consumer at that
+ * cell.
+ *
+ * @tparam T - type of the queued values, must be default constructible and
+ * move assignable.
+ * @tparam capacity - number of values the queue can hold, must be a power of
+ * two.
+ */
+template<class T, std::size_t capacity>
+class mpsc_queue
+{
+public:
+  static_assert(std::has_single_bit(capacity),
+                "mpsc_queue capacity must be a power of two");
+
+  mpsc_queue()
+  {
+    for (std::size_t i = 0; i < capacity; i++) {
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  mpsc_queue(mpsc_queue&) = delete;
+  mpsc_queue& operator=(mpsc_queue&) = delete;
+
+  /**
+   * @brief Add a value to the back of the queue, safe from any thread
+   *
+   * @param p_value - value to add
+   * @return true - the value was added
+   * @return false - the queue is full, the value was not added
+   */
+  bool push(T&& p_value)
+  {
+    auto position = m_tail.load(std::memory_order_relaxed);
+    while (true) {
+      auto& cell = m_cells[position & mask];
+      auto const sequence = cell.sequence.load(std::memory_order_acquire);
+      auto const lag = static_cast<std::intptr_t>(sequence) -
+                       static_cast<std::intptr_t>(position);
+
+      if (lag == 0) {
+        if (m_tail.compare_exchange_weak(
+              position, position + 1, std::memory_order_relaxed)) {
+          cell.value = std::move(p_value);
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (lag < 0) {
+        // The consumer has not freed this cell yet
+        return false;
+      } else {
+        // Another producer claimed this cell first
+        position = m_tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Remove the value at the front of the queue
+   *
+   * Must only be called by the consumer thread.
+   *
+   * @return std::optional<T> - the front value, or std::nullopt if the queue
+   * is empty or the front value has not been published yet.
+   */
+  std::optional<T> pop()
+  {
+    auto& cell = m_cells[m_head & mask];
+    auto const sequence = cell.sequence.load(std::memory_order_acquire);
+    if (sequence != m_head + 1) {
+      return std::nullopt;
+    }
+
+    std::optional<T> value(std::move(cell.value));
+    cell.value = T{};
+    cell.sequence.store(m_head + capacity, std::memory_order_release);
+    m_head++;
+    return value;
+  }
+
+private:
+  static constexpr std::size_t mask = capacity - 1;
+  /// Keeps the producer and consumer indices on separate cache lines
+  static constexpr std::size_t cache_line = 64;
+
+  struct cell_t
+  {
+    std::atomic<std::size_t> sequence{};
+    T value{};
+  };
+
+  std::array<cell_t, capacity> m_cells{};
+  alignas(cache_line) std::atomic<std::size_t> m_tail = 0;
+  alignas(cache_line) std::size_t m_head = 0;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,190 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <libhal/steady_clock.hpp>
+
+#include "../drc.hpp"
+#include "../mc_x.hpp"
+
+namespace hal::rmd {
+/// Snapshot of one motor as published into shared memory
+struct telemetry_record
+{
+  enum class model_t : std::uint8_t
+  {
+    none = 0,
+    drc = 1,
+    mc_x = 2,
+  };
+
+  /// Exporter clock time of the publish in nanoseconds
+  std::uint64_t timestamp_ns = 0;
+  std::int64_t raw_multi_turn_angle = 0;
+  can::id_t device_id = 0;
+  std::uint32_t message_number = 0;
+  /// Number of times this slot has been published
+  std::uint32_t publishes = 0;
+  /// Rotor angle in degrees
+  float angle = 0.0f;
+  /// Rotor speed in RPM
+  float speed = 0.0f;
+  /// Phase current in amperes
+  float current = 0.0f;
+  float volts = 0.0f;
+  /// Motor temperature in celsius
+  float temperature = 0.0f;
+  std::uint16_t error_state = 0;
+  std::int16_t encoder = 0;
+  model_t model = model_t::none;
+  std::array<std::uint8_t, 11> reserved{};
+};
+
+static_assert(sizeof(telemetry_record) == 64);
+static_assert(std::is_trivially_copyable_v<telemetry_record>);
+
+/**
+ * @brief Publish motor feedback into a POSIX shared memory segment
+ *
+ * The segment has a fixed layout of one slot per motor. Each slot is guarded
+ * by a sequence lock: the writer makes the sequence odd, writes the record,
+ * then makes the sequence even again. Readers in other processes copy a slot
+ * without taking any lock and retry if the sequence changed during the copy,
+ * so the writer never waits on readers and readers never see a torn record.
+ *
+ * The segment is created on construction and unlinked on destruction.
+ *
+ * Available on Linux hosts only.
+ */
+class telemetry_exporter
+{
+public:
+  /// Number of motor slots in the segment
+  static constexpr std::size_t slot_count = 32;
+
+  /**
+   * @brief Create the shared memory segment
+   *
+   * @param p_name - name of the segment, such as "/rmd_telemetry"
+   * @param p_clock - clock used to timestamp each publish
+   * @throws hal::io_error - if the segment could not be created or mapped
+   */
+  telemetry_exporter(std::string_view p_name, hal::steady_clock& p_clock);
+
+  telemetry_exporter(telemetry_exporter&) = delete;
+  telemetry_exporter& operator=(telemetry_exporter&) = delete;
+  ~telemetry_exporter();
+
+  /**
+   * @brief Publish the feedback of a DRC motor
+   *
+   * @param p_slot - slot of the motor, less than slot_count
+   * @param p_device_id - CAN ID of the motor
+   * @param p_feedback - latest feedback of the motor
+   * @throws hal::argument_out_of_domain - if the slot is out of range
+   */
+  void publish(std::size_t p_slot,
+               can::id_t p_device_id,
+               drc::feedback_t const& p_feedback);
+
+  /**
+   * @brief Publish the feedback of a MC-X motor
+   *
+   * @param p_slot - slot of the motor, less than slot_count
+   * @param p_device_id - CAN ID of the motor
+   * @param p_feedback - latest feedback of the motor
+   * @throws hal::argument_out_of_domain - if the slot is out of range
+   */
+  void publish(std::size_t p_slot,
+               can::id_t p_device_id,
+               mc_x::feedback_t const& p_feedback);
+
+  struct segment_t;
+
+private:
+  void write(std::size_t p_slot, telemetry_record& p_record);
+
+  hal::steady_clock* m_clock;
+  std::string m_name;
+  segment_t* m_segment = nullptr;
+};
+
+/**
+ * @brief Read motor snapshots published by a telemetry_exporter
+ *
+ * Reads never block the exporter and never return a partially written
+ * record. Usable from any process on the same machine as the exporter.
+ *
+ * Available on Linux hosts only.
+ */
+class telemetry_reader
+{
+public:
+  /// Consecutive retries that see the same publish in progress before a read
+  /// gives up, such as when the exporter died while writing the slot. The
+  /// reader yields between these retries.
+  static constexpr std::uint32_t max_read_retries = 10'000;
+
+  /**
+   * @brief Map an existing telemetry segment read only
+   *
+   * @param p_name - name the exporter was created with
+   * @throws hal::io_error - if the segment does not exist, could not be mapped
+   * or was written by an incompatible version of the exporter.
+   */
+  telemetry_reader(std::string_view p_name);
+
+  telemetry_reader(telemetry_reader&) = delete;
+  telemetry_reader& operator=(telemetry_reader&) = delete;
+  ~telemetry_reader();
+
+  /**
+   * @brief Copy a consistent snapshot of a slot
+   *
+   * @param p_slot - slot to read, less than telemetry_exporter::slot_count
+   * @return std::optional<telemetry_record> - the latest record, or
+   * std::nullopt if the slot has never been published.
+   * @throws hal::argument_out_of_domain - if the slot is out of range
+   * @throws hal::resource_unavailable_try_again - if the same publish was
+   * still in progress after max_read_retries retries. Reading again may
+   * succeed if the exporter was only preempted, it never will if it died.
+   */
+  std::optional<telemetry_record> read(std::size_t p_slot);
+
+  /**
+   * @return std::uint64_t - publishes into every slot since the segment was
+   * created.
+   */
+  std::uint64_t publishes() const;
+
+  /**
+   * @return std::uint64_t - number of times a read had to be retried because
+   * the exporter was writing the slot being read.
+   */
+  std::uint64_t retries() const;
+
+private:
+  telemetry_exporter::segment_t const* m_segment = nullptr;
+  std::uint64_t m_retries = 0;
+};
+}  // namespace hal::rmd
@@ -14,7 +14,10 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <optional>
+#include <span>
 
 #include <libhal-canrouter/can_router.hpp>
 #include <libhal/can.hpp>
@@ -26,6 +29,12 @@
 #include <libhal/temperature_sensor.hpp>
 #include <libhal/units.hpp>
 
+#include "motion_estimator.hpp"
+#include "multi_turn_tracker.hpp"
+#include "rtt_estimator.hpp"
+#include "stall_detector.hpp"
+#include "stop_report.hpp"
+
 namespace hal::rmd {
 /**
  * @brief Driver for RMD series motors equip with the MC-X motor driver
@@ -48,6 +57,7 @@ public:
     torque = 0xA1,
     speed = 0xA2,
     position = 0xA5,
+    incremental_position = 0xA8,
   };
 
   /// Commands for updating motor configuration data
@@ -63,6 +73,28 @@ public:
     stop = 0x81,
   };
 
+  /// Groups of feedback fields that are refreshed together. Each value is a
+  /// bit of `feedback_t::updated` and `feedback_t::received`.
+  enum class field_group : std::uint8_t
+  {
+    /// raw_current, raw_speed and encoder. Refreshed by read::status_2 and the
+    /// responses to actuate commands.
+    motion = 1 << 0,
+    /// raw_motor_temperature. Refreshed by the same responses as motion and by
+    /// read::status_1_and_error_flags.
+    temperature = 1 << 1,
+    /// raw_volts and raw_error_state. Refreshed by
+    /// read::status_1_and_error_flags.
+    status = 1 << 2,
+    /// raw_multi_turn_angle. Refreshed by read::multi_turns_angle.
+    angle = 1 << 3,
+  };
+
+  /// Number of field groups
+  static constexpr std::size_t field_groups = 4;
+  /// Bit mask of every field group
+  static constexpr std::uint8_t all_field_groups = 0b1111;
+
   /// Structure containing all of the forms of feedback acquired by an RMD-X
   /// motor
   struct feedback_t
@@ -71,6 +103,10 @@ public:
     /// This can be used to indicate if the feedback has updated since the last
     /// time it was read.
     std::uint32_t message_number = 0;
+    /// Value of message_number when our motor last responded with the command
+    /// byte of the most recent frame transmitted to it. Unlike message_number,
+    /// late responses to earlier commands do not change it.
+    std::uint32_t acknowledged_number = 0;
     /// Represents the multi-turn absolute angle of the encoder relative to its
     /// zero starting point (0.01°/LSB)
     std::int64_t raw_multi_turn_angle{ 0 };
@@ -87,6 +123,15 @@ public:
     std::int16_t encoder{ 0 };
     /// Core temperature of the motor (1C/LSB)
     std::int8_t raw_motor_temperature{ 0 };
+    /// Bit mask of the field groups updated since `take_updated()` was last
+    /// called.
+    std::uint8_t updated{ 0 };
+    /// Bit mask of the field groups received at least once
+    std::uint8_t received{ 0 };
+    /// Uptime of the driver's clock when each field group was last updated,
+    /// indexed by the bit position of the group. Only meaningful for groups
+    /// set in `received`.
+    std::array<std::uint64_t, field_groups> updated_at{};
 
     hal::ampere current() const noexcept;
     hal::rpm speed() const noexcept;
@@ -122,8 +167,16 @@ public:
 
   mc_x(mc_x&) = delete;
   mc_x& operator=(mc_x&) = delete;
-  mc_x(mc_x&&) noexcept;
-  mc_x& operator=(mc_x&&) noexcept;
+  /**
+   * @brief Move the driver, re-binding its can router callback
+   *
+   * Responses are delivered to the new object. Adaptors, schedulers and other
+   * objects that hold a pointer to the moved from driver must be recreated.
+   * The moved from driver must not be used other than to be destroyed or
+   * assigned to.
+   */
+  mc_x(mc_x&& p_other) noexcept;
+  mc_x& operator=(mc_x&& p_other) noexcept;
 
   /**
    * @brief Get feedback about the motor
@@ -158,6 +211,36 @@ public:
    */
   void velocity_control(rpm p_speed);
 
+  /**
+   * @brief Rotate motor shaft at the designated speed with a current limit
+   *
+   * The motor will not draw more than the current limit while reaching or
+   * holding the speed, allowing aggressive speed targets without tripping
+   * over current protection. The limit is sent as a percentage of the rated
+   * current, thus `rated_current()` must be called first.
+   *
+   * @param p_speed - speed in rpm to move the motor shaft at. Positive values
+   * rotate the motor shaft clockwise, negative values rotate the motor shaft
+   * counter-clockwise assuming you are looking directly at the motor shaft.
+   * @param p_current_limit - maximum torque current. Limits outside of 1% to
+   * 255% of the rated current are clamped to that range.
+   * @throws hal::argument_out_of_domain - if the rated current has not been
+   * set or the current limit is not positive.
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time set at creation.
+   */
+  void velocity_control(rpm p_speed, hal::ampere p_current_limit);
+
+  /**
+   * @brief Set the rated current of the motor
+   *
+   * Found in the motor's datasheet. Used to convert current limits into the
+   * percentage of rated current understood by the motor.
+   *
+   * @param p_rated_current - rated current of the motor
+   */
+  void rated_current(hal::ampere p_rated_current);
+
   /**
    * @brief Move motor shaft to a specific angle
    *
@@ -168,6 +251,20 @@ public:
    */
   void position_control(degrees p_angle, rpm speed);
 
+  /**
+   * @brief Move motor shaft by an angle relative to its current position
+   *
+   * Unlike position_control(), the current position of the motor does not
+   * need to be known, saving a multi-turn angle request before each move.
+   *
+   * @param p_angle - angle in degrees to move by. Positive values rotate the
+   * shaft clockwise.
+   * @param p_speed - maximum speed in rpm's
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time set at creation.
+   */
+  void incremental_position_control(degrees p_angle, rpm p_speed);
+
   /**
    * @brief Send system control commands to the device
    *
@@ -178,6 +275,192 @@ public:
    */
   void system_control(system p_system_command);
 
+  /**
+   * @brief Get and clear the field groups updated since the last call
+   *
+   * @return std::uint8_t - bit mask of the field_group values updated
+   */
+  std::uint8_t take_updated();
+
+  /**
+   * @brief Request only the field groups older than a maximum age
+   *
+   * The read commands that refresh the stale groups are sent back to back and
+   * their responses are awaited together, so refreshing every group costs a
+   * single round trip. Groups that have never been received are stale. Nothing
+   * is sent if every group is fresh.
+   *
+   * @param p_max_age - oldest acceptable age of a field group
+   * @param p_groups - bit mask of the field groups to consider
+   * @return std::uint8_t - bit mask of the field groups that were requested
+   * @throws hal::timed_out - if the motor does not respond to every request
+   * within its response timeout.
+   */
+  std::uint8_t request_stale(hal::time_duration p_max_age,
+                             std::uint8_t p_groups = all_field_groups);
+
+  /**
+   * @brief Request the stale field groups of many motors in one burst
+   *
+   * The read commands of every motor are sent back to back and all of the
+   * responses are awaited together. Motors whose groups are all fresh are
+   * skipped. The clock of the first motor and the longest response timeout of
+   * all of the motors are used.
+   *
+   * @param p_motors - motors to refresh, at most 32 motors
+   * @param p_max_age - oldest acceptable age of a field group
+   * @param p_groups - bit mask of the field groups to consider
+   * @throws hal::argument_out_of_domain - if more than 32 motors are passed
+   * @throws hal::timed_out - if any motor fails to respond in time
+   */
+  static void request_stale(std::span<mc_x* const> p_motors,
+                            hal::time_duration p_max_age,
+                            std::uint8_t p_groups = all_field_groups);
+
+  /**
+   * @brief Send a command to the motor without waiting for its response
+   *
+   * The response will still be decoded into `feedback()` when it arrives and
+   * `feedback().message_number` will increment. This allows commands to be
+   * issued to many motors back to back before waiting on any of them. A stop
+   * requested by stall detection is sent first, see `send_pending_stop()`.
+   *
+   * @param p_payload - command data to be sent to the device
+   */
+  void transmit(std::array<hal::byte, 8> p_payload);
+
+  /**
+   * @brief Stop every motor as quickly as possible
+   *
+   * A single system::stop command is broadcast to every MC-X motor on the bus
+   * using the multi-motor command ID, then the acknowledgements from each
+   * motor are verified together. Motors that do not acknowledge the stop are
+   * sent the command directly, up to p_retries times. This function does not
+   * throw on timeout, check the returned report.
+   *
+   * NOTE: The broadcast will stop every MC-X motor on the same bus, including
+   * ones that are not passed to this function.
+   *
+   * The clock of the first motor is used and the longest response timeout of
+   * all of the motors is used as the deadline for each attempt.
+   *
+   * @param p_motors - motors to verify the stop of, at most 32 motors.
+   * @param p_retries - number of additional attempts for motors that did not
+   * acknowledge the stop.
+   * @return stop_report - latency of the stop and motors that did not respond
+   * @throws hal::argument_out_of_domain - if more than 32 motors are passed.
+   */
+  static stop_report emergency_stop_all(std::span<mc_x* const> p_motors,
+                                        std::uint8_t p_retries = 2);
+
+  /**
+   * @brief Replace the fixed max response time with an adaptive timeout
+   *
+   * The amount of time to wait for a response will be learned from the round
+   * trip times observed by this driver. See `hal::rmd::rtt_estimator` for
+   * details. The max response time passed at construction is no longer used
+   * after this is called.
+   *
+   * @param p_settings - bounds and tuning of the adaptive timeout
+   */
+  void adaptive_timeout(rtt_estimator::settings const& p_settings);
+
+  /**
+   * @brief Get the round trip time statistics of this motor
+   *
+   * @return std::optional<rtt_estimator> const& - round trip time statistics,
+   * only available if `adaptive_timeout()` has been called.
+   */
+  std::optional<rtt_estimator> const& round_trip_time() const;
+
+  /**
+   * @brief Estimate position, velocity and acceleration from feedback
+   *
+   * Every multi-turn angle reply and every reply carrying the motor speed
+   * that this driver receives will be timestamped and fed into a
+   * `hal::rmd::motion_estimator`. No additional requests are made.
+   *
+   * @param p_settings - gains of the estimator
+   */
+  void estimate_motion(motion_estimator::settings const& p_settings);
+
+  /**
+   * @brief Get the motion estimate of this motor
+   *
+   * Use `motion_estimator::extrapolate()` with the uptime of the clock passed
+   * to this driver to predict the motion at the current time.
+   *
+   * @return std::optional<motion_estimator> const& - motion estimate, only
+   * available if `estimate_motion()` has been called.
+   */
+  std::optional<motion_estimator> const& motion() const;
+
+  /**
+   * @brief Track the multi-turn output shaft angle from encoder readings
+   *
+   * Each multi-turn angle reply seeds the tracker and each reply carrying the
+   * encoder position advances it. Request `read::multi_turns_angle` once to
+   * start tracking and again whenever `multi_turn()->resync_due()` returns
+   * true. See `hal::rmd::multi_turn_tracker` for details.
+   *
+   * @param p_settings - encoder resolution and resync interval
+   */
+  void track_multi_turn(multi_turn_tracker::settings const& p_settings);
+
+  /**
+   * @brief Get the multi-turn tracker of this motor
+   *
+   * @return std::optional<multi_turn_tracker> const& - output shaft angle
+   * tracker, only available if `track_multi_turn()` has been called.
+   */
+  std::optional<multi_turn_tracker> const& multi_turn() const;
+
+  /**
+   * @brief Detect stalls from the current and speed of every reply
+   *
+   * Speed commands arm the detector with the commanded speed, any other
+   * motion or system command disarms it. Each reply carrying current and
+   * speed is checked, see `hal::rmd::stall_detector`. When a stall is
+   * detected, the detector is disarmed and a system::stop is requested if
+   * `stop_on_stall` is set, then p_on_stall is called. The stop is not sent
+   * from the can receive handler, which may run in an interrupt, see
+   * `send_pending_stop()`.
+   *
+   * @param p_settings - thresholds and window of the detector
+   * @param p_on_stall - called from the can receive handler when a stall is
+   * detected, keep it short as this may run in interrupt context.
+   */
+  void detect_stall(stall_detector::settings const& p_settings,
+                    hal::callback<void()> p_on_stall);
+
+  /**
+   * @brief Get the stall detector of this motor
+   *
+   * @return std::optional<stall_detector> const& - stall detector, only
+   * available if `detect_stall()` has been called.
+   */
+  std::optional<stall_detector> const& stall() const;
+
+  /**
+   * @brief Transmit the system::stop requested by stall detection, if any
+   *
+   * The stop is sent by whichever comes first, this function or the next
+   * frame transmitted to the motor, so it goes out before that frame. Call
+   * this from the control loop if it may not command the motor again soon.
+   *
+   * @return true - a stop was transmitted
+   * @return false - no stop was requested
+   */
+  bool send_pending_stop();
+
+  /**
+   * @brief Get the amount of time the driver will wait for the next response
+   *
+   * @return hal::time_duration - the adaptive timeout if enabled, otherwise
+   * the max response time passed at construction.
+   */
+  hal::time_duration response_timeout() const;
+
   /**
    * @brief Handle messages from the can bus with this devices ID
    *
@@ -195,13 +478,39 @@ private:
    */
   void send(std::array<hal::byte, 8> p_payload);
 
+  /**
+   * @brief Update the stall detector and trace for a command sent to this
+   * motor, either directly or through a broadcast
+   *
+   * @param p_payload - command data sent to the device
+   */
+  void record_transmit(std::array<hal::byte, 8> const& p_payload);
+
+  template<class driver, std::uint32_t gear, can::id_t device>
+  friend class motor;
+  template<class driver>
+  friend void run_motion_reply_hooks(driver& p_driver, std::uint64_t p_now);
+  template<class driver>
+  friend void run_angle_reply_hooks(driver& p_driver,
+                                    std::uint64_t p_now,
+                                    hal::degrees p_output_angle);
+
   feedback_t m_feedback{};
   hal::steady_clock* m_clock;
   hal::can_router* m_router;
   hal::can_router::route_item m_route_item;
   float m_gear_ratio;
+  hal::ampere m_rated_current = 0.0f;
   can::id_t m_device_id;
+  hal::byte m_transmitted_command = 0;
   hal::time_duration m_max_response_time;
+  std::optional<rtt_estimator> m_rtt{};
+  std::optional<motion_estimator> m_motion{};
+  std::optional<multi_turn_tracker> m_multi_turn{};
+  std::optional<stall_detector> m_stall{};
+  hal::callback<void()> m_on_stall = []() {};
+  /// Set by the receive handler, see send_pending_stop()
+  bool m_stop_pending = false;
 };
 
 /**
@@ -211,11 +520,15 @@ private:
 class mc_x_motor : public hal::motor
 {
 private:
-  mc_x_motor(mc_x& p_mc_x, hal::rpm p_max_speed);
+  mc_x_motor(mc_x& p_mc_x, hal::rpm p_max_speed, hal::ampere p_current_limit);
   void driver_power(float p_power) override;
   friend mc_x_motor make_motor(mc_x& p_mc_x, hal::rpm p_max_speed);
+  friend mc_x_motor make_motor(mc_x& p_mc_x,
+                               hal::rpm p_max_speed,
+                               hal::ampere p_current_limit);
   mc_x* m_mc_x = nullptr;
   hal::rpm m_max_speed;
+  hal::ampere m_current_limit;
 };
 
 /**
@@ -228,6 +541,23 @@ private:
  */
 mc_x_motor make_motor(mc_x& p_mc_x, hal::rpm p_max_speed);
 
+/**
+ * @brief Create a current limited hal::motor driver using the MC-X driver
+ *
+ * Every power setting is sent with the current limit, see
+ * `mc_x::velocity_control(rpm, hal::ampere)`. The rated current of the MC-X
+ * driver must be set before power is applied.
+ *
+ * @param p_mc_x - reference to a MC-X driver. This object's lifetime must
+ * exceed the lifetime of the returned object.
+ * @param p_max_speed - maximum speed of the motor represented by +1.0 and -1.0
+ * @param p_current_limit - maximum torque current the motor may draw
+ * @return mc_x_motor - motor implementation using the MC-X driver
+ */
+mc_x_motor make_motor(mc_x& p_mc_x,
+                      hal::rpm p_max_speed,
+                      hal::ampere p_current_limit);
+
 /**
  * @brief Reports the rotation of the DRC motor
  *
@@ -257,6 +587,18 @@ mc_x_rotation make_rotation_sensor(mc_x& p_mc_x);
  */
 class mc_x_servo : public hal::servo
 {
+public:
+  /**
+   * @brief Move the servo by an angle relative to its current position
+   *
+   * See `mc_x::incremental_position_control()`.
+   *
+   * @param p_angle - angle in degrees to move by
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time of the mc_x driver.
+   */
+  void move_by(hal::degrees p_angle);
+
 private:
   mc_x_servo(mc_x& p_mc_x, hal::rpm p_max_speed);
   void driver_position(hal::degrees p_position) override;
@@ -0,0 +1,134 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal/units.hpp>
+
+namespace hal::rmd {
+/**
+ * @brief Estimates position, velocity and acceleration of a motor
+ *
+ * An alpha-beta-gamma filter that fuses timestamped position measurements
+ * (multi-turn angle) with velocity measurements (the speed field of status 2,
+ * speed and position replies). Between measurements the state is
+ * extrapolated with a constant acceleration model, which lets a control loop
+ * run faster than the rate at which telemetry is requested.
+ *
+ * Positions are in degrees, velocities in degrees per second and
+ * accelerations in degrees per second squared, all in the same frame as the
+ * measurements that are fed in.
+ */
+class motion_estimator
+{
+public:
+  /// The defaults are stable for telemetry periods in the millisecond range.
+  /// Large beta or gamma values relative to alpha make the filter diverge.
+  struct settings
+  {
+    /// Weight of the position residual applied to the position estimate.
+    /// Must be within (0.0f, 1.0f].
+    float alpha = 0.5f;
+    /// Weight of the position residual applied to the velocity estimate.
+    float beta = 0.1f;
+    /// Weight of the position residual applied to the acceleration estimate.
+    float gamma = 0.01f;
+    /// Weight given to a velocity measurement when blending it with the
+    /// predicted velocity. Must be within [0.0f, 1.0f].
+    float velocity_gain = 0.3f;
+  };
+
+  /// Estimated motion at a point in time
+  struct state_t
+  {
+    /// Position in degrees
+    float position = 0.0f;
+    /// Velocity in degrees per second
+    float velocity = 0.0f;
+    /// Acceleration in degrees per second squared
+    float acceleration = 0.0f;
+  };
+
+  /**
+   * @brief Construct a new motion estimator
+   *
+   * @param p_frequency - frequency of the clock that produces the timestamps
+   * passed to this estimator
+   * @param p_settings - filter gains
+   */
+  motion_estimator(hal::hertz p_frequency, settings const& p_settings);
+
+  /**
+   * @brief Update the estimate with a position measurement
+   *
+   * The first position measurement initializes the position estimate.
+   *
+   * @param p_timestamp - clock ticks at which the measurement was received
+   * @param p_degrees - measured position
+   */
+  void update_position(std::uint64_t p_timestamp, float p_degrees);
+
+  /**
+   * @brief Update the estimate with a velocity measurement
+   *
+   * @param p_timestamp - clock ticks at which the measurement was received
+   * @param p_degrees_per_second - measured velocity
+   */
+  void update_velocity(std::uint64_t p_timestamp, float p_degrees_per_second);
+
+  /**
+   * @return state_t const& - estimated motion at the time of the last update
+   */
+  state_t const& state() const;
+
+  /**
+   * @brief Extrapolate the estimate to a point in time
+   *
+   * @param p_timestamp - clock ticks to extrapolate the state to. Timestamps
+   * before the last update return the state at the last update.
+   * @return state_t - the predicted motion
+   */
+  state_t extrapolate(std::uint64_t p_timestamp) const;
+
+  /**
+   * @return std::uint64_t - clock ticks of the last update
+   */
+  std::uint64_t last_update() const;
+
+  /**
+   * @return std::uint32_t - number of measurements fed into the estimator
+   */
+  std::uint32_t samples() const;
+
+  /**
+   * @brief Discard the estimate
+   *
+   * The next position measurement will re-initialize the estimator.
+   */
+  void reset();
+
+private:
+  float seconds_since_update(std::uint64_t p_timestamp) const;
+  void predict(std::uint64_t p_timestamp);
+
+  settings m_settings;
+  float m_frequency;
+  state_t m_state{};
+  std::uint64_t m_last_update = 0;
+  std::uint32_t m_samples = 0;
+  bool m_position_seeded = false;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,350 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include <libhal-canrouter/can_router.hpp>
+#include <libhal/can.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
+
+#include "drc.hpp"
+#include "mc_x.hpp"
+
+namespace hal::rmd {
+/**
+ * @brief Wire encoding of the motion commands of a motor model
+ *
+ * Each LSB size is the amount of the command field's unit, deg/s or deg, per
+ * least significant bit, as used by the runtime driver. The flags record
+ * which fields the runtime driver scales by the gear ratio, so both encode the
+ * same fields.
+ *
+ * @tparam driver - the runtime driver of the motor model, drc or mc_x
+ */
+template<class driver>
+struct motor_encoding;
+
+template<>
+struct motor_encoding<drc>
+{
+  /// deg/s per LSB of the speed field of a speed command
+  static constexpr float speed_lsb = 0.01f;
+  static constexpr bool speed_geared = true;
+  /// deg/s per LSB of the speed field of a position command
+  static constexpr float position_speed_lsb = 1.0f;
+  static constexpr bool position_speed_unsigned = false;
+  /// deg per LSB of the angle field of a position command
+  static constexpr float angle_lsb = 0.01f;
+  static constexpr bool angle_geared = true;
+  static constexpr hal::byte speed = 0xA2;
+  static constexpr hal::byte position = 0xA4;
+  static constexpr hal::byte incremental_position = 0xA8;
+};
+
+template<>
+struct motor_encoding<mc_x>
+{
+  /// deg/s per LSB of the speed field of a speed command
+  static constexpr float speed_lsb = 0.01f;
+  static constexpr bool speed_geared = false;
+  /// deg/s per LSB of the speed field of a position command
+  static constexpr float position_speed_lsb = 1.0f;
+  static constexpr bool position_speed_unsigned = true;
+  /// deg per LSB of the angle field of a position command
+  static constexpr float angle_lsb = 0.01f;
+  static constexpr bool angle_geared = false;
+  static constexpr hal::byte speed = 0xA2;
+  static constexpr hal::byte position = 0xA5;
+  static constexpr hal::byte incremental_position = 0xA8;
+};
+
+/**
+ * @brief A motor whose model, gear ratio and CAN ID are known at compile time
+ *
+ * The runtime drivers load the gear ratio from the object and encode through
+ * out of line conversion helpers. Here the gear ratio and unit constants are
+ * compile-time constants and the payload functions are constexpr, so encoding
+ * inlines into the caller. The fields are computed with the same float
+ * operations in the same order as the runtime drivers, so the frames are
+ * identical to theirs for every value that fits in the fields.
+ *
+ * The unit conversion and gear ratio are not folded into one integer
+ * multiplier per field. The arguments are floats, and the runtime drivers
+ * truncate after multiplying by the gear ratio and dividing by the LSB size.
+ * A folded scale rounds differently, such as 0.03 rpm at a gear ratio of 6
+ * encoding to 108 instead of drc's 107.
+ *
+ * Everything other than the motion commands, such as the adaptors, adaptive
+ * timeouts and stall detection, is available through `runtime()`.
+ *
+ * Usage:
+ *
+ *    hal::rmd::motor<hal::rmd::drc, 6, 0x141> shoulder(router, clock);
+ *    shoulder.velocity_control(10.0_rpm);
+ *
+ * @tparam driver - runtime driver of the motor model, drc or mc_x
+ * @tparam gear - gear ratio of the motor, the RMD lines use whole ratios
+ * @tparam device - CAN ID of the motor
+ */
+template<class driver, std::uint32_t gear, can::id_t device>
+class motor
+{
+public:
+  static_assert(gear > 0, "The gear ratio must be at least 1");
+
+  using encoding = motor_encoding<driver>;
+  using feedback_t = typename driver::feedback_t;
+  using read = typename driver::read;
+  using system = typename driver::system;
+
+  static constexpr std::uint32_t gear_ratio = gear;
+  static constexpr can::id_t device_id = device;
+
+  /// Gear ratio as the float the runtime driver holds
+  static constexpr float gear_factor = static_cast<float>(gear);
+
+  /**
+   * @brief Construct the motor and its runtime driver
+   *
+   * @param p_router - can router to use
+   * @param p_clock - clock used to determine timeouts
+   * @param p_arguments - remaining constructor arguments of the driver after
+   * the device ID, such as the max response time.
+   * @throws hal::timed_out - if the driver does not get a response at startup
+   */
+  template<class... arguments>
+  motor(hal::can_router& p_router,
+        hal::steady_clock& p_clock,
+        arguments&&... p_arguments)
+    : m_driver(p_router,
+               p_clock,
+               static_cast<float>(gear),
+               device,
+               std::forward<arguments>(p_arguments)...)
+  {
+  }
+
+  /**
+   * @brief Encode a speed command
+   *
+   * @param p_speed - speed of the output shaft
+   * @return constexpr std::array<hal::byte, 8> - the command payload
+   */
+  static constexpr std::array<hal::byte, 8> velocity_payload(rpm p_speed)
+  {
+    auto const speed = saturate(
+      to_lsb(p_speed * geared<encoding::speed_geared>(), encoding::speed_lsb));
+    return {
+      encoding::speed,
+      0x00,
+      0x00,
+      0x00,
+      byte_of(speed, 0),
+      byte_of(speed, 1),
+      byte_of(speed, 2),
+      byte_of(speed, 3),
+    };
+  }
+
+  /**
+   * @brief Encode an absolute position command
+   *
+   * @param p_angle - angle of the output shaft
+   * @param p_speed - maximum speed of the output shaft while moving
+   * @return constexpr std::array<hal::byte, 8> - the command payload
+   */
+  static constexpr std::array<hal::byte, 8> position_payload(degrees p_angle,
+                                                             rpm p_speed)
+  {
+    return positional(encoding::position, p_angle, p_speed);
+  }
+
+  /**
+   * @brief Encode an incremental position command
+   *
+   * @param p_angle - angle to move the output shaft by
+   * @param p_speed - maximum speed of the output shaft while moving
+   * @return constexpr std::array<hal::byte, 8> - the command payload
+   */
+  static constexpr std::array<hal::byte, 8> incremental_position_payload(
+    degrees p_angle,
+    rpm p_speed)
+  {
+    return positional(encoding::incremental_position, p_angle, p_speed);
+  }
+
+  /**
+   * @brief Rotate the motor shaft at the designated speed
+   *
+   * @param p_speed - speed of the output shaft
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time set at creation.
+   */
+  void velocity_control(rpm p_speed)
+  {
+    m_driver.send(velocity_payload(p_speed));
+  }
+
+  /**
+   * @brief Move the motor shaft to a specific angle
+   *
+   * @param p_angle - angle of the output shaft
+   * @param p_speed - maximum speed of the output shaft while moving
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time set at creation.
+   */
+  void position_control(degrees p_angle, rpm p_speed)
+  {
+    m_driver.send(position_payload(p_angle, p_speed));
+  }
+
+  /**
+   * @brief Move the motor shaft by an angle from its current position
+   *
+   * @param p_angle - angle to move the output shaft by
+   * @param p_speed - maximum speed of the output shaft while moving
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time set at creation.
+   */
+  void incremental_position_control(degrees p_angle, rpm p_speed)
+  {
+    m_driver.send(incremental_position_payload(p_angle, p_speed));
+  }
+
+  /**
+   * @brief Request feedback from the motor
+   *
+   * @param p_command - the request to command the motor to respond with
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time set at creation.
+   */
+  void feedback_request(read p_command)
+  {
+    m_driver.feedback_request(p_command);
+  }
+
+  /**
+   * @brief Send system control commands to the device
+   *
+   * @param p_system_command - system control command to send to the device
+   * @throws hal::timed_out - if a response is not returned within the max
+   * response time set at creation.
+   */
+  void system_control(system p_system_command)
+  {
+    m_driver.system_control(p_system_command);
+  }
+
+  /**
+   * @brief Send a command without waiting for the response
+   *
+   * @param p_payload - command to send to the motor
+   */
+  void transmit(std::array<hal::byte, 8> p_payload)
+  {
+    m_driver.transmit(p_payload);
+  }
+
+  /**
+   * @brief Get the latest feedback from the motor
+   *
+   * @return feedback_t const& - the latest feedback
+   */
+  feedback_t const& feedback() const
+  {
+    return m_driver.feedback();
+  }
+
+  /**
+   * @brief Access the runtime driver for everything else
+   *
+   * @return driver& - the runtime driver of this motor
+   */
+  driver& runtime()
+  {
+    return m_driver;
+  }
+
+private:
+  static constexpr std::int32_t saturate(float p_value)
+  {
+    // 2^31, the int32 limits are not representable as floats
+    constexpr float limit = 2147483648.0f;
+    if (p_value >= limit) {
+      return std::numeric_limits<std::int32_t>::max();
+    }
+    if (p_value < -limit) {
+      return std::numeric_limits<std::int32_t>::min();
+    }
+    if (p_value != p_value) {
+      return 0;
+    }
+    return static_cast<std::int32_t>(p_value);
+  }
+
+  static constexpr hal::byte byte_of(std::int32_t p_value, int p_index)
+  {
+    return static_cast<hal::byte>((p_value >> (8 * p_index)) & 0xFF);
+  }
+
+  /// Multiplier matching whether the runtime driver gears a field. Scaling by
+  /// 1.0f is exact, so ungeared fields are unchanged.
+  template<bool is_geared>
+  static constexpr float geared()
+  {
+    return is_geared ? gear_factor : 1.0f;
+  }
+
+  /// Convert a geared speed in rpm into LSBs of a speed field
+  static constexpr float to_lsb(rpm p_speed, float p_lsb)
+  {
+    using namespace hal::literals;
+    // Same constant and operation order as the runtime drivers
+    constexpr float dps_per_rpm = (1.0f / 1.0_deg_per_sec);
+    return (p_speed * dps_per_rpm) / p_lsb;
+  }
+
+  static constexpr std::array<hal::byte, 8> positional(hal::byte p_command,
+                                                       degrees p_angle,
+                                                       rpm p_speed)
+  {
+    auto geared_speed = p_speed * gear_factor;
+    if constexpr (encoding::position_speed_unsigned) {
+      geared_speed = geared_speed < 0.0f ? -geared_speed : geared_speed;
+    }
+    auto const speed =
+      saturate(to_lsb(geared_speed, encoding::position_speed_lsb));
+    auto const angle = saturate((p_angle * geared<encoding::angle_geared>()) /
+                                encoding::angle_lsb);
+    return {
+      p_command,
+      0x00,
+      byte_of(speed, 0),
+      byte_of(speed, 1),
+      byte_of(angle, 0),
+      byte_of(angle, 1),
+      byte_of(angle, 2),
+      byte_of(angle, 3),
+    };
+  }
+
+  driver m_driver;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,183 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <utility>
+
+#include <libhal/error.hpp>
+
+namespace hal::rmd {
+/**
+ * @brief Fixed capacity container that stores motors contiguously
+ *
+ * Motors are constructed in place within the bank, without heap allocation,
+ * so a control loop iterating the fleet walks a single array rather than
+ * chasing pointers to scattered objects. The address of a motor is stable for
+ * as long as the bank is not moved, so adaptors, `any_motor` handles and
+ * schedulers may refer to motors within the bank.
+ *
+ * Usage:
+ *
+ *    hal::rmd::motor_bank<hal::rmd::drc, 4> legs;
+ *    for (hal::can::id_t id = 0x141; id < 0x145; id++) {
+ *      legs.emplace(router, clock, 6.0f, id);
+ *    }
+ *    for (auto& leg : legs) {
+ *      leg.velocity_control(10.0_rpm);
+ *    }
+ *
+ * @tparam driver - type of motor driver to store, drc, mc_x or motor<>
+ * @tparam capacity - most motors the bank can hold
+ */
+template<class driver, std::size_t capacity>
+class motor_bank
+{
+public:
+  motor_bank() = default;
+
+  motor_bank(motor_bank&) = delete;
+  motor_bank& operator=(motor_bank&) = delete;
+
+  /**
+   * @brief Move every motor of another bank into this one
+   *
+   * Each motor is move constructed, re-binding its can router callback.
+   * Pointers to the motors of p_other are invalidated.
+   *
+   * @param p_other - bank to move the motors from, left empty
+   */
+  motor_bank(motor_bank&& p_other) noexcept
+  {
+    for (auto& motor : p_other) {
+      std::construct_at(slot(m_size++), std::move(motor));
+    }
+    p_other.clear();
+  }
+
+  motor_bank& operator=(motor_bank&& p_other) noexcept
+  {
+    if (this != &p_other) {
+      clear();
+      for (auto& motor : p_other) {
+        std::construct_at(slot(m_size++), std::move(motor));
+      }
+      p_other.clear();
+    }
+    return *this;
+  }
+
+  ~motor_bank()
+  {
+    clear();
+  }
+
+  /**
+   * @brief Construct a motor at the end of the bank
+   *
+   * @param p_arguments - constructor arguments of the motor
+   * @return driver& - the new motor
+   * @throws hal::argument_out_of_domain - if the bank is full
+   * @throws hal::timed_out - if the motor's constructor times out
+   */
+  template<class... arguments>
+  driver& emplace(arguments&&... p_arguments)
+  {
+    if (m_size >= capacity) {
+      throw hal::argument_out_of_domain(this);
+    }
+    auto* const motor =
+      std::construct_at(slot(m_size), std::forward<arguments>(p_arguments)...);
+    m_size++;
+    return *motor;
+  }
+
+  /// Destroy every motor, removing their can router callbacks
+  void clear() noexcept
+  {
+    while (m_size > 0) {
+      std::destroy_at(slot(--m_size));
+    }
+  }
+
+  driver& operator[](std::size_t p_index)
+  {
+    return *slot(p_index);
+  }
+
+  driver const& operator[](std::size_t p_index) const
+  {
+    return *slot(p_index);
+  }
+
+  driver* begin()
+  {
+    return slot(0);
+  }
+
+  driver* end()
+  {
+    return slot(m_size);
+  }
+
+  driver const* begin() const
+  {
+    return slot(0);
+  }
+
+  driver const* end() const
+  {
+    return slot(m_size);
+  }
+
+  /// The motors as a span, for APIs that take a range of motors
+  std::span<driver> motors()
+  {
+    return { begin(), m_size };
+  }
+
+  std::size_t size() const
+  {
+    return m_size;
+  }
+
+  bool full() const
+  {
+    return m_size == capacity;
+  }
+
+  static constexpr std::size_t max_size()
+  {
+    return capacity;
+  }
+
+private:
+  driver* slot(std::size_t p_index)
+  {
+    return reinterpret_cast<driver*>(m_storage + p_index * sizeof(driver));
+  }
+
+  driver const* slot(std::size_t p_index) const
+  {
+    return reinterpret_cast<driver const*>(m_storage +
+                                           p_index * sizeof(driver));
+  }
+
+  alignas(driver) std::byte m_storage[sizeof(driver) * capacity];
+  std::size_t m_size = 0;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,114 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal/units.hpp>
+
+namespace hal::rmd {
+/**
+ * @brief Reconstructs the multi-turn output shaft angle from encoder readings
+ *
+ * Status 2, speed and position replies carry the single turn position of the
+ * rotor encoder. Once seeded with an absolute multi-turn angle, this tracker
+ * unwraps the change in encoder position between replies and accumulates it,
+ * scaled by the gear ratio, onto the seeded angle. This gives a continuous
+ * output shaft angle without requesting the multi-turn angle every cycle.
+ *
+ * The rotor must turn less than half a revolution between two consecutive
+ * encoder readings, otherwise the direction of travel is ambiguous. Small
+ * errors accumulate over time, so the tracker should be re-seeded
+ * periodically, see `resync_due()`.
+ */
+class multi_turn_tracker
+{
+public:
+  struct settings
+  {
+    /// Number of encoder counts per rotor revolution
+    std::uint32_t counts_per_turn = 65536;
+    /// Number of encoder updates after which `resync_due()` returns true
+    std::uint32_t resync_interval = 100;
+  };
+
+  /**
+   * @brief Construct a new multi turn tracker
+   *
+   * @param p_gear_ratio - number of rotor revolutions per output shaft
+   * revolution
+   * @param p_settings - encoder resolution and resync interval
+   */
+  multi_turn_tracker(float p_gear_ratio, settings const& p_settings);
+
+  /**
+   * @brief Set the absolute output shaft angle
+   *
+   * The most recent encoder reading is used as the reference for the angle.
+   * If no encoder reading has been seen yet, the next one will be.
+   *
+   * @param p_angle - absolute multi-turn angle of the output shaft
+   */
+  void seed(hal::degrees p_angle);
+
+  /**
+   * @brief Accumulate the change in encoder position
+   *
+   * @param p_encoder - single turn rotor encoder position
+   */
+  void update(std::int16_t p_encoder);
+
+  /**
+   * @return true - the tracker has been seeded and has an encoder reference,
+   * making `angle()` valid
+   * @return false - the tracker is waiting for a seed or an encoder reading
+   */
+  bool tracking() const;
+
+  /**
+   * @return hal::degrees - multi-turn output shaft angle
+   */
+  hal::degrees angle() const;
+
+  /**
+   * @return true - the configured number of encoder updates has passed since
+   * the tracker was last seeded, or it has never been seeded
+   */
+  bool resync_due() const;
+
+  /**
+   * @return std::uint32_t - number of encoder updates since the last seed
+   */
+  std::uint32_t updates_since_seed() const;
+
+  /**
+   * @return hal::degrees - difference between the seeded angle and the
+   * tracked angle at the last seed. Indicates how much error accumulated
+   * between resyncs.
+   */
+  hal::degrees drift() const;
+
+private:
+  settings m_settings;
+  float m_degrees_per_count;
+  hal::degrees m_angle = 0.0f;
+  hal::degrees m_drift = 0.0f;
+  std::uint32_t m_last_encoder = 0;
+  std::uint32_t m_updates_since_seed = 0;
+  bool m_has_encoder = false;
+  bool m_seeded = false;
+  bool m_waiting_for_reference = false;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,96 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal/units.hpp>
+
+namespace hal::rmd {
+/**
+ * @brief Learns a response timeout from the observed round trip times
+ *
+ * Keeps an exponentially weighted mean and variance of the round trip time of
+ * a motor, similar to how TCP computes its retransmission timeout. The
+ * resulting timeout is `mean + k·σ` clamped between a floor and a ceiling.
+ * Each consecutive timeout doubles the returned timeout (up to the ceiling)
+ * until a response is observed again.
+ */
+class rtt_estimator
+{
+public:
+  struct settings
+  {
+    /// Shortest timeout that will be returned
+    hal::time_duration floor = std::chrono::microseconds(500);
+    /// Longest timeout that will be returned. Also used until the first round
+    /// trip time has been recorded.
+    hal::time_duration ceiling = std::chrono::milliseconds(10);
+    /// Number of standard deviations above the mean to place the timeout
+    float deviations = 4.0f;
+    /// Weight given to each new sample. Must be within (0.0f, 1.0f].
+    float gain = 0.125f;
+  };
+
+  /**
+   * @brief Construct a new rtt estimator
+   *
+   * @param p_settings - bounds and tuning of the estimator
+   */
+  rtt_estimator(settings const& p_settings);
+
+  /**
+   * @brief Record the round trip time of a successful request
+   *
+   * @param p_round_trip_time - time between sending a request and receiving
+   * its response.
+   */
+  void record(hal::time_duration p_round_trip_time);
+
+  /**
+   * @brief Record that a request did not receive a response in time
+   *
+   */
+  void record_timeout();
+
+  /**
+   * @return hal::time_duration - amount of time to wait for the next response
+   */
+  hal::time_duration timeout() const;
+
+  /**
+   * @return hal::time_duration - smoothed mean round trip time
+   */
+  hal::time_duration mean() const;
+
+  /**
+   * @return hal::time_duration - smoothed standard deviation of the round trip
+   * time
+   */
+  hal::time_duration deviation() const;
+
+  /**
+   * @return std::uint32_t - number of round trip times recorded
+   */
+  std::uint32_t samples() const;
+
+private:
+  settings m_settings;
+  float m_mean_ns = 0.0f;
+  float m_variance_ns = 0.0f;
+  std::uint32_t m_samples = 0;
+  std::uint8_t m_backoff = 0;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,185 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <variant>
+
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
+
+#include "drc.hpp"
+#include "mc_x.hpp"
+
+namespace hal::rmd {
+/**
+ * @brief Priority aware transmit scheduler for RMD motors sharing a bus
+ *
+ * Commands are queued by priority class and transmitted one at a time by
+ * `service()`, which never blocks. A command is considered complete when its
+ * motor responds with the same command byte or the response timeout elapses.
+ * Higher priority commands are always transmitted before lower priority
+ * commands, and emergency commands do not wait for the response of an in
+ * flight command of lower priority. A late response to a preempted command is
+ * not mistaken for the response to the command that preempted it.
+ *
+ * One scheduler should be used per can router. This class is not thread safe
+ * and is meant for cooperative control loops that call `service()`
+ * repeatedly.
+ */
+class scheduler
+{
+public:
+  /// Priority classes, lowest value is transmitted first
+  enum class priority : hal::byte
+  {
+    /// system::off and system::stop commands
+    emergency = 0,
+    /// Velocity, position and torque commands
+    setpoint = 1,
+    /// Feedback requests
+    telemetry = 2,
+    /// Everything else, such as configuration writes
+    configuration = 3,
+  };
+
+  /// Number of priority classes
+  static constexpr std::size_t priority_levels = 4;
+  /// Number of commands each priority class can hold
+  static constexpr std::size_t queue_depth = 16;
+
+  /// Motor a command will be sent to
+  using motor_t = std::variant<drc*, mc_x*>;
+
+  /// Counters describing the work performed by the scheduler
+  struct stats_t
+  {
+    /// Number of commands transmitted
+    std::uint32_t sent = 0;
+    /// Number of commands that received a response
+    std::uint32_t completed = 0;
+    /// Number of commands that did not receive a response in time
+    std::uint32_t timeouts = 0;
+    /// Number of in flight commands that stopped being waited on because an
+    /// emergency command was submitted.
+    std::uint32_t preempted = 0;
+  };
+
+  /**
+   * @brief Determine the priority class of a RMD command byte
+   *
+   * @param p_command - the first byte of a command payload
+   * @return priority - priority class of the command
+   */
+  static priority classify(hal::byte p_command);
+
+  /**
+   * @brief Construct a new scheduler
+   *
+   * @param p_clock - clock used to determine timeouts
+   * @param p_response_timeout - maximum amount of time to wait for a response
+   * to a command before moving on to the next command.
+   */
+  scheduler(hal::steady_clock& p_clock,
+            hal::time_duration p_response_timeout =
+              std::chrono::milliseconds(10));
+
+  /**
+   * @brief Queue a command for a motor
+   *
+   * @param p_motor - motor to send the command to. The motor's lifetime must
+   * exceed the time the command spends in the scheduler.
+   * @param p_payload - command to send to the motor
+   * @param p_priority - priority class of the command
+   * @return true - command was queued
+   * @return false - the queue for this priority class is full
+   */
+  bool submit(motor_t p_motor,
+              std::array<hal::byte, 8> p_payload,
+              priority p_priority);
+
+  /**
+   * @brief Queue a command for a motor using the priority of its command byte
+   *
+   * @param p_motor - motor to send the command to. The motor's lifetime must
+   * exceed the time the command spends in the scheduler.
+   * @param p_payload - command to send to the motor
+   * @return true - command was queued
+   * @return false - the queue for this priority class is full
+   */
+  bool submit(motor_t p_motor, std::array<hal::byte, 8> p_payload);
+
+  /**
+   * @brief Make progress on the queued commands without blocking
+   *
+   * Checks if the in flight command has completed and, if so, transmits the
+   * next highest priority command.
+   *
+   * @return true - there is still work to be done
+   * @return false - all queued commands have completed
+   */
+  bool service();
+
+  /**
+   * @brief Block until every queued command has completed
+   *
+   */
+  void flush();
+
+  /**
+   * @param p_priority - priority class to inspect
+   * @return std::size_t - number of commands waiting to be transmitted
+   */
+  std::size_t pending(priority p_priority) const;
+
+  /**
+   * @return true - no command is in flight and no commands are queued
+   * @return false - the scheduler still has work to do
+   */
+  bool idle() const;
+
+  /**
+   * @return stats_t const& - counters describing the work performed so far
+   */
+  stats_t const& stats() const;
+
+private:
+  struct entry_t
+  {
+    motor_t motor;
+    std::array<hal::byte, 8> payload;
+  };
+
+  struct queue_t
+  {
+    std::array<entry_t, queue_depth> entries{};
+    std::uint8_t head = 0;
+    std::uint8_t count = 0;
+  };
+
+  bool in_flight_finished();
+
+  std::array<queue_t, priority_levels> m_queues{};
+  hal::steady_clock* m_clock;
+  hal::time_duration m_response_timeout;
+  std::uint64_t m_deadline = 0;
+  motor_t m_in_flight{};
+  std::uint32_t m_snapshot = 0;
+  priority m_in_flight_priority = priority::configuration;
+  bool m_busy = false;
+  stats_t m_stats{};
+};
+}  // namespace hal::rmd
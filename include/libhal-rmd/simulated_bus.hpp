@@ -0,0 +1,195 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include <libhal/can.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
+
+namespace hal::rmd {
+/**
+ * @brief A simulated CAN bus with bit accurate frame timing
+ *
+ * The bus connects a host port, which the drivers use like any other
+ * `hal::can`, to any number of simulated RMD motors. Each frame occupies the
+ * bus for the number of bit times computed by `bus_planner::frame_bits()`.
+ * When the bus goes idle, every node with a frame ready to send arbitrates
+ * and the frame with the lowest ID wins, just as on a real bus. Motors echo
+ * each request back on their reply ID after a configurable processing delay.
+ *
+ * The bus is also the clock of the simulation. Virtual time only advances
+ * when the clock is read, which is what every busy wait in the drivers does,
+ * so the results are deterministic and independent of the host machine.
+ * Used by the bus level benchmarks and suitable for host side tests.
+ */
+class simulated_bus : public hal::steady_clock
+{
+public:
+  struct settings
+  {
+    /// Bit rate of the bus
+    hal::hertz baudrate = 1'000'000.0f;
+    /// Charge every frame the most stuff bits it could need instead of none
+    bool worst_case_stuffing = false;
+    /// Virtual time that passes each time the clock is read, models the time
+    /// the host spends between polls of the clock.
+    std::uint64_t poll_ns = 1'000;
+    /// Seed of the generator used for processing jitter
+    std::uint32_t seed = 1;
+  };
+
+  /// A simulated motor
+  struct device_t
+  {
+    /// ID the motor listens on
+    can::id_t id = 0;
+    /// ID the motor replies on, equal to the ID for DRC motors and the ID
+    /// plus 0x100 for MC-X motors.
+    can::id_t reply_id = 0;
+    /// Time between the end of a request and the reply being ready to send
+    std::uint64_t processing_ns = 50'000;
+    /// Upper bound of a uniformly distributed extra processing delay
+    std::uint64_t jitter_ns = 0;
+    /// Additional ID the motor listens on, such as the MC-X multi motor
+    /// command ID.
+    std::optional<can::id_t> broadcast_id = std::nullopt;
+  };
+
+  /// Counters describing the traffic on the bus
+  struct stats_t
+  {
+    /// Number of frames transmitted by the host
+    std::uint64_t host_frames = 0;
+    /// Number of frames transmitted by motors
+    std::uint64_t device_frames = 0;
+    /// Nanoseconds the bus spent transmitting frames
+    std::uint64_t busy_ns = 0;
+    /// Number of times a ready frame lost arbitration to a lower ID
+    std::uint64_t arbitration_losses = 0;
+    /// Longest time a frame waited between being ready and being transmitted
+    std::uint64_t worst_access_ns = 0;
+  };
+
+  /**
+   * @brief Construct a new 1 Mbit/s simulated bus with no motors
+   */
+  simulated_bus();
+
+  /**
+   * @brief Construct a new simulated bus with no motors
+   *
+   * @param p_settings - bit timing and clock behavior
+   */
+  simulated_bus(settings const& p_settings);
+
+  simulated_bus(simulated_bus&) = delete;
+  simulated_bus& operator=(simulated_bus&) = delete;
+
+  /**
+   * @brief Add a simulated motor to the bus
+   *
+   * @param p_device - IDs and processing delay of the motor
+   */
+  void add_device(device_t const& p_device);
+
+  /**
+   * @return hal::can& - port of the host, pass this to the can router
+   */
+  hal::can& host();
+
+  /**
+   * @brief Advance virtual time, delivering every frame completed on the way
+   *
+   * @param p_nanoseconds - amount of time to advance
+   */
+  void advance(std::uint64_t p_nanoseconds);
+
+  /**
+   * @return std::uint64_t - current virtual time in nanoseconds
+   */
+  std::uint64_t now() const;
+
+  /**
+   * @param p_length - payload length of the frame
+   * @return std::uint64_t - nanoseconds the frame occupies the bus
+   */
+  std::uint64_t frame_ns(std::uint8_t p_length) const;
+
+  /**
+   * @return float - fraction of the elapsed virtual time the bus was busy
+   */
+  float utilization() const;
+
+  /**
+   * @return stats_t const& - traffic counters since construction
+   */
+  stats_t const& stats() const;
+
+private:
+  class host_port : public hal::can
+  {
+  public:
+    host_port(simulated_bus& p_bus);
+
+  private:
+    void driver_configure(settings const& p_settings) override;
+    void driver_bus_on() override;
+    void driver_send(message_t const& p_message) override;
+    void driver_on_receive(hal::callback<handler> p_handler) override;
+
+    simulated_bus* m_bus;
+  };
+
+  struct pending_t
+  {
+    std::uint64_t ready_at;
+    can::message_t message;
+  };
+
+  struct node_t
+  {
+    device_t device;
+    std::deque<pending_t> queue;
+  };
+
+  hal::hertz driver_frequency() override;
+  std::uint64_t driver_uptime() override;
+
+  void advance_to(std::uint64_t p_time);
+  bool start_next_frame(std::uint64_t p_limit);
+  void finish_frame();
+  std::uint64_t jitter(std::uint64_t p_bound);
+
+  settings m_settings;
+  host_port m_host;
+  hal::callback<hal::can::handler> m_receive = [](can::message_t const&) {};
+  /// Node 0 is the host, the rest are motors
+  std::vector<node_t> m_nodes;
+  stats_t m_stats{};
+  std::uint64_t m_now = 0;
+  /// Time at which the last frame ended
+  std::uint64_t m_idle_at = 0;
+  /// Index of the node transmitting, if the bus is busy
+  std::optional<std::size_t> m_sender{};
+  std::uint64_t m_busy_until = 0;
+  std::uint32_t m_random;
+  bool m_advancing = false;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,101 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal/units.hpp>
+
+namespace hal::rmd {
+/**
+ * @brief Detects a stalled or overloaded motor from its current and speed
+ *
+ * A motor is considered stalled when it has been commanded to move, yet its
+ * speed stays near zero while its current stays high for longer than a
+ * window of time. Fed from every reply that carries speed and current, so a
+ * stall is detected within a few control cycles rather than waiting for the
+ * motor to report its own stall flag.
+ */
+class stall_detector
+{
+public:
+  struct settings
+  {
+    /// Speeds with a magnitude at or below this are considered stationary
+    hal::rpm speed_threshold = 1.0f;
+    /// Currents with a magnitude at or above this are considered high
+    hal::ampere current_threshold = 2.0f;
+    /// How long the motor must look stalled before a stall is reported
+    hal::time_duration window = std::chrono::milliseconds(50);
+    /// Send system::stop to the motor as soon as a stall is detected
+    bool stop_on_stall = false;
+  };
+
+  /**
+   * @brief Construct a new stall detector
+   *
+   * @param p_frequency - frequency of the clock that produces the timestamps
+   * passed to this detector
+   * @param p_settings - thresholds and window of the detector
+   */
+  stall_detector(hal::hertz p_frequency, settings const& p_settings);
+
+  /**
+   * @brief Record the speed the motor was commanded to move at
+   *
+   * A command of zero disables detection until the next non-zero command.
+   *
+   * @param p_speed - commanded speed, or the max speed of a position command
+   */
+  void command(hal::rpm p_speed);
+
+  /**
+   * @brief Update the detector with a speed and current measurement
+   *
+   * @param p_timestamp - clock ticks at which the measurement was received
+   * @param p_speed - measured speed
+   * @param p_current - measured current
+   * @return true - the motor just became stalled
+   * @return false - the motor is not stalled or was already stalled
+   */
+  bool update(std::uint64_t p_timestamp,
+              hal::rpm p_speed,
+              hal::ampere p_current);
+
+  /**
+   * @return true - the motor is currently stalled
+   */
+  bool stalled() const;
+
+  /**
+   * @return std::uint32_t - number of stalls detected
+   */
+  std::uint32_t stalls() const;
+
+  /**
+   * @return settings const& - thresholds and window of the detector
+   */
+  settings const& configuration() const;
+
+private:
+  settings m_settings;
+  std::uint64_t m_window_ticks;
+  std::uint64_t m_suspect_since = 0;
+  std::uint32_t m_stalls = 0;
+  bool m_commanded = false;
+  bool m_suspect = false;
+  bool m_stalled = false;
+};
+}  // namespace hal::rmd
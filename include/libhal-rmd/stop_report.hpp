@@ -0,0 +1,34 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal/units.hpp>
+
+namespace hal::rmd {
+/// Outcome of stopping many motors at once
+struct stop_report
+{
+  /// Time from transmitting the first stop frame until every motor
+  /// acknowledged the stop or the final retry timed out.
+  hal::time_duration latency{};
+  /// Number of stop frames transmitted, including retries
+  std::uint32_t frames_sent = 0;
+  /// Bit mask of the motors, by their index in the list of motors passed in,
+  /// that never acknowledged the stop.
+  std::uint32_t unacknowledged = 0;
+};
+}  // namespace hal::rmd
@@ -0,0 +1,183 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal/functional.hpp>
+#include <libhal/units.hpp>
+
+#include "drc.hpp"
+#include "mc_x.hpp"
+
+namespace hal::rmd {
+/// One feedback sample of a motor as stored in a telemetry log
+struct telemetry_sample
+{
+  enum class model_t : std::uint8_t
+  {
+    drc = 0,
+    mc_x = 1,
+  };
+
+  /// Uptime of the logging clock in ticks
+  std::uint64_t timestamp = 0;
+  can::id_t device_id = 0;
+  model_t model = model_t::drc;
+  std::uint32_t message_number = 0;
+  std::int64_t raw_multi_turn_angle = 0;
+  std::int16_t raw_current = 0;
+  std::int16_t raw_speed = 0;
+  std::int16_t raw_volts = 0;
+  std::int16_t encoder = 0;
+  std::int8_t raw_motor_temperature = 0;
+  std::uint16_t raw_error_state = 0;
+
+  bool operator==(telemetry_sample const&) const = default;
+};
+
+/**
+ * @brief Streams motor feedback into a compact binary log
+ *
+ * Each record is encoded against the previous record of the same motor. The
+ * timestamp and message number are stored as unsigned deltas and the
+ * remaining fields as zigzag encoded deltas, all as LEB128 varints, so a
+ * motor that barely moved costs only a few bytes. Fields are split into
+ * groups and a group is only stored when one of its fields changed:
+ *
+ *    angle  - raw_multi_turn_angle, encoder
+ *    motion - raw_speed, raw_current
+ *    power  - raw_volts, raw_motor_temperature
+ *    error  - raw_error_state
+ *
+ * The first record of each motor is a key record that carries the CAN ID and
+ * model of the motor and every group. The log starts with a 5 byte header of
+ * "RMDL" and the format version.
+ */
+class telemetry_log_writer
+{
+public:
+  /// Receives each encoded chunk of the log
+  using sink_t = hal::callback<void(std::span<hal::byte const>)>;
+
+  /// Most motors a single log can hold
+  static constexpr std::size_t max_motors = 32;
+  /// Largest number of bytes a single record can take
+  static constexpr std::size_t max_record_size = 64;
+
+  /**
+   * @brief Construct a new log writer
+   *
+   * The header of the log is written to the sink immediately.
+   *
+   * @param p_sink - destination for the log bytes
+   */
+  telemetry_log_writer(sink_t p_sink);
+
+  telemetry_log_writer(telemetry_log_writer&) = delete;
+  telemetry_log_writer& operator=(telemetry_log_writer&) = delete;
+
+  /**
+   * @brief Append a sample to the log
+   *
+   * @param p_sample - sample to append
+   * @throws hal::argument_out_of_domain - if the sample is from a motor that
+   * would exceed max_motors.
+   */
+  void write(telemetry_sample const& p_sample);
+
+  /**
+   * @brief Append the feedback of a DRC motor to the log
+   *
+   * @param p_timestamp - uptime of the logging clock in ticks
+   * @param p_device_id - CAN ID of the motor
+   * @param p_feedback - feedback to append
+   */
+  void write(std::uint64_t p_timestamp,
+             can::id_t p_device_id,
+             drc::feedback_t const& p_feedback);
+
+  /**
+   * @brief Append the feedback of a MC-X motor to the log
+   *
+   * @param p_timestamp - uptime of the logging clock in ticks
+   * @param p_device_id - CAN ID of the motor
+   * @param p_feedback - feedback to append
+   */
+  void write(std::uint64_t p_timestamp,
+             can::id_t p_device_id,
+             mc_x::feedback_t const& p_feedback);
+
+  /**
+   * @return std::uint64_t - number of bytes written including the header
+   */
+  std::uint64_t bytes() const;
+
+  /**
+   * @return std::uint64_t - number of samples written
+   */
+  std::uint64_t samples() const;
+
+private:
+  sink_t m_sink;
+  std::array<telemetry_sample, max_motors> m_previous{};
+  std::size_t m_motors = 0;
+  std::uint64_t m_bytes = 0;
+  std::uint64_t m_samples = 0;
+};
+
+/**
+ * @brief Decodes a log written by telemetry_log_writer
+ */
+class telemetry_log_reader
+{
+public:
+  /**
+   * @brief Construct a new log reader
+   *
+   * @param p_log - the complete log, must outlive the reader
+   * @throws hal::io_error - if the log does not start with a valid header
+   */
+  telemetry_log_reader(std::span<hal::byte const> p_log);
+
+  /**
+   * @brief Decode the next sample of the log
+   *
+   * A log whose last record was cut short, such as by a power loss while
+   * logging, ends at the last complete record. Check `truncated()`.
+   *
+   * @return std::optional<telemetry_sample> - the next sample or std::nullopt
+   * at the end of the log.
+   * @throws hal::io_error - if a record refers to a motor that has no key
+   * record.
+   */
+  std::optional<telemetry_sample> next();
+
+  /**
+   * @return true - the log ended in the middle of a record
+   */
+  bool truncated() const;
+
+private:
+  std::span<hal::byte const> m_log;
+  std::size_t m_offset = 0;
+  std::array<telemetry_sample, telemetry_log_writer::max_motors> m_previous{};
+  std::size_t m_motors = 0;
+  bool m_truncated = false;
+};
+}  // namespace hal::rmd
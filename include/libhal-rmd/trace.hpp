@@ -0,0 +1,62 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal/can.hpp>
+#include <libhal/units.hpp>
+
+#if !defined(LIBHAL_RMD_TRACE)
+#define LIBHAL_RMD_TRACE 0
+#endif
+
+namespace hal::rmd {
+/// Events emitted by the drc and mc_x drivers when tracing is enabled
+enum class trace_event : hal::byte
+{
+  /// A command frame was transmitted to a motor
+  frame_sent,
+  /// A reply from a motor was decoded into its feedback
+  reply_decoded,
+  /// A blocking command did not receive a reply in time
+  timeout,
+};
+
+/// True when the library was built with LIBHAL_RMD_TRACE=1
+inline constexpr bool trace_enabled = LIBHAL_RMD_TRACE != 0;
+
+/**
+ * @brief Link time hook called by the drc and mc_x drivers on trace events
+ *
+ * Only called when the library is built with the `LIBHAL_RMD_TRACE` CMake
+ * option turned on. The library provides a weak definition that does nothing,
+ * define this function in the application to receive the events. When tracing
+ * is off, the calls and the clock reads that produce their timestamps are
+ * removed at compile time.
+ *
+ * This may be called from the can receive interrupt, so keep it short, such
+ * as forwarding to a `chrome_trace_writer` that writes to a ring buffer.
+ *
+ * @param p_event - the event that occurred
+ * @param p_device_id - CAN ID of the motor the event is associated with
+ * @param p_command - command byte of the frame associated with the event
+ * @param p_timestamp - uptime of the motor driver's clock in ticks
+ */
+void trace(trace_event p_event,
+           can::id_t p_device_id,
+           hal::byte p_command,
+           std::uint64_t p_timestamp) noexcept;
+}  // namespace hal::rmd
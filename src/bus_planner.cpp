@@ -0,0 +1,110 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/bus_planner.hpp>
+
+#include <algorithm>
+
+#include "drc_constants.hpp"
+
+namespace hal::rmd {
+namespace {
+/// SOF, 11-bit ID, RTR, IDE, r0 and DLC
+constexpr std::uint32_t standard_header_bits = 19;
+/// SOF, 11-bit ID, SRR, IDE, 18-bit ID, RTR, r1, r0 and DLC
+constexpr std::uint32_t extended_header_bits = 39;
+/// CRC sequence
+constexpr std::uint32_t crc_bits = 15;
+/// CRC delimiter, ACK slot, ACK delimiter, end of frame and interframe space
+constexpr std::uint32_t trailer_bits = 1 + 2 + 7 + 3;
+/// Bit stuffing inserts a bit after every 5 identical bits, in the worst case
+/// after the first 5 bits then every 4 bits after that.
+constexpr std::uint32_t stuff_bits(std::uint32_t p_stuffable_bits)
+{
+  return (p_stuffable_bits - 1) / 4;
+}
+}  // namespace
+
+std::uint32_t bus_planner::frame_bits(std::uint8_t p_length,
+                                      bool p_extended,
+                                      bool p_worst_case_stuffing)
+{
+  auto const data_bits = std::min<std::uint32_t>(p_length, 8) * 8;
+  auto const header = p_extended ? extended_header_bits : standard_header_bits;
+  auto const stuffable = header + data_bits + crc_bits;
+  auto const stuffing = p_worst_case_stuffing ? stuff_bits(stuffable) : 0;
+
+  return stuffable + stuffing + trailer_bits;
+}
+
+bus_planner::bus_planner(settings const& p_settings)
+  : m_settings(p_settings)
+{
+  if (m_settings.baudrate <= 0.0f) {
+    m_settings.baudrate = baudrate_hz;
+  }
+}
+
+float bus_planner::utilization(stream_t const& p_stream) const
+{
+  auto const bits = frame_bits(p_stream.length,
+                               p_stream.extended,
+                               m_settings.worst_case_stuffing);
+  auto const frames = 1.0f + static_cast<float>(p_stream.replies);
+  auto const bits_per_second =
+    static_cast<float>(bits) * frames * p_stream.rate;
+
+  return bits_per_second / m_settings.baudrate;
+}
+
+bool bus_planner::admit(stream_t const& p_stream)
+{
+  if (m_count >= max_streams) {
+    return false;
+  }
+
+  auto const load = utilization(p_stream);
+  if (m_utilization + load > m_settings.utilization_limit) {
+    return false;
+  }
+
+  m_streams[m_count++] = p_stream;
+  m_utilization += load;
+  return true;
+}
+
+float bus_planner::utilization() const
+{
+  return m_utilization;
+}
+
+hal::hertz bus_planner::achievable_rate(std::size_t p_index) const
+{
+  auto const& stream = m_streams[p_index];
+  if (m_utilization <= 0.0f) {
+    return stream.rate;
+  }
+  return stream.rate * (m_settings.utilization_limit / m_utilization);
+}
+
+std::size_t bus_planner::size() const
+{
+  return m_count;
+}
+
+bus_planner::stream_t const& bus_planner::operator[](std::size_t p_index) const
+{
+  return m_streams[p_index];
+}
+}  // namespace hal::rmd
@@ -0,0 +1,492 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/can_trace.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+
+#include <libhal/error.hpp>
+
+namespace hal::rmd {
+namespace {
+constexpr std::array<hal::byte, 4> trace_magic{ 'R', 'M', 'D', 'T' };
+constexpr hal::byte direction_flag = 1 << 0;
+constexpr hal::byte remote_request_flag = 1 << 1;
+constexpr hal::byte extended_id_flag = 1 << 2;
+constexpr hal::byte length_shift = 4;
+/// Largest standard (11-bit) CAN ID
+constexpr can::id_t max_standard_id = 0x7FF;
+constexpr char hex_digits[] = "0123456789ABCDEF";
+}  // namespace
+
+std::array<hal::byte, trace_header_size> encode_trace_header(
+  hal::hertz p_frequency)
+{
+  auto const frequency = std::bit_cast<std::uint32_t>(p_frequency);
+  return {
+    trace_magic[0],
+    trace_magic[1],
+    trace_magic[2],
+    trace_magic[3],
+    trace_version,
+    static_cast<hal::byte>((frequency >> 0) & 0xFF),
+    static_cast<hal::byte>((frequency >> 8) & 0xFF),
+    static_cast<hal::byte>((frequency >> 16) & 0xFF),
+    static_cast<hal::byte>((frequency >> 24) & 0xFF),
+  };
+}
+
+std::span<hal::byte> encode_trace_record(trace_record const& p_record,
+                                         std::uint64_t p_previous_timestamp,
+                                         std::span<hal::byte> p_buffer)
+{
+  if (p_buffer.size() < max_trace_record_size) {
+    throw hal::argument_out_of_domain(nullptr);
+  }
+
+  auto const& message = p_record.message;
+  auto const length = std::min<std::uint8_t>(message.length, 8);
+  auto const extended = message.id > max_standard_id;
+  std::size_t offset = 0;
+
+  auto delta = p_record.timestamp - p_previous_timestamp;
+  do {
+    auto septet = static_cast<hal::byte>(delta & 0x7F);
+    delta >>= 7;
+    if (delta != 0) {
+      septet |= 0x80;
+    }
+    p_buffer[offset++] = septet;
+  } while (delta != 0);
+
+  hal::byte flags = static_cast<hal::byte>(length << length_shift);
+  if (p_record.direction == trace_direction::receive) {
+    flags |= direction_flag;
+  }
+  if (message.is_remote_request) {
+    flags |= remote_request_flag;
+  }
+  if (extended) {
+    flags |= extended_id_flag;
+  }
+  p_buffer[offset++] = flags;
+
+  auto const id_bytes = extended ? 4 : 2;
+  for (int i = 0; i < id_bytes; i++) {
+    auto const id_byte = (message.id >> (i * 8)) & 0xFF;
+    p_buffer[offset++] = static_cast<hal::byte>(id_byte);
+  }
+
+  std::copy_n(message.payload.begin(), length, p_buffer.begin() + offset);
+  offset += length;
+
+  return p_buffer.first(offset);
+}
+
+std::string_view format_candump(trace_record const& p_record,
+                                hal::hertz p_frequency,
+                                std::span<char> p_buffer,
+                                std::string_view p_interface)
+{
+  // "(" + 10 digit seconds + "." + 6 digit microseconds + ") " + interface +
+  // " " + 8 digit id + "#" + 16 payload digits + "\n"
+  auto const required = 1 + 10 + 1 + 6 + 2 + p_interface.size() + 1 + 8 + 1 +
+                        (2 * p_record.message.payload.size()) + 1;
+  if (p_buffer.size() < required) {
+    throw hal::argument_out_of_domain(nullptr);
+  }
+
+  // Also rejects NaN. Lower frequencies would truncate to a zero divisor.
+  if (not(p_frequency >= 1.0f)) {
+    throw hal::argument_out_of_domain(nullptr);
+  }
+
+  auto const frequency = static_cast<std::uint64_t>(p_frequency);
+  auto const seconds = p_record.timestamp / frequency;
+  auto const microseconds =
+    ((p_record.timestamp % frequency) * 1'000'000) / frequency;
+
+  char* cursor = p_buffer.data();
+  auto const zero_padded = [&cursor](std::uint64_t p_value, int p_width) {
+    for (int i = p_width - 1; i >= 0; i--) {
+      cursor[i] = static_cast<char>('0' + (p_value % 10));
+      p_value /= 10;
+    }
+    cursor += p_width;
+  };
+  auto const hex = [&cursor](std::uint32_t p_value, int p_digits) {
+    for (int i = p_digits - 1; i >= 0; i--) {
+      *cursor++ = hex_digits[(p_value >> (i * 4)) & 0xF];
+    }
+  };
+
+  *cursor++ = '(';
+  zero_padded(seconds, 10);
+  *cursor++ = '.';
+  zero_padded(microseconds, 6);
+  *cursor++ = ')';
+  *cursor++ = ' ';
+  cursor = std::copy(p_interface.begin(), p_interface.end(), cursor);
+  *cursor++ = ' ';
+
+  auto const& message = p_record.message;
+  hex(message.id, message.id > max_standard_id ? 8 : 3);
+  *cursor++ = '#';
+
+  if (message.is_remote_request) {
+    *cursor++ = 'R';
+  } else {
+    auto const length = std::min<std::uint8_t>(message.length, 8);
+    for (std::size_t i = 0; i < length; i++) {
+      hex(message.payload[i], 2);
+    }
+  }
+  *cursor++ = '\n';
+
+  auto const size = static_cast<std::size_t>(cursor - p_buffer.data());
+  return { p_buffer.data(), size };
+}
+
+std::optional<trace_record> parse_candump(std::string_view p_line)
+{
+  while (not p_line.empty() &&
+         (p_line.back() == '\n' || p_line.back() == '\r')) {
+    p_line.remove_suffix(1);
+  }
+
+  auto const close = p_line.find(')');
+  auto const dot = p_line.find('.');
+  if (p_line.empty() || p_line.front() != '(' || close == p_line.npos ||
+      dot == p_line.npos || close < dot) {
+    return std::nullopt;
+  }
+
+  std::uint64_t seconds = 0;
+  auto const* const seconds_end = p_line.data() + dot;
+  if (std::from_chars(p_line.data() + 1, seconds_end, seconds).ptr !=
+      seconds_end) {
+    return std::nullopt;
+  }
+
+  // Scale the fraction to microseconds regardless of its number of digits
+  std::uint64_t microseconds = 0;
+  std::size_t digits = 0;
+  for (auto const digit : p_line.substr(dot + 1, close - dot - 1)) {
+    if (digit < '0' || '9' < digit) {
+      return std::nullopt;
+    }
+    if (digits < 6) {
+      microseconds =
+        microseconds * 10 + static_cast<std::uint64_t>(digit - '0');
+      digits++;
+    }
+  }
+  for (; digits < 6; digits++) {
+    microseconds *= 10;
+  }
+
+  // The interface name and the frame follow, separated by spaces
+  auto const next_token = [&p_line](std::size_t p_from) {
+    auto const start = p_line.find_first_not_of(' ', p_from);
+    if (start == p_line.npos) {
+      return p_line.substr(p_line.size());
+    }
+    return p_line.substr(start, p_line.find(' ', start) - start);
+  };
+  auto const interface = next_token(close + 1);
+  auto const frame = next_token(
+    static_cast<std::size_t>(interface.data() - p_line.data()) +
+    interface.size());
+
+  auto const hash = frame.find('#');
+  if (interface.empty() || hash == frame.npos || hash == 0 || hash > 8) {
+    return std::nullopt;
+  }
+
+  auto const hex_value = [](char p_digit) -> int {
+    if ('0' <= p_digit && p_digit <= '9') {
+      return p_digit - '0';
+    }
+    if ('A' <= p_digit && p_digit <= 'F') {
+      return p_digit - 'A' + 10;
+    }
+    if ('a' <= p_digit && p_digit <= 'f') {
+      return p_digit - 'a' + 10;
+    }
+    return -1;
+  };
+
+  trace_record record{
+    .timestamp = seconds * 1'000'000 + microseconds,
+    .direction = trace_direction::receive,
+    .message = {},
+  };
+
+  for (auto const digit : frame.substr(0, hash)) {
+    auto const value = hex_value(digit);
+    if (value < 0) {
+      return std::nullopt;
+    }
+    record.message.id =
+      (record.message.id << 4) | static_cast<can::id_t>(value);
+  }
+
+  auto const data = frame.substr(hash + 1);
+  if (not data.empty() && (data.front() == 'R' || data.front() == 'r')) {
+    record.message.is_remote_request = true;
+    return record;
+  }
+
+  // CAN FD frames ("##") and odd or oversized payloads are rejected
+  if (data.size() % 2 != 0 || data.size() > 2 * 8) {
+    return std::nullopt;
+  }
+  for (std::size_t i = 0; i < data.size(); i += 2) {
+    auto const high = hex_value(data[i]);
+    auto const low = hex_value(data[i + 1]);
+    if (high < 0 || low < 0) {
+      return std::nullopt;
+    }
+    record.message.payload[i / 2] = static_cast<hal::byte>(high << 4 | low);
+  }
+  record.message.length = static_cast<std::uint8_t>(data.size() / 2);
+
+  return record;
+}
+
+can_trace_reader::can_trace_reader(std::span<hal::byte const> p_trace)
+  : m_trace(p_trace)
+{
+  if (p_trace.size() < trace_header_size ||
+      not std::equal(trace_magic.begin(), trace_magic.end(), p_trace.begin()) ||
+      p_trace[4] != trace_version) {
+    throw hal::argument_out_of_domain(this);
+  }
+
+  std::uint32_t const frequency = p_trace[5] << 0 | p_trace[6] << 8 |
+                                  p_trace[7] << 16 | p_trace[8] << 24;
+  m_frequency = std::bit_cast<hal::hertz>(frequency);
+}
+
+std::optional<trace_record> can_trace_reader::next()
+{
+  auto offset = m_offset;
+  auto const remaining = [this, &offset](std::size_t p_count) {
+    return offset + p_count <= m_trace.size();
+  };
+
+  std::uint64_t delta = 0;
+  for (int shift = 0;; shift += 7) {
+    if (not remaining(1) || shift >= 64) {
+      return std::nullopt;
+    }
+    auto const septet = m_trace[offset++];
+    delta |= std::uint64_t{ septet & 0x7Fu } << shift;
+    if ((septet & 0x80) == 0) {
+      break;
+    }
+  }
+
+  if (not remaining(1)) {
+    return std::nullopt;
+  }
+
+  auto const flags = m_trace[offset++];
+  auto const length = static_cast<std::uint8_t>(flags >> length_shift);
+  auto const id_bytes = (flags & extended_id_flag) ? 4U : 2U;
+
+  if (length > 8 || not remaining(id_bytes + length)) {
+    return std::nullopt;
+  }
+
+  trace_record record{};
+  for (std::size_t i = 0; i < id_bytes; i++) {
+    record.message.id |= can::id_t{ m_trace[offset++] } << (i * 8);
+  }
+  std::copy_n(m_trace.begin() + offset, length, record.message.payload.begin());
+  offset += length;
+
+  record.message.length = length;
+  record.message.is_remote_request = flags & remote_request_flag;
+  record.direction = (flags & direction_flag) ? trace_direction::receive
+                                              : trace_direction::transmit;
+  record.timestamp = m_timestamp + delta;
+
+  m_timestamp = record.timestamp;
+  m_offset = offset;
+
+  return record;
+}
+
+void can_trace_reader::rewind()
+{
+  m_offset = trace_header_size;
+  m_timestamp = 0;
+}
+
+hal::hertz can_trace_reader::frequency() const
+{
+  return m_frequency;
+}
+
+can_trace_recorder::can_trace_recorder(hal::can& p_can,
+                                       hal::steady_clock& p_clock,
+                                       sink_t p_sink)
+  : m_can(&p_can)
+  , m_clock(&p_clock)
+  , m_sink(std::move(p_sink))
+{
+  auto const header = encode_trace_header(m_clock->frequency());
+  m_sink(header);
+  m_can->on_receive([this](message_t const& p_message) {
+    record(trace_direction::receive, p_message);
+    m_handler(p_message);
+  });
+}
+
+std::uint32_t can_trace_recorder::frames() const
+{
+  return m_frames;
+}
+
+void can_trace_recorder::record(trace_direction p_direction,
+                                message_t const& p_message)
+{
+  std::array<hal::byte, max_trace_record_size> buffer{};
+  trace_record const record{
+    .timestamp = m_clock->uptime(),
+    .direction = p_direction,
+    .message = p_message,
+  };
+
+  m_sink(encode_trace_record(record, m_previous_timestamp, buffer));
+  m_previous_timestamp = record.timestamp;
+  m_frames++;
+}
+
+void can_trace_recorder::driver_configure(settings const& p_settings)
+{
+  m_can->configure(p_settings);
+}
+
+void can_trace_recorder::driver_bus_on()
+{
+  m_can->bus_on();
+}
+
+void can_trace_recorder::driver_send(message_t const& p_message)
+{
+  record(trace_direction::transmit, p_message);
+  m_can->send(p_message);
+}
+
+void can_trace_recorder::driver_on_receive(hal::callback<handler> p_handler)
+{
+  m_handler = p_handler;
+}
+
+can_trace_replay::can_trace_replay(std::span<hal::byte const> p_trace)
+  : m_reader(p_trace)
+{
+}
+
+std::optional<trace_record> can_trace_replay::next_received()
+{
+  while (auto record = m_reader.next()) {
+    if (record->direction == trace_direction::receive) {
+      return record;
+    }
+  }
+  return std::nullopt;
+}
+
+bool can_trace_replay::step()
+{
+  auto const record = next_received();
+  if (not record) {
+    return false;
+  }
+  m_handler(record->message);
+  return true;
+}
+
+std::size_t can_trace_replay::replay_all()
+{
+  std::size_t delivered = 0;
+  while (step()) {
+    delivered++;
+  }
+  return delivered;
+}
+
+std::size_t can_trace_replay::replay_realtime(hal::steady_clock& p_clock)
+{
+  std::size_t delivered = 0;
+  std::uint64_t trace_start = 0;
+  std::uint64_t clock_start = 0;
+  // Ratio used to convert trace ticks into ticks of p_clock
+  auto const tick_ratio = static_cast<double>(p_clock.frequency()) /
+                          static_cast<double>(m_reader.frequency());
+
+  while (auto const record = next_received()) {
+    if (delivered == 0) {
+      trace_start = record->timestamp;
+      clock_start = p_clock.uptime();
+    }
+
+    auto const trace_ticks = record->timestamp - trace_start;
+    auto const deadline =
+      clock_start + static_cast<std::uint64_t>(trace_ticks * tick_ratio);
+    while (p_clock.uptime() < deadline) {
+      continue;
+    }
+
+    m_handler(record->message);
+    delivered++;
+  }
+
+  return delivered;
+}
+
+void can_trace_replay::rewind()
+{
+  m_reader.rewind();
+}
+
+std::uint32_t can_trace_replay::frames_sent() const
+{
+  return m_frames_sent;
+}
+
+void can_trace_replay::driver_configure(settings const&)
+{
+}
+
+void can_trace_replay::driver_bus_on()
+{
+}
+
+void can_trace_replay::driver_send(message_t const&)
+{
+  m_frames_sent++;
+}
+
+void can_trace_replay::driver_on_receive(hal::callback<handler> p_handler)
+{
+  m_handler = p_handler;
+}
+}  // namespace hal::rmd
@@ -0,0 +1,117 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/chrome_trace.hpp>
+
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <string_view>
+
+#include <libhal/error.hpp>
+
+namespace hal::rmd {
+namespace {
+constexpr std::string_view document_start = "{\"traceEvents\":[\n";
+constexpr std::string_view document_end = "\n]}\n";
+}  // namespace
+
+chrome_trace_writer::chrome_trace_writer(hal::hertz p_frequency, sink_t p_sink)
+  : m_sink(std::move(p_sink))
+{
+  // Also rejects NaN. Lower frequencies would truncate to a zero divisor.
+  if (not(p_frequency >= 1.0f)) {
+    throw hal::argument_out_of_domain(this);
+  }
+
+  m_frequency = static_cast<std::uint64_t>(p_frequency);
+  m_sink(document_start);
+}
+
+chrome_trace_writer::~chrome_trace_writer()
+{
+  finish();
+}
+
+void chrome_trace_writer::operator()(trace_event p_event,
+                                     can::id_t p_device_id,
+                                     hal::byte p_command,
+                                     std::uint64_t p_timestamp)
+{
+  switch (p_event) {
+    case trace_event::frame_sent:
+      write("B", "request", p_device_id, p_command, p_timestamp);
+      break;
+    case trace_event::reply_decoded:
+      write("E", "request", p_device_id, p_command, p_timestamp);
+      break;
+    case trace_event::timeout:
+      write("E", "request", p_device_id, p_command, p_timestamp);
+      write("i", "timeout", p_device_id, p_command, p_timestamp);
+      break;
+  }
+}
+
+void chrome_trace_writer::write(char const* p_phase,
+                                char const* p_name,
+                                can::id_t p_device_id,
+                                hal::byte p_command,
+                                std::uint64_t p_timestamp)
+{
+  if (m_finished) {
+    return;
+  }
+
+  // Split the timestamp to avoid overflowing when converting to nanoseconds
+  auto const seconds = p_timestamp / m_frequency;
+  auto const remainder = p_timestamp % m_frequency;
+  auto const nanoseconds =
+    seconds * 1'000'000'000 + (remainder * 1'000'000'000) / m_frequency;
+
+  std::array<char, 192> buffer{};
+  auto const length = std::snprintf(
+    buffer.data(),
+    buffer.size(),
+    "%s{\"name\":\"%s\",\"cat\":\"rmd\",\"ph\":\"%s\",\"ts\":%" PRIu64
+    ".%03" PRIu64 ",\"pid\":1,\"tid\":%" PRIu32
+    ",\"s\":\"t\",\"args\":{\"command\":\"0x%02X\"}}",
+    m_events == 0 ? "" : ",\n",
+    p_name,
+    p_phase,
+    nanoseconds / 1000,
+    nanoseconds % 1000,
+    static_cast<std::uint32_t>(p_device_id),
+    static_cast<unsigned>(p_command));
+
+  if (length > 0) {
+    auto const size = static_cast<std::size_t>(length);
+    m_sink(std::span<char const>(buffer.data(), size));
+    m_events++;
+  }
+}
+
+void chrome_trace_writer::finish()
+{
+  if (m_finished) {
+    return;
+  }
+  m_sink(document_end);
+  m_finished = true;
+}
+
+std::uint32_t chrome_trace_writer::events() const
+{
+  return m_events;
+}
+}  // namespace hal::rmd
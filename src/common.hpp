@@ -1,10 +1,22 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <span>
 
+#include <libhal-util/steady_clock.hpp>
 #include <libhal/can.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
 
 namespace hal {
+/// RMD motors can only be assigned 32 unique IDs, thus only 32 motors can live
+/// on a single bus.
+inline constexpr std::size_t max_motors_per_bus = 32;
+
 inline constexpr can::message_t message(hal::can::id_t p_device_id,
                                         std::array<hal::byte, 8> p_payload)
 {
@@ -22,4 +34,376 @@ T bounds_check(std::floating_point auto p_float)
 
   return static_cast<T>(std::clamp(p_float, min, max));
 }
+
+/**
+ * @brief Convert a number of clock ticks into a duration
+ *
+ * @param p_ticks - number of ticks of a clock
+ * @param p_frequency - frequency of the clock the ticks came from
+ * @return hal::time_duration - amount of time the ticks represent
+ */
+inline hal::time_duration ticks_to_duration(std::uint64_t p_ticks,
+                                            hal::hertz p_frequency)
+{
+  using float_seconds = std::chrono::duration<float>;
+  auto const seconds = float_seconds(static_cast<float>(p_ticks) / p_frequency);
+  return std::chrono::duration_cast<hal::time_duration>(seconds);
+}
+
+/**
+ * @brief Convert a duration into a number of clock ticks
+ *
+ * @param p_duration - amount of time
+ * @param p_frequency - frequency of the clock
+ * @return std::uint64_t - number of ticks in the duration, zero if negative
+ */
+inline std::uint64_t duration_to_ticks(hal::time_duration p_duration,
+                                       hal::hertz p_frequency)
+{
+  using float_seconds = std::chrono::duration<float>;
+  auto const seconds = std::chrono::duration_cast<float_seconds>(p_duration);
+  auto const ticks = seconds.count() * p_frequency;
+  return ticks <= 0.0f ? 0 : static_cast<std::uint64_t>(ticks);
+}
+
+/**
+ * @brief Record that field groups of a motor's feedback have been updated
+ *
+ * @param p_feedback - feedback of the motor
+ * @param p_groups - bit mask of the field groups updated
+ * @param p_now - uptime of the driver's clock
+ */
+template<class feedback_type>
+void mark_updated(feedback_type& p_feedback,
+                  std::uint8_t p_groups,
+                  std::uint64_t p_now)
+{
+  p_feedback.updated |= p_groups;
+  p_feedback.received |= p_groups;
+  for (std::size_t i = 0; i < p_feedback.updated_at.size(); i++) {
+    if (p_groups & (1U << i)) {
+      p_feedback.updated_at[i] = p_now;
+    }
+  }
+}
+
+/**
+ * @brief Find the field groups of a motor's feedback older than a limit
+ *
+ * @param p_feedback - feedback of the motor
+ * @param p_now - uptime of the driver's clock
+ * @param p_max_age - oldest acceptable age in ticks of the clock
+ * @param p_groups - bit mask of the field groups to consider
+ * @return std::uint8_t - bit mask of the stale field groups
+ */
+template<class feedback_type>
+std::uint8_t stale_groups(feedback_type const& p_feedback,
+                          std::uint64_t p_now,
+                          std::uint64_t p_max_age,
+                          std::uint8_t p_groups)
+{
+  std::uint8_t stale = 0;
+  for (std::size_t i = 0; i < p_feedback.updated_at.size(); i++) {
+    auto const bit = static_cast<std::uint8_t>(1U << i);
+    if (not(p_feedback.received & bit) ||
+        p_now - p_feedback.updated_at[i] > p_max_age) {
+      stale |= bit;
+    }
+  }
+  return stale & p_groups;
+}
+
+/**
+ * @brief Send the read commands that refresh a set of field groups
+ *
+ * status_2 refreshes motion and temperature, status_1_and_error_flags
+ * refreshes status and temperature and multi_turns_angle refreshes angle.
+ * Temperature alone is refreshed with status_2.
+ *
+ * @tparam driver - rmd driver type
+ * @param p_motor - motor to send the commands to
+ * @param p_groups - bit mask of the field groups to refresh
+ * @return std::uint32_t - number of commands sent
+ */
+template<class driver>
+std::uint32_t transmit_refresh(driver& p_motor, std::uint8_t p_groups)
+{
+  using read = typename driver::read;
+  using field_group = typename driver::field_group;
+  constexpr auto motion = static_cast<std::uint8_t>(field_group::motion);
+  constexpr auto temperature =
+    static_cast<std::uint8_t>(field_group::temperature);
+  constexpr auto status = static_cast<std::uint8_t>(field_group::status);
+  constexpr auto angle = static_cast<std::uint8_t>(field_group::angle);
+
+  std::uint32_t sent = 0;
+  auto const request = [&p_motor, &sent](read p_command) {
+    p_motor.transmit({ static_cast<hal::byte>(p_command) });
+    sent++;
+  };
+
+  if ((p_groups & motion) ||
+      ((p_groups & temperature) && not(p_groups & status))) {
+    request(read::status_2);
+  }
+  if (p_groups & status) {
+    request(read::status_1_and_error_flags);
+  }
+  if (p_groups & angle) {
+    request(read::multi_turns_angle);
+  }
+  return sent;
+}
+
+/**
+ * @brief Wait for every motor's message number to move past its snapshot
+ *
+ * @tparam driver - rmd driver type
+ * @param p_motors - motors to wait on, at most max_motors_per_bus
+ * @param p_snapshot - message numbers of each motor captured before their
+ * commands were transmitted.
+ * @param p_pending - bit mask of the motors in p_motors to wait on
+ * @param p_clock - clock used to determine the deadline
+ * @param p_timeout - amount of time to wait for all motors to respond
+ * @return std::uint32_t - bit mask of the motors that did not respond in time
+ */
+template<class driver>
+std::uint32_t await_all(std::span<driver* const> p_motors,
+                        std::span<std::uint32_t const> p_snapshot,
+                        std::uint32_t p_pending,
+                        hal::steady_clock& p_clock,
+                        hal::time_duration p_timeout)
+{
+  auto const deadline = hal::future_deadline(p_clock, p_timeout);
+
+  while (true) {
+    for (std::size_t i = 0; i < p_motors.size(); i++) {
+      auto const bit = std::uint32_t{ 1 } << i;
+      if ((p_pending & bit) &&
+          p_motors[i]->feedback().message_number != p_snapshot[i]) {
+        p_pending &= ~bit;
+      }
+    }
+
+    if (p_pending == 0 || deadline <= p_clock.uptime()) {
+      return p_pending;
+    }
+  }
+}
+
+/**
+ * @brief Find the longest response timeout of a set of motors
+ *
+ * @tparam driver - rmd driver type
+ * @param p_motors - motors to search, must not be empty
+ * @return hal::time_duration - longest response timeout
+ */
+template<class driver>
+hal::time_duration longest_response_timeout(std::span<driver* const> p_motors)
+{
+  auto longest = p_motors[0]->response_timeout();
+  for (auto const* motor : p_motors) {
+    longest = std::max(longest, motor->response_timeout());
+  }
+  return longest;
+}
+
+/**
+ * @brief Bit mask with a bit set for each motor in a list of motors
+ *
+ * @param p_count - number of motors, at most max_motors_per_bus
+ * @return std::uint32_t - mask with the lowest p_count bits set
+ */
+inline constexpr std::uint32_t motor_mask(std::size_t p_count)
+{
+  if (p_count >= max_motors_per_bus) {
+    return UINT32_MAX;
+  }
+  return (std::uint32_t{ 1 } << p_count) - 1;
+}
+
+/**
+ * @brief Send a command to each motor back to back then await all responses
+ *
+ * @tparam driver - rmd driver type
+ * @param p_motors - motors to send commands to, at most max_motors_per_bus
+ * @param p_clock - clock used to determine the deadline
+ * @param p_timeout - amount of time to wait for all motors to respond
+ * @param p_payload_of - invoked with the index of each selected motor and
+ * returns the command to send to it
+ * @param p_selected - bit mask of the motors in p_motors to send a command to
+ * @return std::uint32_t - bit mask of the motors that did not respond in time
+ */
+template<class driver, class payload_function>
+std::uint32_t exchange_each(std::span<driver* const> p_motors,
+                            hal::steady_clock& p_clock,
+                            hal::time_duration p_timeout,
+                            payload_function&& p_payload_of,
+                            std::uint32_t p_selected)
+{
+  std::array<std::uint32_t, max_motors_per_bus> snapshot{};
+  std::uint32_t const pending = p_selected & motor_mask(p_motors.size());
+
+  if (pending == 0) {
+    return 0;
+  }
+
+  for (std::size_t i = 0; i < p_motors.size(); i++) {
+    if (pending & (std::uint32_t{ 1 } << i)) {
+      snapshot[i] = p_motors[i]->feedback().message_number;
+      p_motors[i]->transmit(p_payload_of(i));
+    }
+  }
+
+  return await_all(p_motors, snapshot, pending, p_clock, p_timeout);
+}
+
+/**
+ * @brief Send a command to motors back to back then await all responses
+ *
+ * Performs the same work as calling a blocking command on each motor in turn
+ * but only costs a single round trip.
+ *
+ * @tparam driver - rmd driver type
+ * @param p_motors - motors to send the command to, at most max_motors_per_bus
+ * @param p_clock - clock used to determine the deadline
+ * @param p_timeout - amount of time to wait for all motors to respond
+ * @param p_payload - command to send to each motor
+ * @param p_selected - bit mask of the motors in p_motors to send the command
+ * to. Defaults to every motor.
+ * @return std::uint32_t - bit mask of the motors that did not respond in time
+ */
+template<class driver>
+std::uint32_t exchange_all(std::span<driver* const> p_motors,
+                           hal::steady_clock& p_clock,
+                           hal::time_duration p_timeout,
+                           std::array<hal::byte, 8> p_payload,
+                           std::uint32_t p_selected = UINT32_MAX)
+{
+  return exchange_each(
+    p_motors,
+    p_clock,
+    p_timeout,
+    [&p_payload](std::size_t) { return p_payload; },
+    p_selected);
+}
+
+/**
+ * @brief Refresh the stale field groups of motors in a single burst
+ *
+ * The read commands of every motor are transmitted back to back, then the
+ * responses of all motors are awaited together.
+ *
+ * @tparam driver - rmd driver type
+ * @param p_motors - motors to refresh, at most max_motors_per_bus
+ * @param p_clock - clock used to determine ages and the deadline
+ * @param p_timeout - amount of time to wait for all motors to respond
+ * @param p_max_age - oldest acceptable age of a field group
+ * @param p_groups - bit mask of the field groups to consider
+ * @return std::uint32_t - bit mask of the motors that did not respond in time
+ */
+template<class driver>
+std::uint32_t refresh_stale(std::span<driver* const> p_motors,
+                            hal::steady_clock& p_clock,
+                            hal::time_duration p_timeout,
+                            hal::time_duration p_max_age,
+                            std::uint8_t p_groups)
+{
+  auto const now = p_clock.uptime();
+  auto const max_age = duration_to_ticks(p_max_age, p_clock.frequency());
+  std::array<std::uint32_t, max_motors_per_bus> target{};
+  std::uint32_t pending = 0;
+
+  for (std::size_t i = 0; i < p_motors.size(); i++) {
+    auto& motor = *p_motors[i];
+    auto const stale = stale_groups(motor.feedback(), now, max_age, p_groups);
+    if (stale == 0) {
+      continue;
+    }
+    target[i] = motor.feedback().message_number;
+    target[i] += transmit_refresh(motor, stale);
+    pending |= std::uint32_t{ 1 } << i;
+  }
+
+  if (pending == 0) {
+    return 0;
+  }
+
+  auto const deadline = hal::future_deadline(p_clock, p_timeout);
+  while (true) {
+    for (std::size_t i = 0; i < p_motors.size(); i++) {
+      auto const bit = std::uint32_t{ 1 } << i;
+      auto const remaining = static_cast<std::int32_t>(
+        target[i] - p_motors[i]->feedback().message_number);
+      if ((pending & bit) && remaining <= 0) {
+        pending &= ~bit;
+      }
+    }
+
+    if (pending == 0 || deadline <= p_clock.uptime()) {
+      return pending;
+    }
+  }
+}
+
+namespace rmd {
+/**
+ * @brief Run a driver's reply hooks for a decoded speed, current and encoder
+ *
+ * Updates the motion estimator, multi-turn tracker and stall detector, in that
+ * order. When a stall is detected a stop is requested, if configured to, and
+ * the stall callback is called.
+ *
+ * @tparam driver - rmd driver type
+ * @param p_driver - driver that decoded the reply into its feedback
+ * @param p_now - uptime of the driver's clock when the reply was decoded
+ */
+template<class driver>
+void run_motion_reply_hooks(driver& p_driver, std::uint64_t p_now)
+{
+  using namespace hal::literals;
+  auto const& feedback = p_driver.m_feedback;
+
+  if (p_driver.m_motion) {
+    p_driver.m_motion->update_velocity(p_now,
+                                       feedback.speed() / 1.0_deg_per_sec);
+  }
+  if (p_driver.m_multi_turn) {
+    p_driver.m_multi_turn->update(feedback.encoder);
+  }
+  if (p_driver.m_stall &&
+      p_driver.m_stall->update(p_now, feedback.speed(), feedback.current())) {
+    if (p_driver.m_stall->configuration().stop_on_stall) {
+      // Sending from the receive handler could interrupt a send() in progress,
+      // so the stop goes out with the next transmit. Disarm like it would.
+      p_driver.m_stall->command(0.0f);
+      p_driver.m_stop_pending = true;
+    }
+    p_driver.m_on_stall();
+  }
+}
+
+/**
+ * @brief Run a driver's reply hooks for a decoded multi-turn angle
+ *
+ * @tparam driver - rmd driver type
+ * @param p_driver - driver that decoded the reply into its feedback
+ * @param p_now - uptime of the driver's clock when the reply was decoded
+ * @param p_output_angle - angle of the output shaft used to seed the
+ * multi-turn tracker, drivers differ in whether their reply already accounts
+ * for the gear ratio.
+ */
+template<class driver>
+void run_angle_reply_hooks(driver& p_driver,
+                           std::uint64_t p_now,
+                           hal::degrees p_output_angle)
+{
+  if (p_driver.m_motion) {
+    p_driver.m_motion->update_position(p_now, p_driver.m_feedback.angle());
+  }
+  if (p_driver.m_multi_turn) {
+    p_driver.m_multi_turn->seed(p_output_angle);
+  }
+}
+}  // namespace rmd
 }  // namespace hal
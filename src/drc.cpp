@@ -14,7 +14,10 @@
 
 #include <libhal-rmd/drc.hpp>
 
+#include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <utility>
 
 #include <libhal-util/bit.hpp>
 #include <libhal-util/can.hpp>
@@ -24,6 +27,8 @@
 #include <libhal/error.hpp>
 #include <libhal/servo.hpp>
 
+#include <libhal-rmd/trace.hpp>
+
 #include "common.hpp"
 #include "drc_constants.hpp"
 
@@ -79,7 +84,8 @@ drc::drc(hal::can_router& p_router,
          hal::steady_clock& p_clock,
          float p_gear_ratio,  // NOLINT
          can::id_t p_device_id,
-         hal::time_duration p_max_response_time)
+         hal::time_duration p_max_response_time,
+         startup p_startup)
   : m_feedback{}
   , m_clock(&p_clock)
   , m_router(&p_router)
@@ -90,9 +96,110 @@ drc::drc(hal::can_router& p_router,
 {
   m_route_item.get().handler = std::ref(*this);
 
-  drc::system_control(system::off);
-  drc::system_control(system::running);
+  if (p_startup == startup::power_cycle) {
+    drc::system_control(system::off);
+    drc::system_control(system::running);
+  }
+}
+
+drc::drc(drc&& p_other) noexcept
+  : m_feedback(p_other.m_feedback)
+  , m_clock(p_other.m_clock)
+  , m_router(p_other.m_router)
+  , m_route_item(std::move(p_other.m_route_item))
+  , m_gear_ratio(p_other.m_gear_ratio)
+  , m_device_id(p_other.m_device_id)
+  , m_max_response_time(p_other.m_max_response_time)
+  , m_rtt(std::move(p_other.m_rtt))
+  , m_motion(std::move(p_other.m_motion))
+  , m_multi_turn(std::move(p_other.m_multi_turn))
+  , m_stall(std::move(p_other.m_stall))
+  , m_on_stall(std::move(p_other.m_on_stall))
+{
+  m_route_item.get().handler = std::ref(*this);
+}
+
+drc& drc::operator=(drc&& p_other) noexcept
+{
+  if (this == &p_other) {
+    return *this;
+  }
+
+  m_feedback = p_other.m_feedback;
+  m_clock = p_other.m_clock;
+  m_router = p_other.m_router;
+  m_route_item = std::move(p_other.m_route_item);
+  m_gear_ratio = p_other.m_gear_ratio;
+  m_device_id = p_other.m_device_id;
+  m_max_response_time = p_other.m_max_response_time;
+  m_rtt = std::move(p_other.m_rtt);
+  m_motion = std::move(p_other.m_motion);
+  m_multi_turn = std::move(p_other.m_multi_turn);
+  m_stall = std::move(p_other.m_stall);
+  m_on_stall = std::move(p_other.m_on_stall);
+  m_route_item.get().handler = std::ref(*this);
+  return *this;
+}
+
+namespace {
+/**
+ * @brief Determine the speed a command asks the motor to move at
+ *
+ * @param p_payload - command sent to the motor
+ * @return std::optional<hal::rpm> - the speed of speed commands, zero for any
+ * other motion or system command and nothing for commands that do not affect
+ * motion.
+ */
+std::optional<hal::rpm> commanded_speed(
+  std::array<hal::byte, 8> const& p_payload)
+{
+  switch (p_payload[0]) {
+    case hal::value(drc::actuate::speed): {
+      auto const raw = static_cast<std::int32_t>(
+        p_payload[7] << 24 | p_payload[6] << 16 | p_payload[5] << 8 |
+        p_payload[4]);
+      return static_cast<float>(raw) * dps_per_lsb_speed * 1.0_deg_per_sec;
+    }
+    case hal::value(drc::actuate::position_2):
+    case hal::value(drc::actuate::incremental_position):
+    case hal::value(drc::system::off):
+    case hal::value(drc::system::stop):
+      return 0.0f;
+    default:
+      return std::nullopt;
+  }
+}
+
+std::array<hal::byte, 8> pid_payload(drc::write p_command,
+                                     drc::pid_gains const& p_gains)
+{
+  return {
+    hal::value(p_command),
+    0x00,
+    p_gains.angle_kp,
+    p_gains.angle_ki,
+    p_gains.speed_kp,
+    p_gains.speed_ki,
+    p_gains.current_kp,
+    p_gains.current_ki,
+  };
+}
+
+std::array<hal::byte, 8> acceleration_payload(std::int32_t p_acceleration)
+{
+  auto const data = static_cast<std::uint32_t>(p_acceleration);
+  return {
+    hal::value(drc::write::acceleration_data_to_ram),
+    0x00,
+    0x00,
+    0x00,
+    static_cast<hal::byte>((data >> 0) & 0xFF),
+    static_cast<hal::byte>((data >> 8) & 0xFF),
+    static_cast<hal::byte>((data >> 16) & 0xFF),
+    static_cast<hal::byte>((data >> 24) & 0xFF),
+  };
 }
+}  // namespace
 
 std::int32_t rpm_to_drc_speed(rpm p_rpm,
                               float p_gear_ratio,
@@ -107,22 +214,208 @@ std::int32_t rpm_to_drc_speed(rpm p_rpm,
 
 void drc::send(std::array<hal::byte, 8> p_payload)
 {
-  // Capture the message number prior to the send command
-  auto original_message_number = feedback().message_number;
+  // Capture the acknowledgement prior to the send command. Unlike the message
+  // number, it ignores the response to a pending stop sent ahead of p_payload.
+  auto original_acknowledged_number = feedback().acknowledged_number;
+  auto const start = m_clock->uptime();
 
   // Send payload
-  m_router->bus().send(message(m_device_id, p_payload));
+  transmit(p_payload);
 
   // Wait for the message number to increment
-  auto timeout = hal::create_timeout(*m_clock, m_max_response_time);
+  auto const deadline = hal::future_deadline(*m_clock, response_timeout());
   while (true) {
-    if (original_message_number != feedback().message_number) {
+    auto const now = m_clock->uptime();
+    if (original_acknowledged_number != feedback().acknowledged_number) {
+      if (m_rtt) {
+        m_rtt->record(ticks_to_duration(now - start, m_clock->frequency()));
+      }
       return;
     }
-    timeout();
+    if (deadline <= now) {
+      if (m_rtt) {
+        m_rtt->record_timeout();
+      }
+      if constexpr (trace_enabled) {
+        trace(trace_event::timeout, m_device_id, p_payload[0], now);
+      }
+      throw hal::timed_out(this);
+    }
+  }
+}
+
+void drc::adaptive_timeout(rtt_estimator::settings const& p_settings)
+{
+  m_rtt.emplace(p_settings);
+}
+
+std::optional<rtt_estimator> const& drc::round_trip_time() const
+{
+  return m_rtt;
+}
+
+void drc::transmit(std::array<hal::byte, 8> p_payload)
+{
+  send_pending_stop();
+  m_transmitted_command = p_payload[0];
+  if (m_stall) {
+    if (auto const speed = commanded_speed(p_payload)) {
+      m_stall->command(*speed);
+    }
+  }
+  if constexpr (trace_enabled) {
+    trace(trace_event::frame_sent,
+          m_device_id,
+          p_payload[0],
+          m_clock->uptime());
+  }
+  m_router->bus().send(message(m_device_id, p_payload));
+}
+
+void drc::estimate_motion(motion_estimator::settings const& p_settings)
+{
+  m_motion.emplace(m_clock->frequency(), p_settings);
+}
+
+std::optional<motion_estimator> const& drc::motion() const
+{
+  return m_motion;
+}
+
+void drc::track_multi_turn(multi_turn_tracker::settings const& p_settings)
+{
+  m_multi_turn.emplace(m_gear_ratio, p_settings);
+}
+
+std::optional<multi_turn_tracker> const& drc::multi_turn() const
+{
+  return m_multi_turn;
+}
+
+void drc::detect_stall(stall_detector::settings const& p_settings,
+                       hal::callback<void()> p_on_stall)
+{
+  m_stall.emplace(m_clock->frequency(), p_settings);
+  m_on_stall = p_on_stall;
+}
+
+std::optional<stall_detector> const& drc::stall() const
+{
+  return m_stall;
+}
+
+bool drc::send_pending_stop()
+{
+  if (not m_stop_pending) {
+    return false;
+  }
+  m_stop_pending = false;
+  transmit({ hal::value(system::stop) });
+  return true;
+}
+
+hal::time_duration drc::response_timeout() const
+{
+  return m_rtt ? m_rtt->timeout() : m_max_response_time;
+}
+
+std::uint8_t drc::take_updated()
+{
+  return std::exchange(m_feedback.updated, 0);
+}
+
+std::uint8_t drc::request_stale(hal::time_duration p_max_age,
+                                std::uint8_t p_groups)
+{
+  auto const now = m_clock->uptime();
+  auto const max_age = duration_to_ticks(p_max_age, m_clock->frequency());
+  auto const stale = stale_groups(m_feedback, now, max_age, p_groups);
+  if (stale == 0) {
+    return 0;
+  }
+
+  std::array<drc*, 1> const self{ this };
+  if (refresh_stale<drc>(
+        self, *m_clock, response_timeout(), p_max_age, stale) != 0) {
+    throw hal::timed_out(this);
+  }
+  return stale;
+}
+
+void drc::request_stale(std::span<drc* const> p_motors,
+                        hal::time_duration p_max_age,
+                        std::uint8_t p_groups)
+{
+  if (p_motors.empty()) {
+    return;
+  }
+
+  if (p_motors.size() > max_motors_per_bus) {
+    throw hal::argument_out_of_domain(nullptr);
+  }
+
+  auto const unresponsive = refresh_stale(p_motors,
+                                          *p_motors[0]->m_clock,
+                                          longest_response_timeout(p_motors),
+                                          p_max_age,
+                                          p_groups);
+
+  if (unresponsive != 0) {
+    throw hal::timed_out(p_motors[std::countr_zero(unresponsive)]);
+  }
+}
+
+void drc::verify_alive(std::span<drc* const> p_motors)
+{
+  if (p_motors.empty()) {
+    return;
+  }
+
+  if (p_motors.size() > max_motors_per_bus) {
+    throw hal::argument_out_of_domain(nullptr);
+  }
+
+  auto const unresponsive =
+    exchange_all(p_motors,
+                 *p_motors[0]->m_clock,
+                 longest_response_timeout(p_motors),
+                 { hal::value(read::status_1_and_error_flags) });
+
+  if (unresponsive != 0) {
+    throw hal::timed_out(p_motors[std::countr_zero(unresponsive)]);
   }
 }
 
+stop_report drc::emergency_stop_all(std::span<drc* const> p_motors,
+                                    std::uint8_t p_retries)
+{
+  stop_report report{};
+
+  if (p_motors.empty()) {
+    return report;
+  }
+
+  if (p_motors.size() > max_motors_per_bus) {
+    throw hal::argument_out_of_domain(nullptr);
+  }
+
+  auto& clock = *p_motors[0]->m_clock;
+  auto const timeout = longest_response_timeout(p_motors);
+  auto pending = motor_mask(p_motors.size());
+  auto const start = clock.uptime();
+
+  for (std::uint32_t attempt = 0; attempt <= p_retries && pending; attempt++) {
+    report.frames_sent += std::popcount(pending);
+    pending = exchange_all(
+      p_motors, clock, timeout, { hal::value(system::stop) }, pending);
+  }
+
+  report.latency = ticks_to_duration(clock.uptime() - start, clock.frequency());
+  report.unacknowledged = pending;
+
+  return report;
+}
+
 void drc::velocity_control(rpm p_rpm)
 {
   auto const speed_data =
@@ -160,6 +453,26 @@ void drc::position_control(degrees p_angle, rpm p_rpm)  // NOLINT
   });
 }
 
+void drc::incremental_position_control(degrees p_angle, rpm p_rpm)  // NOLINT
+{
+  static constexpr float deg_per_lsb = 0.01f;
+  auto const angle = (p_angle * m_gear_ratio) / deg_per_lsb;
+  auto const angle_data = bounds_check<std::int32_t>(angle);
+  auto const speed_data =
+    rpm_to_drc_speed(p_rpm, m_gear_ratio, dps_per_lsb_angle);
+
+  send({
+    hal::value(actuate::incremental_position),
+    0x00,
+    static_cast<hal::byte>((speed_data >> 0) & 0xFF),
+    static_cast<hal::byte>((speed_data >> 8) & 0xFF),
+    static_cast<hal::byte>((angle_data >> 0) & 0xFF),
+    static_cast<hal::byte>((angle_data >> 8) & 0xFF),
+    static_cast<hal::byte>((angle_data >> 16) & 0xFF),
+    static_cast<hal::byte>((angle_data >> 24) & 0xFF),
+  });
+}
+
 void drc::feedback_request(read p_command)
 {
   send({
@@ -188,6 +501,16 @@ void drc::system_control(system p_system_command)
   });
 }
 
+void drc::write_pid(pid_gains const& p_gains, bool p_persist)
+{
+  send(pid_payload(p_persist ? write::pid_to_rom : write::pid_to_ram, p_gains));
+}
+
+void drc::write_acceleration(std::int32_t p_acceleration)
+{
+  send(acceleration_payload(p_acceleration));
+}
+
 void drc::operator()(can::message_t const& p_message)
 {
   m_feedback.message_number++;
@@ -196,10 +519,22 @@ void drc::operator()(can::message_t const& p_message)
     return;
   }
 
+  if (p_message.payload[0] == m_transmitted_command) {
+    m_feedback.acknowledged_number = m_feedback.message_number;
+  }
+
+  if constexpr (trace_enabled) {
+    trace(trace_event::reply_decoded,
+          m_device_id,
+          p_message.payload[0],
+          m_clock->uptime());
+  }
+
   switch (p_message.payload[0]) {
     case hal::value(read::status_2):
     case hal::value(actuate::speed):
-    case hal::value(actuate::position_2): {
+    case hal::value(actuate::position_2):
+    case hal::value(actuate::incremental_position): {
       auto& data = p_message.payload;
       m_feedback.raw_motor_temperature = static_cast<std::int8_t>(data[1]);
       m_feedback.raw_current =
@@ -208,6 +543,12 @@ void drc::operator()(can::message_t const& p_message)
         static_cast<std::int16_t>((data[5] << 8) | data[4] << 0);
       m_feedback.encoder =
         static_cast<std::int16_t>((data[7] << 8) | data[6] << 0);
+      auto const now = m_clock->uptime();
+      mark_updated(m_feedback,
+                   hal::value(field_group::motion) |
+                     hal::value(field_group::temperature),
+                   now);
+      run_motion_reply_hooks(*this, now);
       break;
     }
     case hal::value(read::status_1_and_error_flags): {
@@ -216,6 +557,10 @@ void drc::operator()(can::message_t const& p_message)
       m_feedback.raw_volts =
         static_cast<std::int16_t>((data[4] << 8) | data[3]);
       m_feedback.raw_error_state = data[7];
+      mark_updated(m_feedback,
+                   hal::value(field_group::status) |
+                     hal::value(field_group::temperature),
+                   m_clock->uptime());
       break;
     }
     case hal::value(read::multi_turns_angle): {
@@ -230,10 +575,161 @@ void drc::operator()(can::message_t const& p_message)
                                           .insert<byte_m<5>>(data[6])
                                           .insert<byte_m<6>>(data[7])
                                           .to<std::int64_t>();
+      auto const now = m_clock->uptime();
+      mark_updated(m_feedback, hal::value(field_group::angle), now);
+      run_angle_reply_hooks(*this, now, m_feedback.angle() / m_gear_ratio);
+      break;
+    }
+    case hal::value(read::pid):
+    case hal::value(write::pid_to_ram):
+    case hal::value(write::pid_to_rom): {
+      auto& data = p_message.payload;
+      m_feedback.pid = pid_gains{
+        .angle_kp = data[2],
+        .angle_ki = data[3],
+        .speed_kp = data[4],
+        .speed_ki = data[5],
+        .current_kp = data[6],
+        .current_ki = data[7],
+      };
+      break;
+    }
+    case hal::value(read::acceleration):
+    case hal::value(write::acceleration_data_to_ram): {
+      auto& data = p_message.payload;
+      m_feedback.raw_acceleration = static_cast<std::int32_t>(
+        data[7] << 24 | data[6] << 16 | data[5] << 8 | data[4]);
       break;
     }
     default:
       break;
   }
 }
+
+drc_configuration::drc_configuration(hal::steady_clock& p_clock)
+  : m_clock(&p_clock)
+{
+}
+
+drc_configuration::entry_t& drc_configuration::stage(drc& p_motor)
+{
+  for (std::size_t i = 0; i < m_count; i++) {
+    if (m_motors[i] == &p_motor) {
+      return m_entries[i];
+    }
+  }
+
+  if (m_count >= max_motors) {
+    throw hal::argument_out_of_domain(this);
+  }
+
+  m_motors[m_count] = &p_motor;
+  m_entries[m_count] = {};
+  return m_entries[m_count++];
+}
+
+void drc_configuration::pid(drc& p_motor,
+                            drc::pid_gains const& p_gains,
+                            bool p_persist)
+{
+  auto& entry = stage(p_motor);
+  entry.pid = p_gains;
+  entry.persist = p_persist;
+}
+
+void drc_configuration::acceleration(drc& p_motor,
+                                     std::int32_t p_acceleration)
+{
+  stage(p_motor).acceleration = p_acceleration;
+}
+
+drc_configuration::report_t drc_configuration::commit()
+{
+  report_t report{};
+  std::span<drc* const> const motors(m_motors.data(), m_count);
+  std::span<entry_t const> const entries(m_entries.data(), m_count);
+
+  // Clear the transaction regardless of the outcome
+  m_count = 0;
+
+  if (motors.empty()) {
+    return report;
+  }
+
+  auto const timeout = longest_response_timeout(motors);
+
+  auto exchange = [&](std::uint32_t p_selected, auto p_payload_of) {
+    auto const unresponsive =
+      exchange_each(motors, *m_clock, timeout, p_payload_of, p_selected);
+    if (unresponsive != 0) {
+      throw hal::timed_out(motors[std::countr_zero(unresponsive)]);
+    }
+    return static_cast<std::uint32_t>(std::popcount(p_selected));
+  };
+
+  auto select = [&](auto p_predicate) {
+    std::uint32_t selected = 0;
+    for (std::size_t i = 0; i < motors.size(); i++) {
+      if (p_predicate(motors[i]->feedback(), entries[i])) {
+        selected |= std::uint32_t{ 1 } << i;
+      }
+    }
+    return selected;
+  };
+
+  // Step 1: Learn the configuration of motors that have not reported it yet
+  auto const read_pid =
+    select([](drc::feedback_t const& p_feedback, entry_t const& p_entry) {
+      return p_entry.pid && not p_feedback.pid;
+    });
+  report.reads += exchange(read_pid, [](std::size_t) {
+    return std::array<hal::byte, 8>{ hal::value(drc::read::pid) };
+  });
+
+  auto const read_acceleration =
+    select([](drc::feedback_t const& p_feedback, entry_t const& p_entry) {
+      return p_entry.acceleration && not p_feedback.raw_acceleration;
+    });
+  report.reads += exchange(read_acceleration, [](std::size_t) {
+    return std::array<hal::byte, 8>{ hal::value(drc::read::acceleration) };
+  });
+
+  // Step 2: Write only the values that differ from the motor's
+  auto const write_pid =
+    select([](drc::feedback_t const& p_feedback, entry_t const& p_entry) {
+      return p_entry.pid && p_feedback.pid != p_entry.pid;
+    });
+  exchange(write_pid, [&entries](std::size_t p_index) {
+    auto const& entry = entries[p_index];
+    auto const command =
+      entry.persist ? drc::write::pid_to_rom : drc::write::pid_to_ram;
+    return pid_payload(command, *entry.pid);
+  });
+
+  auto const write_acceleration =
+    select([](drc::feedback_t const& p_feedback, entry_t const& p_entry) {
+      return p_entry.acceleration &&
+             p_feedback.raw_acceleration != p_entry.acceleration;
+    });
+  report.ram_writes +=
+    exchange(write_acceleration, [&entries](std::size_t p_index) {
+      return acceleration_payload(*entries[p_index].acceleration);
+    });
+
+  for (std::size_t i = 0; i < entries.size(); i++) {
+    auto const bit = std::uint32_t{ 1 } << i;
+    if (entries[i].pid) {
+      if (write_pid & bit) {
+        entries[i].persist ? report.rom_writes++ : report.ram_writes++;
+      } else {
+        report.skipped++;
+      }
+    }
+    if (entries[i].acceleration && not(write_acceleration & bit)) {
+      report.skipped++;
+    }
+  }
+
+  return report;
+}
 }  // namespace hal::rmd
@@ -28,6 +28,11 @@ void drc_servo::driver_position(hal::degrees p_position)
   m_drc->position_control(p_position, m_max_speed);
 }
 
+void drc_servo::move_by(hal::degrees p_angle)
+{
+  m_drc->incremental_position_control(p_angle, m_max_speed);
+}
+
 drc_temperature_sensor::drc_temperature_sensor(drc& p_drc)
   : m_drc(&p_drc)
 {
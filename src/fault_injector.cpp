@@ -0,0 +1,181 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/fault_injector.hpp>
+
+#include <libhal/error.hpp>
+
+namespace hal::rmd {
+namespace {
+bool valid_rate(float p_rate)
+{
+  return 0.0f <= p_rate && p_rate <= 1.0f;
+}
+}  // namespace
+
+fault_injector::fault_injector(hal::can& p_bus,
+                               hal::steady_clock& p_clock,
+                               settings const& p_settings)
+  : m_bus(&p_bus)
+  , m_clock(&p_clock)
+  , m_settings(p_settings)
+  , m_random(p_settings.seed == 0 ? 1 : p_settings.seed)
+{
+  if (not valid_rate(p_settings.loss) || not valid_rate(p_settings.delay) ||
+      not valid_rate(p_settings.duplicate) ||
+      not valid_rate(p_settings.corrupt)) {
+    throw hal::argument_out_of_domain(this);
+  }
+
+  auto const nanoseconds = std::chrono::nanoseconds(p_settings.delay_time);
+  m_delay_ticks = static_cast<std::uint64_t>(
+    static_cast<double>(nanoseconds.count()) * m_clock->frequency() / 1e9);
+
+  m_bus->on_receive(
+    [this](message_t const& p_message) { inject(p_message, true); });
+}
+
+void fault_injector::release()
+{
+  release(m_clock->uptime());
+}
+
+void fault_injector::release(std::uint64_t p_now)
+{
+  std::size_t i = 0;
+  while (i < m_delayed_count) {
+    if (p_now < m_delayed[i].due) {
+      i++;
+      continue;
+    }
+    // Remove the frame before delivering it, delivery may delay more frames
+    auto const frame = m_delayed[i];
+    m_delayed[i] = m_delayed[m_delayed_count - 1];
+    m_delayed_count--;
+    deliver(frame.message, frame.incoming);
+  }
+}
+
+fault_injector::stats_t const& fault_injector::stats() const
+{
+  return m_stats;
+}
+
+void fault_injector::driver_configure(hal::can::settings const& p_settings)
+{
+  m_bus->configure(p_settings);
+}
+
+void fault_injector::driver_bus_on()
+{
+  m_bus->bus_on();
+}
+
+void fault_injector::driver_send(message_t const& p_message)
+{
+  inject(p_message, false);
+}
+
+void fault_injector::driver_on_receive(hal::callback<handler> p_handler)
+{
+  m_handler = p_handler;
+}
+
+hal::hertz fault_injector::driver_frequency()
+{
+  return m_clock->frequency();
+}
+
+std::uint64_t fault_injector::driver_uptime()
+{
+  auto const now = m_clock->uptime();
+  release(now);
+  return now;
+}
+
+void fault_injector::inject(message_t p_message, bool p_incoming)
+{
+  if ((p_incoming && not m_settings.incoming) ||
+      (not p_incoming && not m_settings.outgoing)) {
+    deliver(p_message, p_incoming);
+    return;
+  }
+
+  if (roll(m_settings.loss)) {
+    m_stats.dropped++;
+    return;
+  }
+
+  bool faulted = false;
+  if (roll(m_settings.corrupt)) {
+    // Either address the frame to a neighboring ID or truncate it
+    if (roll(0.5f)) {
+      p_message.id ^= 1;
+    } else {
+      p_message.length = static_cast<std::uint8_t>(p_message.length / 2);
+    }
+    m_stats.corrupted++;
+    faulted = true;
+  }
+
+  std::size_t copies = 1;
+  if (roll(m_settings.duplicate)) {
+    copies = 2;
+    m_stats.duplicated++;
+    faulted = true;
+  }
+
+  if (roll(m_settings.delay) && m_delayed_count + copies <= max_delayed) {
+    auto const due = m_clock->uptime() + m_delay_ticks;
+    for (std::size_t i = 0; i < copies; i++) {
+      m_delayed[m_delayed_count++] = {
+        .due = due,
+        .message = p_message,
+        .incoming = p_incoming,
+      };
+    }
+    m_stats.delayed++;
+    return;
+  }
+
+  if (not faulted) {
+    m_stats.passed++;
+  }
+  for (std::size_t i = 0; i < copies; i++) {
+    deliver(p_message, p_incoming);
+  }
+}
+
+void fault_injector::deliver(message_t const& p_message, bool p_incoming)
+{
+  if (p_incoming) {
+    m_handler(p_message);
+  } else {
+    m_bus->send(p_message);
+  }
+}
+
+bool fault_injector::roll(float p_probability)
+{
+  if (p_probability <= 0.0f) {
+    return false;
+  }
+  // xorshift32, the top 24 bits form a uniform fraction within [0, 1)
+  m_random ^= m_random << 13;
+  m_random ^= m_random >> 17;
+  m_random ^= m_random << 5;
+  auto const fraction = static_cast<float>(m_random >> 8) / (1 << 24);
+  return fraction < p_probability;
+}
+}  // namespace hal::rmd
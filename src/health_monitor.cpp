@@ -0,0 +1,163 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/health_monitor.hpp>
+
+#include <bit>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+
+#include <libhal-util/enum.hpp>
+#include <libhal-util/steady_clock.hpp>
+#include <libhal/error.hpp>
+
+namespace hal::rmd {
+namespace {
+/// Uptime of the motor's last status field group update, empty if a status
+/// response has never been received.
+std::optional<std::uint64_t> status_updated_at(
+  health_monitor::motor_t p_motor)
+{
+  return std::visit(
+    [](auto* p_driver) -> std::optional<std::uint64_t> {
+      using driver = std::remove_pointer_t<decltype(p_driver)>;
+      constexpr auto status = hal::value(driver::field_group::status);
+      auto const& feedback = p_driver->feedback();
+      if ((feedback.received & status) == 0) {
+        return std::nullopt;
+      }
+      return feedback.updated_at[std::countr_zero(status)];
+    },
+    p_motor);
+}
+}  // namespace
+
+health_monitor::health_monitor(scheduler& p_scheduler,
+                               hal::steady_clock& p_clock,
+                               settings const& p_settings)
+  : m_scheduler(&p_scheduler)
+  , m_clock(&p_clock)
+  , m_settings(p_settings)
+{
+}
+
+std::size_t health_monitor::add(motor_t p_motor)
+{
+  if (m_count >= max_motors) {
+    throw hal::argument_out_of_domain(this);
+  }
+
+  m_motors[m_count] = p_motor;
+  m_health[m_count] = {};
+  return m_count++;
+}
+
+void health_monitor::on_flag_change(hal::callback<flag_handler> p_handler)
+{
+  m_on_flag_change = p_handler;
+}
+
+void health_monitor::evaluate()
+{
+  auto const index = m_in_flight;
+  auto const motor = m_motors[index];
+  auto& health = m_health[index];
+
+  // Responses to other commands sent to the motor while the request was in
+  // flight do not refresh the status group, so they are not mistaken for a
+  // response to the request.
+  auto const updated_at = status_updated_at(motor);
+  auto const responded = updated_at.has_value() && updated_at != m_snapshot;
+
+  if (not responded) {
+    health.missed++;
+    return;
+  }
+
+  auto const now = m_clock->uptime();
+  auto const [flags, volts, temperature] = std::visit(
+    [](auto* p_driver) {
+      auto const& feedback = p_driver->feedback();
+      return std::make_tuple(
+        static_cast<std::uint16_t>(feedback.raw_error_state),
+        feedback.volts(),
+        feedback.temperature());
+    },
+    motor);
+
+  if (health.samples != 0 && now > m_last_sample[index]) {
+    auto const seconds = static_cast<float>(now - m_last_sample[index]) /
+                         m_clock->frequency();
+    auto const gain = m_settings.trend_gain;
+    auto const volts_slope = (volts - health.volts) / seconds;
+    auto const temperature_slope = (temperature - health.temperature) / seconds;
+    health.volts_trend += gain * (volts_slope - health.volts_trend);
+    health.temperature_trend +=
+      gain * (temperature_slope - health.temperature_trend);
+  }
+
+  auto const previous_flags = health.error_flags;
+  health.error_flags = flags;
+  health.volts = volts;
+  health.temperature = temperature;
+  health.samples++;
+  m_last_sample[index] = now;
+
+  if (flags != previous_flags) {
+    m_on_flag_change(motor, flags & ~previous_flags, previous_flags & ~flags);
+  }
+}
+
+void health_monitor::service()
+{
+  if (m_waiting) {
+    if (not m_scheduler->idle()) {
+      return;
+    }
+    evaluate();
+    m_waiting = false;
+  }
+
+  if (m_count == 0 || not m_scheduler->idle() ||
+      m_clock->uptime() < m_next_request) {
+    return;
+  }
+
+  auto const motor = m_motors[m_next];
+  m_snapshot = status_updated_at(motor);
+
+  if (not m_scheduler->submit(
+        motor, { hal::value(drc::read::status_1_and_error_flags) })) {
+    return;
+  }
+
+  m_in_flight = m_next;
+  m_next = (m_next + 1) % m_count;
+  m_next_request = hal::future_deadline(*m_clock, m_settings.interval);
+  m_waiting = true;
+}
+
+health_monitor::health_t const& health_monitor::health(
+  std::size_t p_index) const
+{
+  return m_health[p_index];
+}
+
+std::size_t health_monitor::size() const
+{
+  return m_count;
+}
+}  // namespace hal::rmd
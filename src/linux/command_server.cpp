@@ -0,0 +1,164 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/linux/command_server.hpp>
+
+#include <algorithm>
+#include <exception>
+
+#include <libhal-util/steady_clock.hpp>
+#include <libhal/error.hpp>
+
+#include "../common.hpp"
+
+namespace hal::rmd {
+command_server::command_server(hal::steady_clock& p_clock)
+  : m_clock(&p_clock)
+  , m_thread([this](std::stop_token p_stop) { run(p_stop); })
+{
+}
+
+command_server::~command_server()
+{
+  m_thread.request_stop();
+  // Wake the I/O thread if it is waiting for work
+  m_submitted.fetch_add(1, std::memory_order_release);
+  m_submitted.notify_one();
+}
+
+std::optional<std::future<command_server::feedback_t>> command_server::submit(
+  motor_t p_motor,
+  std::array<hal::byte, 8> p_payload)
+{
+  command_t command{ .motor = p_motor, .payload = p_payload, .promise = {} };
+  auto future = command.promise.get_future();
+
+  if (not m_queue.push(std::move(command))) {
+    return std::nullopt;
+  }
+
+  m_submitted.fetch_add(1, std::memory_order_release);
+  m_submitted.notify_one();
+  return future;
+}
+
+std::uint64_t command_server::completed() const
+{
+  return m_completed.load(std::memory_order_acquire);
+}
+
+void command_server::run(std::stop_token p_stop)
+{
+  std::array<command_t, max_motors_per_bus> batch{};
+
+  while (not p_stop.stop_requested()) {
+    // Read before draining, a submit after this point will wake the wait
+    auto const observed = m_submitted.load(std::memory_order_acquire);
+    std::size_t count = 0;
+
+    if (m_carry) {
+      batch[count++] = std::move(*m_carry);
+      m_carry.reset();
+    }
+
+    while (count < batch.size()) {
+      auto command = m_queue.pop();
+      if (not command) {
+        break;
+      }
+      // A motor can only have one command in flight, so a second command to
+      // the same motor starts the next batch.
+      auto const same_motor = [&command](command_t const& p_queued) {
+        return p_queued.motor == command->motor;
+      };
+      if (std::any_of(batch.begin(), batch.begin() + count, same_motor)) {
+        m_carry = std::move(command);
+        break;
+      }
+      batch[count++] = std::move(*command);
+    }
+
+    if (count == 0) {
+      m_submitted.wait(observed, std::memory_order_acquire);
+      continue;
+    }
+
+    exchange(std::span(batch.data(), count));
+  }
+}
+
+void command_server::exchange(std::span<command_t> p_batch)
+{
+  std::array<std::uint32_t, max_motors_per_bus> snapshot{};
+  std::array<std::exception_ptr, max_motors_per_bus> errors{};
+  std::uint32_t awaiting = 0;
+  hal::time_duration timeout{};
+
+  for (std::size_t i = 0; i < p_batch.size(); i++) {
+    auto& command = p_batch[i];
+    try {
+      std::visit(
+        [&](auto* p_driver) {
+          snapshot[i] = p_driver->feedback().message_number;
+          timeout = std::max(timeout, p_driver->response_timeout());
+          p_driver->transmit(command.payload);
+        },
+        command.motor);
+      awaiting |= std::uint32_t{ 1 } << i;
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  }
+
+  auto const deadline = hal::future_deadline(*m_clock, timeout);
+  auto const responded = [&](std::size_t p_index) {
+    return std::visit(
+      [&](auto* p_driver) {
+        return p_driver->feedback().message_number != snapshot[p_index];
+      },
+      p_batch[p_index].motor);
+  };
+
+  while (awaiting != 0 && m_clock->uptime() < deadline) {
+    for (std::size_t i = 0; i < p_batch.size(); i++) {
+      auto const bit = std::uint32_t{ 1 } << i;
+      if ((awaiting & bit) && responded(i)) {
+        awaiting &= ~bit;
+      }
+    }
+  }
+
+  // Count before fulfilling, so a caller that has its result also sees it
+  // counted.
+  m_completed.fetch_add(p_batch.size(), std::memory_order_release);
+
+  for (std::size_t i = 0; i < p_batch.size(); i++) {
+    auto& command = p_batch[i];
+    if (errors[i]) {
+      command.promise.set_exception(errors[i]);
+      continue;
+    }
+    std::visit(
+      [&](auto* p_driver) {
+        if (responded(i)) {
+          command.promise.set_value(p_driver->feedback());
+        } else {
+          command.promise.set_exception(
+            std::make_exception_ptr(hal::timed_out(p_driver)));
+        }
+      },
+      command.motor);
+  }
+}
+}  // namespace hal::rmd
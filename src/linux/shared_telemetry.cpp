@@ -0,0 +1,269 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/linux/shared_telemetry.hpp>
+
+#include <bit>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <libhal/error.hpp>
+
+namespace hal::rmd {
+namespace {
+/// "RMDT" in little endian
+constexpr std::uint32_t segment_magic = 0x54444D52;
+/// Increment when the layout of the segment changes
+constexpr std::uint32_t segment_version = 1;
+constexpr std::size_t record_words =
+  sizeof(telemetry_record) / sizeof(std::uint64_t);
+/// Keeps each slot on its own cache lines
+constexpr std::size_t cache_line = 64;
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free &&
+                std::atomic<std::uint64_t>::is_always_lock_free,
+              "Atomics must be lock free to be shared between processes");
+}  // namespace
+
+struct telemetry_exporter::segment_t
+{
+  struct alignas(cache_line) slot_t
+  {
+    /// Odd while the exporter is writing the record
+    std::atomic<std::uint32_t> sequence = 0;
+    /// The record is stored as atomic words so concurrent reads of a slot
+    /// being written are well defined, the sequence detects the tearing.
+    std::array<std::atomic<std::uint64_t>, record_words> words{};
+  };
+
+  std::atomic<std::uint32_t> magic = 0;
+  std::uint32_t version = segment_version;
+  std::uint32_t slots = slot_count;
+  std::uint32_t record_size = sizeof(telemetry_record);
+  std::atomic<std::uint64_t> publishes = 0;
+  std::array<slot_t, slot_count> slot{};
+};
+
+namespace {
+using segment_t = telemetry_exporter::segment_t;
+
+telemetry_record snapshot(can::id_t p_device_id, drc::feedback_t const& p_data)
+{
+  return {
+    .raw_multi_turn_angle = p_data.raw_multi_turn_angle,
+    .device_id = p_device_id,
+    .message_number = p_data.message_number,
+    .angle = p_data.angle(),
+    .speed = p_data.speed(),
+    .current = p_data.current(),
+    .volts = p_data.volts(),
+    .temperature = p_data.temperature(),
+    .error_state = p_data.raw_error_state,
+    .encoder = p_data.encoder,
+    .model = telemetry_record::model_t::drc,
+  };
+}
+
+telemetry_record snapshot(can::id_t p_device_id,
+                          mc_x::feedback_t const& p_data)
+{
+  return {
+    .raw_multi_turn_angle = p_data.raw_multi_turn_angle,
+    .device_id = p_device_id,
+    .message_number = p_data.message_number,
+    .angle = p_data.angle(),
+    .speed = p_data.speed(),
+    .current = p_data.current(),
+    .volts = p_data.volts(),
+    .temperature = p_data.temperature(),
+    .error_state = p_data.raw_error_state,
+    .encoder = p_data.encoder,
+    .model = telemetry_record::model_t::mc_x,
+  };
+}
+}  // namespace
+
+telemetry_exporter::telemetry_exporter(std::string_view p_name,
+                                       hal::steady_clock& p_clock)
+  : m_clock(&p_clock)
+  , m_name(p_name)
+{
+  auto const descriptor = shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0644);
+  if (descriptor < 0) {
+    throw hal::io_error(this);
+  }
+
+  void* memory = MAP_FAILED;
+  if (ftruncate(descriptor, sizeof(segment_t)) == 0) {
+    memory = mmap(nullptr,
+                  sizeof(segment_t),
+                  PROT_READ | PROT_WRITE,
+                  MAP_SHARED,
+                  descriptor,
+                  0);
+  }
+  close(descriptor);
+
+  if (memory == MAP_FAILED) {
+    shm_unlink(m_name.c_str());
+    throw hal::io_error(this);
+  }
+
+  m_segment = new (memory) segment_t{};
+  // Publish the magic last so readers never map a half initialized segment
+  m_segment->magic.store(segment_magic, std::memory_order_release);
+}
+
+telemetry_exporter::~telemetry_exporter()
+{
+  munmap(m_segment, sizeof(segment_t));
+  shm_unlink(m_name.c_str());
+}
+
+void telemetry_exporter::publish(std::size_t p_slot,
+                                 can::id_t p_device_id,
+                                 drc::feedback_t const& p_feedback)
+{
+  auto record = snapshot(p_device_id, p_feedback);
+  write(p_slot, record);
+}
+
+void telemetry_exporter::publish(std::size_t p_slot,
+                                 can::id_t p_device_id,
+                                 mc_x::feedback_t const& p_feedback)
+{
+  auto record = snapshot(p_device_id, p_feedback);
+  write(p_slot, record);
+}
+
+void telemetry_exporter::write(std::size_t p_slot, telemetry_record& p_record)
+{
+  if (p_slot >= slot_count) {
+    throw hal::argument_out_of_domain(this);
+  }
+
+  auto& slot = m_segment->slot[p_slot];
+  auto const sequence = slot.sequence.load(std::memory_order_relaxed);
+  auto const ticks = static_cast<double>(m_clock->uptime());
+  p_record.timestamp_ns =
+    static_cast<std::uint64_t>(ticks * 1e9 / m_clock->frequency());
+  p_record.publishes = sequence / 2 + 1;
+
+  auto const words =
+    std::bit_cast<std::array<std::uint64_t, record_words>>(p_record);
+
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (std::size_t i = 0; i < record_words; i++) {
+    slot.words[i].store(words[i], std::memory_order_relaxed);
+  }
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+
+  m_segment->publishes.fetch_add(1, std::memory_order_relaxed);
+}
+
+telemetry_reader::telemetry_reader(std::string_view p_name)
+{
+  std::string const name(p_name);
+  auto const descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+  if (descriptor < 0) {
+    throw hal::io_error(this);
+  }
+
+  struct stat status
+  {};
+  void* memory = MAP_FAILED;
+  if (fstat(descriptor, &status) == 0 &&
+      sizeof(segment_t) <= static_cast<std::size_t>(status.st_size)) {
+    memory =
+      mmap(nullptr, sizeof(segment_t), PROT_READ, MAP_SHARED, descriptor, 0);
+  }
+  close(descriptor);
+
+  if (memory == MAP_FAILED) {
+    throw hal::io_error(this);
+  }
+
+  m_segment = static_cast<segment_t const*>(memory);
+  if (m_segment->magic.load(std::memory_order_acquire) != segment_magic ||
+      m_segment->version != segment_version ||
+      m_segment->slots != telemetry_exporter::slot_count ||
+      m_segment->record_size != sizeof(telemetry_record)) {
+    munmap(memory, sizeof(segment_t));
+    throw hal::io_error(this);
+  }
+}
+
+telemetry_reader::~telemetry_reader()
+{
+  munmap(const_cast<segment_t*>(m_segment), sizeof(segment_t));
+}
+
+std::optional<telemetry_record> telemetry_reader::read(std::size_t p_slot)
+{
+  if (p_slot >= telemetry_exporter::slot_count) {
+    throw hal::argument_out_of_domain(this);
+  }
+
+  auto const& slot = m_segment->slot[p_slot];
+  std::array<std::uint64_t, record_words> words{};
+
+  // A live exporter keeps changing the sequence, only a publish that was
+  // preempted or never finishes leaves it the same across retries.
+  std::uint32_t previous = 0;
+  std::uint32_t stalled = 0;
+  while (true) {
+    auto const before = slot.sequence.load(std::memory_order_acquire);
+    if (before == 0) {
+      return std::nullopt;
+    }
+    if (before % 2 == 0) {
+      for (std::size_t i = 0; i < record_words; i++) {
+        words[i] = slot.words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == before) {
+        break;
+      }
+    }
+    if (before != previous) {
+      previous = before;
+      stalled = 0;
+    } else if (++stalled == max_read_retries) {
+      throw hal::resource_unavailable_try_again(this);
+    } else {
+      // Let a preempted exporter finish, it may share this core
+      std::this_thread::yield();
+    }
+    m_retries++;
+  }
+
+  return std::bit_cast<telemetry_record>(words);
+}
+
+std::uint64_t telemetry_reader::publishes() const
+{
+  return m_segment->publishes.load(std::memory_order_relaxed);
+}
+
+std::uint64_t telemetry_reader::retries() const
+{
+  return m_retries;
+}
+}  // namespace hal::rmd
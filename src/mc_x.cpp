@@ -14,17 +14,54 @@
 
 #include <libhal-rmd/mc_x.hpp>
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
 #include <cstdint>
+#include <utility>
 
 #include <libhal-util/can.hpp>
 #include <libhal-util/enum.hpp>
 #include <libhal-util/map.hpp>
 #include <libhal-util/steady_clock.hpp>
+#include <libhal/error.hpp>
+
+#include <libhal-rmd/trace.hpp>
 
 #include "common.hpp"
 #include "mc_x_constants.hpp"
 
 namespace hal::rmd {
+namespace {
+/**
+ * @brief Determine the speed a command asks the motor to move at
+ *
+ * @param p_payload - command sent to the motor
+ * @return std::optional<hal::rpm> - the speed of speed commands, zero for any
+ * other motion or system command and nothing for commands that do not affect
+ * motion.
+ */
+std::optional<hal::rpm> commanded_speed(
+  std::array<hal::byte, 8> const& p_payload)
+{
+  switch (p_payload[0]) {
+    case hal::value(mc_x::actuate::speed): {
+      auto const raw = static_cast<std::int32_t>(
+        p_payload[7] << 24 | p_payload[6] << 16 | p_payload[5] << 8 |
+        p_payload[4]);
+      return static_cast<float>(raw) * dps_per_lsb_speed * 1.0_deg_per_sec;
+    }
+    case hal::value(mc_x::actuate::torque):
+    case hal::value(mc_x::actuate::position):
+    case hal::value(mc_x::actuate::incremental_position):
+    case hal::value(mc_x::system::off):
+    case hal::value(mc_x::system::stop):
+      return 0.0f;
+    default:
+      return std::nullopt;
+  }
+}
+}  // namespace
 
 hal::ampere mc_x::feedback_t::current() const noexcept
 {
@@ -107,24 +144,249 @@ mc_x::mc_x(hal::can_router& p_router,
   // this object.
 }
 
+mc_x::mc_x(mc_x&& p_other) noexcept
+  : m_feedback(p_other.m_feedback)
+  , m_clock(p_other.m_clock)
+  , m_router(p_other.m_router)
+  , m_route_item(std::move(p_other.m_route_item))
+  , m_gear_ratio(p_other.m_gear_ratio)
+  , m_rated_current(p_other.m_rated_current)
+  , m_device_id(p_other.m_device_id)
+  , m_max_response_time(p_other.m_max_response_time)
+  , m_rtt(std::move(p_other.m_rtt))
+  , m_motion(std::move(p_other.m_motion))
+  , m_multi_turn(std::move(p_other.m_multi_turn))
+  , m_stall(std::move(p_other.m_stall))
+  , m_on_stall(std::move(p_other.m_on_stall))
+{
+  m_route_item.get().handler = std::ref(*this);
+}
+
+mc_x& mc_x::operator=(mc_x&& p_other) noexcept
+{
+  if (this == &p_other) {
+    return *this;
+  }
+
+  m_feedback = p_other.m_feedback;
+  m_clock = p_other.m_clock;
+  m_router = p_other.m_router;
+  m_route_item = std::move(p_other.m_route_item);
+  m_gear_ratio = p_other.m_gear_ratio;
+  m_rated_current = p_other.m_rated_current;
+  m_device_id = p_other.m_device_id;
+  m_max_response_time = p_other.m_max_response_time;
+  m_rtt = std::move(p_other.m_rtt);
+  m_motion = std::move(p_other.m_motion);
+  m_multi_turn = std::move(p_other.m_multi_turn);
+  m_stall = std::move(p_other.m_stall);
+  m_on_stall = std::move(p_other.m_on_stall);
+  m_route_item.get().handler = std::ref(*this);
+  return *this;
+}
+
 void mc_x::send(std::array<hal::byte, 8> p_payload)
 {
-  // Capture the message number prior to the send command
-  auto original_message_number = feedback().message_number;
+  // Capture the acknowledgement prior to the send command. Unlike the message
+  // number, it ignores the response to a pending stop sent ahead of p_payload.
+  auto original_acknowledged_number = feedback().acknowledged_number;
+  auto const start = m_clock->uptime();
 
   // Send payload
-  m_router->bus().send(message(m_device_id, p_payload));
+  transmit(p_payload);
 
   // Wait for the message number to increment
-  auto timeout = hal::create_timeout(*m_clock, m_max_response_time);
+  auto const deadline = hal::future_deadline(*m_clock, response_timeout());
   while (true) {
-    if (original_message_number != feedback().message_number) {
+    auto const now = m_clock->uptime();
+    if (original_acknowledged_number != feedback().acknowledged_number) {
+      if (m_rtt) {
+        m_rtt->record(ticks_to_duration(now - start, m_clock->frequency()));
+      }
       return;
     }
-    timeout();
+    if (deadline <= now) {
+      if (m_rtt) {
+        m_rtt->record_timeout();
+      }
+      if constexpr (trace_enabled) {
+        trace(trace_event::timeout, m_device_id, p_payload[0], now);
+      }
+      throw hal::timed_out(this);
+    }
+  }
+}
+
+void mc_x::transmit(std::array<hal::byte, 8> p_payload)
+{
+  send_pending_stop();
+  record_transmit(p_payload);
+  m_router->bus().send(message(m_device_id, p_payload));
+}
+
+void mc_x::record_transmit(std::array<hal::byte, 8> const& p_payload)
+{
+  m_transmitted_command = p_payload[0];
+  if (m_stall) {
+    if (auto const speed = commanded_speed(p_payload)) {
+      m_stall->command(*speed);
+    }
+  }
+  if constexpr (trace_enabled) {
+    trace(trace_event::frame_sent,
+          m_device_id,
+          p_payload[0],
+          m_clock->uptime());
+  }
+}
+
+void mc_x::estimate_motion(motion_estimator::settings const& p_settings)
+{
+  m_motion.emplace(m_clock->frequency(), p_settings);
+}
+
+std::optional<motion_estimator> const& mc_x::motion() const
+{
+  return m_motion;
+}
+
+void mc_x::track_multi_turn(multi_turn_tracker::settings const& p_settings)
+{
+  m_multi_turn.emplace(m_gear_ratio, p_settings);
+}
+
+std::optional<multi_turn_tracker> const& mc_x::multi_turn() const
+{
+  return m_multi_turn;
+}
+
+void mc_x::detect_stall(stall_detector::settings const& p_settings,
+                        hal::callback<void()> p_on_stall)
+{
+  m_stall.emplace(m_clock->frequency(), p_settings);
+  m_on_stall = p_on_stall;
+}
+
+std::optional<stall_detector> const& mc_x::stall() const
+{
+  return m_stall;
+}
+
+bool mc_x::send_pending_stop()
+{
+  if (not m_stop_pending) {
+    return false;
+  }
+  m_stop_pending = false;
+  transmit({ hal::value(system::stop) });
+  return true;
+}
+
+hal::time_duration mc_x::response_timeout() const
+{
+  return m_rtt ? m_rtt->timeout() : m_max_response_time;
+}
+
+stop_report mc_x::emergency_stop_all(std::span<mc_x* const> p_motors,
+                                     std::uint8_t p_retries)
+{
+  stop_report report{};
+
+  if (p_motors.empty()) {
+    return report;
+  }
+
+  if (p_motors.size() > max_motors_per_bus) {
+    throw hal::argument_out_of_domain(nullptr);
+  }
+
+  std::array<hal::byte, 8> const stop{ hal::value(system::stop) };
+  std::array<std::uint32_t, max_motors_per_bus> snapshot{};
+  auto& clock = *p_motors[0]->m_clock;
+  auto const timeout = longest_response_timeout(p_motors);
+  auto pending = motor_mask(p_motors.size());
+
+  for (std::size_t i = 0; i < p_motors.size(); i++) {
+    snapshot[i] = p_motors[i]->feedback().message_number;
+  }
+
+  auto const start = clock.uptime();
+
+  // A single broadcast reaches every motor on the bus in one frame
+  for (auto* motor : p_motors) {
+    motor->record_transmit(stop);
+  }
+  p_motors[0]->m_router->bus().send(message(multi_motor_command_id, stop));
+  report.frames_sent++;
+  pending = await_all(p_motors, snapshot, pending, clock, timeout);
+
+  for (std::uint32_t attempt = 0; attempt < p_retries && pending; attempt++) {
+    report.frames_sent += std::popcount(pending);
+    pending = exchange_all(p_motors, clock, timeout, stop, pending);
+  }
+
+  report.latency = ticks_to_duration(clock.uptime() - start, clock.frequency());
+  report.unacknowledged = pending;
+
+  return report;
+}
+
+std::uint8_t mc_x::take_updated()
+{
+  return std::exchange(m_feedback.updated, 0);
+}
+
+std::uint8_t mc_x::request_stale(hal::time_duration p_max_age,
+                                 std::uint8_t p_groups)
+{
+  auto const now = m_clock->uptime();
+  auto const max_age = duration_to_ticks(p_max_age, m_clock->frequency());
+  auto const stale = stale_groups(m_feedback, now, max_age, p_groups);
+  if (stale == 0) {
+    return 0;
+  }
+
+  std::array<mc_x*, 1> const self{ this };
+  if (refresh_stale<mc_x>(
+        self, *m_clock, response_timeout(), p_max_age, stale) != 0) {
+    throw hal::timed_out(this);
+  }
+  return stale;
+}
+
+void mc_x::request_stale(std::span<mc_x* const> p_motors,
+                         hal::time_duration p_max_age,
+                         std::uint8_t p_groups)
+{
+  if (p_motors.empty()) {
+    return;
+  }
+
+  if (p_motors.size() > max_motors_per_bus) {
+    throw hal::argument_out_of_domain(nullptr);
+  }
+
+  auto const unresponsive = refresh_stale(p_motors,
+                                          *p_motors[0]->m_clock,
+                                          longest_response_timeout(p_motors),
+                                          p_max_age,
+                                          p_groups);
+
+  if (unresponsive != 0) {
+    throw hal::timed_out(p_motors[std::countr_zero(unresponsive)]);
   }
 }
 
+void mc_x::adaptive_timeout(rtt_estimator::settings const& p_settings)
+{
+  m_rtt.emplace(p_settings);
+}
+
+std::optional<rtt_estimator> const& mc_x::round_trip_time() const
+{
+  return m_rtt;
+}
+
 std::int32_t rpm_to_mc_x_speed(rpm p_rpm, float p_dps_per_lsb)
 {
   static constexpr float dps_per_rpm = (1.0f / 1.0_deg_per_sec);
@@ -148,6 +410,34 @@ void mc_x::velocity_control(rpm p_rpm)
   });
 }
 
+void mc_x::velocity_control(rpm p_rpm, hal::ampere p_current_limit)
+{
+  if (m_rated_current <= 0.0f || p_current_limit <= 0.0f) {
+    throw hal::argument_out_of_domain(this);
+  }
+
+  // 0% is what the unlimited velocity_control() sends, so 1% is the lowest
+  auto const percent = std::clamp(
+    std::round(p_current_limit / m_rated_current * 100.0f), 1.0f, 255.0f);
+  auto const speed_data = rpm_to_mc_x_speed(p_rpm, dps_per_lsb_speed);
+
+  send({
+    hal::value(actuate::speed),
+    static_cast<hal::byte>(percent),
+    0x00,
+    0x00,
+    static_cast<hal::byte>((speed_data >> 0) & 0xFF),
+    static_cast<hal::byte>((speed_data >> 8) & 0xFF),
+    static_cast<hal::byte>((speed_data >> 16) & 0xFF),
+    static_cast<hal::byte>((speed_data >> 24) & 0xFF),
+  });
+}
+
+void mc_x::rated_current(hal::ampere p_rated_current)
+{
+  m_rated_current = p_rated_current;
+}
+
 void mc_x::position_control(degrees p_angle, rpm p_rpm)  // NOLINT
 {
   static constexpr float deg_per_lsb = 0.01f;
@@ -168,6 +458,26 @@ void mc_x::position_control(degrees p_angle, rpm p_rpm)  // NOLINT
   });
 }
 
+void mc_x::incremental_position_control(degrees p_angle, rpm p_rpm)  // NOLINT
+{
+  static constexpr float deg_per_lsb = 0.01f;
+  auto const angle = p_angle / deg_per_lsb;
+  auto const angle_data = bounds_check<std::int32_t>(angle);
+  auto const speed_data =
+    rpm_to_mc_x_speed(std::abs(p_rpm * m_gear_ratio), dps_per_lsb_angle);
+
+  send({
+    hal::value(actuate::incremental_position),
+    0x00,
+    static_cast<hal::byte>((speed_data >> 0) & 0xFF),
+    static_cast<hal::byte>((speed_data >> 8) & 0xFF),
+    static_cast<hal::byte>((angle_data >> 0) & 0xFF),
+    static_cast<hal::byte>((angle_data >> 8) & 0xFF),
+    static_cast<hal::byte>((angle_data >> 16) & 0xFF),
+    static_cast<hal::byte>((angle_data >> 24) & 0xFF),
+  });
+}
+
 void mc_x::feedback_request(read p_command)
 {
   send({
@@ -210,16 +520,34 @@ void mc_x::operator()(can::message_t const& p_message)
     return;
   }
 
+  if (p_message.payload[0] == m_transmitted_command) {
+    m_feedback.acknowledged_number = m_feedback.message_number;
+  }
+
+  if constexpr (trace_enabled) {
+    trace(trace_event::reply_decoded,
+          m_device_id,
+          p_message.payload[0],
+          m_clock->uptime());
+  }
+
   switch (p_message.payload[0]) {
     case hal::value(read::status_2):
     case hal::value(actuate::torque):
     case hal::value(actuate::speed):
-    case hal::value(actuate::position): {
+    case hal::value(actuate::position):
+    case hal::value(actuate::incremental_position): {
       auto& data = p_message.payload;
       m_feedback.raw_motor_temperature = static_cast<int8_t>(data[1]);
       m_feedback.raw_current = static_cast<int16_t>((data[3] << 8) | data[2]);
       m_feedback.raw_speed = static_cast<int16_t>((data[5] << 8) | data[4]);
       m_feedback.encoder = static_cast<int16_t>((data[7] << 8) | data[6]);
+      auto const now = m_clock->uptime();
+      mark_updated(m_feedback,
+                   hal::value(field_group::motion) |
+                     hal::value(field_group::temperature),
+                   now);
+      run_motion_reply_hooks(*this, now);
       break;
     }
     case hal::value(read::status_1_and_error_flags): {
@@ -229,12 +557,20 @@ void mc_x::operator()(can::message_t const& p_message)
       m_feedback.raw_volts = static_cast<int16_t>((data[5] << 8) | data[4]);
       auto error_state = data[7] << 8 | data[6];
       m_feedback.raw_error_state = static_cast<int16_t>(error_state);
+      mark_updated(m_feedback,
+                   hal::value(field_group::status) |
+                     hal::value(field_group::temperature),
+                   m_clock->uptime());
       break;
     }
     case hal::value(read::multi_turns_angle): {
       auto& data = p_message.payload;
       m_feedback.raw_multi_turn_angle = static_cast<std::int32_t>(
         data[7] << 24 | data[6] << 16 | data[5] << 8 | data[4]);
+      auto const now = m_clock->uptime();
+      mark_updated(m_feedback, hal::value(field_group::angle), now);
+      // MC-X angles are already output shaft angles
+      run_angle_reply_hooks(*this, now, m_feedback.angle());
       break;
     }
     default:
@@ -28,15 +28,27 @@ void mc_x_servo::driver_position(hal::degrees p_position)
   m_mc_x->position_control(p_position, m_max_speed);
 }
 
-mc_x_motor::mc_x_motor(mc_x& p_mc_x, hal::rpm p_max_speed)
+void mc_x_servo::move_by(hal::degrees p_angle)
+{
+  m_mc_x->incremental_position_control(p_angle, m_max_speed);
+}
+
+mc_x_motor::mc_x_motor(mc_x& p_mc_x,
+                       hal::rpm p_max_speed,
+                       hal::ampere p_current_limit)
   : m_mc_x(&p_mc_x)
   , m_max_speed(p_max_speed)
+  , m_current_limit(p_current_limit)
 {
 }
 
 void mc_x_motor::driver_power(float p_power)
 {
-  m_mc_x->velocity_control(m_max_speed * p_power);
+  if (m_current_limit > 0.0f) {
+    m_mc_x->velocity_control(m_max_speed * p_power, m_current_limit);
+  } else {
+    m_mc_x->velocity_control(m_max_speed * p_power);
+  }
 }
 
 mc_x_temperature::mc_x_temperature(mc_x& p_mc_x)
@@ -75,7 +87,13 @@ hal::ampere mc_x_current_sensor::driver_read()
 
 mc_x_motor make_motor(mc_x& p_mc_x, hal::rpm p_max_speed)
 {
-  return { p_mc_x, p_max_speed };
+  return { p_mc_x, p_max_speed, 0.0f };
+}
+mc_x_motor make_motor(mc_x& p_mc_x,
+                      hal::rpm p_max_speed,
+                      hal::ampere p_current_limit)
+{
+  return { p_mc_x, p_max_speed, p_current_limit };
 }
 mc_x_rotation make_rotation_sensor(mc_x& p_mc_x)
 {
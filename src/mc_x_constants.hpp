@@ -10,6 +10,9 @@ static constexpr float dps_per_lsb_angle = 1.0f;
 /// Messages returned from these motor drivers are the same as motor ID plus
 /// this offset.
 static constexpr std::uint32_t response_id_offset = 0x100;
+/// Commands sent to this ID are received by every motor on the bus. Each motor
+/// responds with its own response ID.
+static constexpr std::uint32_t multi_motor_command_id = 0x280;
 /// Error state flag indicating the motor is stalling or has stalled
 static constexpr std::uint16_t motor_stall_mask = 0x0002;
 /// Error state flag indicating the motor is suffering from low pressure...
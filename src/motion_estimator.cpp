@@ -0,0 +1,112 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/motion_estimator.hpp>
+
+namespace hal::rmd {
+motion_estimator::motion_estimator(hal::hertz p_frequency,
+                                   settings const& p_settings)
+  : m_settings(p_settings)
+  , m_frequency(p_frequency)
+{
+}
+
+float motion_estimator::seconds_since_update(std::uint64_t p_timestamp) const
+{
+  if (p_timestamp <= m_last_update) {
+    return 0.0f;
+  }
+  return static_cast<float>(p_timestamp - m_last_update) / m_frequency;
+}
+
+motion_estimator::state_t motion_estimator::extrapolate(
+  std::uint64_t p_timestamp) const
+{
+  auto const dt = seconds_since_update(p_timestamp);
+  auto const& [position, velocity, acceleration] = m_state;
+
+  return {
+    .position = position + velocity * dt + 0.5f * acceleration * dt * dt,
+    .velocity = velocity + acceleration * dt,
+    .acceleration = acceleration,
+  };
+}
+
+void motion_estimator::predict(std::uint64_t p_timestamp)
+{
+  m_state = extrapolate(p_timestamp);
+  if (p_timestamp > m_last_update) {
+    m_last_update = p_timestamp;
+  }
+  if (m_samples < UINT32_MAX) {
+    m_samples++;
+  }
+}
+
+void motion_estimator::update_position(std::uint64_t p_timestamp,
+                                       float p_degrees)
+{
+  if (not m_position_seeded) {
+    m_state.position = p_degrees;
+    m_last_update = p_timestamp;
+    m_position_seeded = true;
+    m_samples++;
+    return;
+  }
+
+  auto const dt = seconds_since_update(p_timestamp);
+  predict(p_timestamp);
+
+  auto const residual = p_degrees - m_state.position;
+  m_state.position += m_settings.alpha * residual;
+
+  // Without elapsed time, the residual says nothing about the derivatives
+  if (dt > 0.0f) {
+    m_state.velocity += (m_settings.beta / dt) * residual;
+    m_state.acceleration += (2.0f * m_settings.gamma / (dt * dt)) * residual;
+  }
+}
+
+void motion_estimator::update_velocity(std::uint64_t p_timestamp,
+                                       float p_degrees_per_second)
+{
+  predict(p_timestamp);
+
+  auto const residual = p_degrees_per_second - m_state.velocity;
+  m_state.velocity += m_settings.velocity_gain * residual;
+}
+
+motion_estimator::state_t const& motion_estimator::state() const
+{
+  return m_state;
+}
+
+std::uint64_t motion_estimator::last_update() const
+{
+  return m_last_update;
+}
+
+std::uint32_t motion_estimator::samples() const
+{
+  return m_samples;
+}
+
+void motion_estimator::reset()
+{
+  m_state = {};
+  m_last_update = 0;
+  m_samples = 0;
+  m_position_seeded = false;
+}
+}  // namespace hal::rmd
@@ -0,0 +1,88 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/multi_turn_tracker.hpp>
+
+namespace hal::rmd {
+multi_turn_tracker::multi_turn_tracker(float p_gear_ratio,
+                                       settings const& p_settings)
+  : m_settings(p_settings)
+  , m_degrees_per_count(
+      360.0f / (static_cast<float>(p_settings.counts_per_turn) * p_gear_ratio))
+{
+}
+
+void multi_turn_tracker::seed(hal::degrees p_angle)
+{
+  if (tracking()) {
+    m_drift = p_angle - m_angle;
+  }
+
+  m_angle = p_angle;
+  m_seeded = true;
+  m_waiting_for_reference = not m_has_encoder;
+  m_updates_since_seed = 0;
+}
+
+void multi_turn_tracker::update(std::int16_t p_encoder)
+{
+  auto const counts = m_settings.counts_per_turn;
+  auto const encoder = static_cast<std::uint16_t>(p_encoder) % counts;
+
+  if (m_seeded && not m_waiting_for_reference) {
+    // Shortest signed distance around the encoder circle
+    auto difference = static_cast<std::int64_t>(encoder) - m_last_encoder;
+    auto const half = static_cast<std::int64_t>(counts / 2);
+    if (difference >= half) {
+      difference -= counts;
+    } else if (difference < -half) {
+      difference += counts;
+    }
+    m_angle += static_cast<float>(difference) * m_degrees_per_count;
+  }
+
+  m_last_encoder = encoder;
+  m_has_encoder = true;
+  m_waiting_for_reference = false;
+
+  if (m_seeded && m_updates_since_seed < UINT32_MAX) {
+    m_updates_since_seed++;
+  }
+}
+
+bool multi_turn_tracker::tracking() const
+{
+  return m_seeded && not m_waiting_for_reference;
+}
+
+hal::degrees multi_turn_tracker::angle() const
+{
+  return m_angle;
+}
+
+bool multi_turn_tracker::resync_due() const
+{
+  return not m_seeded || m_updates_since_seed >= m_settings.resync_interval;
+}
+
+std::uint32_t multi_turn_tracker::updates_since_seed() const
+{
+  return m_updates_since_seed;
+}
+
+hal::degrees multi_turn_tracker::drift() const
+{
+  return m_drift;
+}
+}  // namespace hal::rmd
@@ -0,0 +1,96 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/rtt_estimator.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace hal::rmd {
+namespace {
+/// Limits the backoff to 2^6 = 64x the estimated timeout which is plenty to
+/// reach any reasonable ceiling.
+constexpr std::uint8_t max_backoff = 6;
+
+hal::time_duration to_duration(float p_nanoseconds)
+{
+  using rep = hal::time_duration::rep;
+  return hal::time_duration(static_cast<rep>(p_nanoseconds));
+}
+}  // namespace
+
+rtt_estimator::rtt_estimator(settings const& p_settings)
+  : m_settings(p_settings)
+{
+}
+
+void rtt_estimator::record(hal::time_duration p_round_trip_time)
+{
+  auto const sample = static_cast<float>(p_round_trip_time.count());
+
+  m_backoff = 0;
+
+  if (m_samples == 0) {
+    // Same seed TCP uses, assume the deviation is half of the first sample
+    m_mean_ns = sample;
+    m_variance_ns = (sample / 2.0f) * (sample / 2.0f);
+  } else {
+    auto const gain = m_settings.gain;
+    auto const difference = sample - m_mean_ns;
+    m_mean_ns += gain * difference;
+    m_variance_ns =
+      (1.0f - gain) * (m_variance_ns + gain * difference * difference);
+  }
+
+  if (m_samples < UINT32_MAX) {
+    m_samples++;
+  }
+}
+
+void rtt_estimator::record_timeout()
+{
+  m_backoff = std::min<std::uint8_t>(m_backoff + 1, max_backoff);
+}
+
+hal::time_duration rtt_estimator::timeout() const
+{
+  if (m_samples == 0) {
+    return m_settings.ceiling;
+  }
+
+  auto const estimate =
+    (m_mean_ns + m_settings.deviations * std::sqrt(m_variance_ns)) *
+    static_cast<float>(1U << m_backoff);
+  auto const ceiling = static_cast<float>(m_settings.ceiling.count());
+
+  auto const bounded = to_duration(std::min(estimate, ceiling));
+
+  return std::clamp(bounded, m_settings.floor, m_settings.ceiling);
+}
+
+hal::time_duration rtt_estimator::mean() const
+{
+  return to_duration(m_mean_ns);
+}
+
+hal::time_duration rtt_estimator::deviation() const
+{
+  return to_duration(std::sqrt(m_variance_ns));
+}
+
+std::uint32_t rtt_estimator::samples() const
+{
+  return m_samples;
+}
+}  // namespace hal::rmd
@@ -0,0 +1,169 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/scheduler.hpp>
+
+#include <libhal-util/enum.hpp>
+#include <libhal-util/steady_clock.hpp>
+
+namespace hal::rmd {
+namespace {
+std::uint32_t acknowledged_number(scheduler::motor_t p_motor)
+{
+  return std::visit(
+    [](auto* p_driver) { return p_driver->feedback().acknowledged_number; },
+    p_motor);
+}
+}  // namespace
+
+scheduler::priority scheduler::classify(hal::byte p_command)
+{
+  switch (p_command) {
+    case hal::value(drc::system::off):
+    case hal::value(drc::system::stop):
+      return priority::emergency;
+    case hal::value(mc_x::actuate::torque):
+    case hal::value(drc::actuate::speed):
+    case hal::value(drc::actuate::position_2):
+    case hal::value(mc_x::actuate::position):
+    // Same command byte for both drivers
+    case hal::value(drc::actuate::incremental_position):
+      return priority::setpoint;
+    case hal::value(drc::read::multi_turns_angle):
+    case hal::value(drc::read::status_1_and_error_flags):
+    case hal::value(drc::read::status_2):
+      return priority::telemetry;
+    default:
+      return priority::configuration;
+  }
+}
+
+scheduler::scheduler(hal::steady_clock& p_clock,
+                     hal::time_duration p_response_timeout)
+  : m_clock(&p_clock)
+  , m_response_timeout(p_response_timeout)
+{
+}
+
+bool scheduler::submit(motor_t p_motor,
+                       std::array<hal::byte, 8> p_payload,
+                       priority p_priority)
+{
+  auto& queue = m_queues[hal::value(p_priority)];
+
+  if (queue.count == queue_depth) {
+    return false;
+  }
+
+  auto const tail = (queue.head + queue.count) % queue_depth;
+  queue.entries[tail] = entry_t{ .motor = p_motor, .payload = p_payload };
+  queue.count++;
+
+  return true;
+}
+
+bool scheduler::submit(motor_t p_motor, std::array<hal::byte, 8> p_payload)
+{
+  return submit(p_motor, p_payload, classify(p_payload[0]));
+}
+
+bool scheduler::in_flight_finished()
+{
+  // Only advanced by a response to the in flight command, so a late response
+  // to a preempted command is not mistaken for it.
+  if (acknowledged_number(m_in_flight) != m_snapshot) {
+    m_stats.completed++;
+    return true;
+  }
+
+  if (m_deadline <= m_clock->uptime()) {
+    m_stats.timeouts++;
+    return true;
+  }
+
+  auto const& emergency = m_queues[hal::value(priority::emergency)];
+  if (emergency.count != 0 && m_in_flight_priority != priority::emergency) {
+    m_stats.preempted++;
+    return true;
+  }
+
+  return false;
+}
+
+bool scheduler::service()
+{
+  if (m_busy) {
+    if (not in_flight_finished()) {
+      return true;
+    }
+    m_busy = false;
+  }
+
+  for (std::size_t level = 0; level < priority_levels; level++) {
+    auto& queue = m_queues[level];
+
+    if (queue.count == 0) {
+      continue;
+    }
+
+    auto const entry = queue.entries[queue.head];
+    queue.head = (queue.head + 1) % queue_depth;
+    queue.count--;
+
+    m_in_flight = entry.motor;
+    m_in_flight_priority = static_cast<priority>(level);
+    m_snapshot = acknowledged_number(entry.motor);
+    m_deadline = hal::future_deadline(*m_clock, m_response_timeout);
+    m_busy = true;
+
+    std::visit([&entry](auto* p_driver) { p_driver->transmit(entry.payload); },
+               entry.motor);
+    m_stats.sent++;
+
+    return true;
+  }
+
+  return false;
+}
+
+void scheduler::flush()
+{
+  while (service()) {
+    continue;
+  }
+}
+
+std::size_t scheduler::pending(priority p_priority) const
+{
+  return m_queues[hal::value(p_priority)].count;
+}
+
+bool scheduler::idle() const
+{
+  if (m_busy) {
+    return false;
+  }
+  for (auto const& queue : m_queues) {
+    if (queue.count != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+scheduler::stats_t const& scheduler::stats() const
+{
+  return m_stats;
+}
+}  // namespace hal::rmd
@@ -0,0 +1,224 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/simulated_bus.hpp>
+
+#include <algorithm>
+
+#include <libhal-rmd/bus_planner.hpp>
+
+namespace hal::rmd {
+simulated_bus::host_port::host_port(simulated_bus& p_bus)
+  : m_bus(&p_bus)
+{
+}
+
+void simulated_bus::host_port::driver_configure(settings const&)
+{
+}
+
+void simulated_bus::host_port::driver_bus_on()
+{
+}
+
+void simulated_bus::host_port::driver_send(message_t const& p_message)
+{
+  m_bus->m_nodes[0].queue.push_back({ m_bus->m_now, p_message });
+}
+
+void simulated_bus::host_port::driver_on_receive(
+  hal::callback<handler> p_handler)
+{
+  m_bus->m_receive = p_handler;
+}
+
+simulated_bus::simulated_bus()
+  : simulated_bus(settings{})
+{
+}
+
+simulated_bus::simulated_bus(settings const& p_settings)
+  : m_settings(p_settings)
+  , m_host(*this)
+  , m_nodes(1)
+  , m_random(p_settings.seed == 0 ? 1 : p_settings.seed)
+{
+}
+
+void simulated_bus::add_device(device_t const& p_device)
+{
+  m_nodes.push_back({ .device = p_device, .queue = {} });
+}
+
+hal::can& simulated_bus::host()
+{
+  return m_host;
+}
+
+void simulated_bus::advance(std::uint64_t p_nanoseconds)
+{
+  advance_to(m_now + p_nanoseconds);
+}
+
+std::uint64_t simulated_bus::now() const
+{
+  return m_now;
+}
+
+std::uint64_t simulated_bus::frame_ns(std::uint8_t p_length) const
+{
+  auto const bits =
+    bus_planner::frame_bits(p_length, false, m_settings.worst_case_stuffing);
+  return static_cast<std::uint64_t>(bits * 1e9 / m_settings.baudrate);
+}
+
+float simulated_bus::utilization() const
+{
+  if (m_now == 0) {
+    return 0.0f;
+  }
+  return static_cast<float>(static_cast<double>(m_stats.busy_ns) / m_now);
+}
+
+simulated_bus::stats_t const& simulated_bus::stats() const
+{
+  return m_stats;
+}
+
+hal::hertz simulated_bus::driver_frequency()
+{
+  return 1'000'000'000.0f;
+}
+
+std::uint64_t simulated_bus::driver_uptime()
+{
+  advance(m_settings.poll_ns);
+  return m_now;
+}
+
+void simulated_bus::advance_to(std::uint64_t p_time)
+{
+  // A receive handler that reads the clock must not re-enter the simulation
+  if (m_advancing) {
+    return;
+  }
+  m_advancing = true;
+
+  while (true) {
+    if (m_sender) {
+      if (p_time < m_busy_until) {
+        break;
+      }
+      finish_frame();
+      continue;
+    }
+    if (not start_next_frame(p_time)) {
+      break;
+    }
+  }
+
+  m_now = std::max(m_now, p_time);
+  m_advancing = false;
+}
+
+bool simulated_bus::start_next_frame(std::uint64_t p_limit)
+{
+  // The bus becomes available when it goes idle or when the first frame is
+  // ready, whichever is later.
+  std::optional<std::uint64_t> first_ready;
+  for (auto const& node : m_nodes) {
+    if (not node.queue.empty()) {
+      auto const ready_at = node.queue.front().ready_at;
+      first_ready = std::min(first_ready.value_or(ready_at), ready_at);
+    }
+  }
+  if (not first_ready) {
+    return false;
+  }
+  auto const start = std::max(m_idle_at, *first_ready);
+  if (p_limit < start) {
+    return false;
+  }
+
+  // Every node with a frame ready at the start of the frame arbitrates, the
+  // lowest ID wins and ties go to the node that was added first.
+  std::optional<std::size_t> winner;
+  std::uint64_t contenders = 0;
+  for (std::size_t i = 0; i < m_nodes.size(); i++) {
+    auto const& queue = m_nodes[i].queue;
+    if (queue.empty() || start < queue.front().ready_at) {
+      continue;
+    }
+    contenders++;
+    if (not winner ||
+        queue.front().message.id < m_nodes[*winner].queue.front().message.id) {
+      winner = i;
+    }
+  }
+
+  auto const& frame = m_nodes[*winner].queue.front();
+  m_stats.arbitration_losses += contenders - 1;
+  m_stats.worst_access_ns =
+    std::max(m_stats.worst_access_ns, start - frame.ready_at);
+  m_sender = winner;
+  m_busy_until = start + frame_ns(frame.message.length);
+  m_now = std::max(m_now, start);
+  return true;
+}
+
+void simulated_bus::finish_frame()
+{
+  auto const from_host = *m_sender == 0;
+  auto& sender = m_nodes[*m_sender];
+  auto const message = sender.queue.front().message;
+  sender.queue.pop_front();
+  m_sender.reset();
+
+  m_stats.busy_ns += frame_ns(message.length);
+  m_idle_at = m_busy_until;
+  m_now = std::max(m_now, m_busy_until);
+
+  if (not from_host) {
+    m_stats.device_frames++;
+    // The handler may queue more frames from the host
+    m_receive(message);
+    return;
+  }
+
+  m_stats.host_frames++;
+  for (auto& node : m_nodes) {
+    auto const& device = node.device;
+    if (&node == &m_nodes[0] ||
+        (message.id != device.id && message.id != device.broadcast_id)) {
+      continue;
+    }
+    auto reply = message;
+    reply.id = device.reply_id;
+    auto const delay = device.processing_ns + jitter(device.jitter_ns);
+    node.queue.push_back({ m_now + delay, reply });
+  }
+}
+
+std::uint64_t simulated_bus::jitter(std::uint64_t p_bound)
+{
+  if (p_bound == 0) {
+    return 0;
+  }
+  // xorshift32, deterministic for a given seed
+  m_random ^= m_random << 13;
+  m_random ^= m_random >> 17;
+  m_random ^= m_random << 5;
+  return m_random % (p_bound + 1);
+}
+}  // namespace hal::rmd
@@ -0,0 +1,78 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/stall_detector.hpp>
+
+#include <cmath>
+
+namespace hal::rmd {
+stall_detector::stall_detector(hal::hertz p_frequency,
+                               settings const& p_settings)
+  : m_settings(p_settings)
+  , m_window_ticks(static_cast<std::uint64_t>(
+      std::chrono::duration<float>(p_settings.window).count() * p_frequency))
+{
+}
+
+void stall_detector::command(hal::rpm p_speed)
+{
+  m_commanded = p_speed != 0.0f;
+  if (not m_commanded) {
+    m_suspect = false;
+  }
+}
+
+bool stall_detector::update(std::uint64_t p_timestamp,
+                            hal::rpm p_speed,
+                            hal::ampere p_current)
+{
+  auto const suspect = m_commanded &&
+                       std::abs(p_speed) <= m_settings.speed_threshold &&
+                       std::abs(p_current) >= m_settings.current_threshold;
+
+  if (not suspect) {
+    m_suspect = false;
+    m_stalled = false;
+    return false;
+  }
+
+  if (not m_suspect) {
+    m_suspect = true;
+    m_suspect_since = p_timestamp;
+  }
+
+  if (m_stalled || p_timestamp - m_suspect_since < m_window_ticks) {
+    return false;
+  }
+
+  m_stalled = true;
+  m_stalls++;
+  return true;
+}
+
+bool stall_detector::stalled() const
+{
+  return m_stalled;
+}
+
+std::uint32_t stall_detector::stalls() const
+{
+  return m_stalls;
+}
+
+stall_detector::settings const& stall_detector::configuration() const
+{
+  return m_settings;
+}
+}  // namespace hal::rmd
@@ -0,0 +1,319 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/telemetry_log.hpp>
+
+#include <algorithm>
+
+#include <libhal/error.hpp>
+
+namespace hal::rmd {
+namespace {
+constexpr std::array<hal::byte, 5> log_header{ 'R', 'M', 'D', 'L', 1 };
+constexpr hal::byte key_record = 1 << 7;
+constexpr hal::byte index_mask = 0x1F;
+
+// Field groups, a group is stored when any of its fields changed
+constexpr hal::byte angle_group = 1 << 0;
+constexpr hal::byte motion_group = 1 << 1;
+constexpr hal::byte power_group = 1 << 2;
+constexpr hal::byte error_group = 1 << 3;
+constexpr hal::byte all_groups =
+  angle_group | motion_group | power_group | error_group;
+
+/// A varint of a 64-bit value takes at most 10 bytes
+constexpr std::size_t max_varint_size = 10;
+
+constexpr std::uint64_t zigzag(std::int64_t p_value)
+{
+  return (static_cast<std::uint64_t>(p_value) << 1) ^
+         static_cast<std::uint64_t>(p_value >> 63);
+}
+
+constexpr std::int64_t unzigzag(std::uint64_t p_value)
+{
+  return static_cast<std::int64_t>(p_value >> 1) ^
+         -static_cast<std::int64_t>(p_value & 1);
+}
+
+/// Difference of two values of a narrow type, wrapped to that type
+template<class T>
+constexpr std::int64_t wrapped_delta(T p_current, T p_previous)
+{
+  return static_cast<T>(p_current - p_previous);
+}
+
+class record_encoder
+{
+public:
+  void varint(std::uint64_t p_value)
+  {
+    while (p_value >= 0x80) {
+      m_buffer[m_size++] = static_cast<hal::byte>(p_value | 0x80);
+      p_value >>= 7;
+    }
+    m_buffer[m_size++] = static_cast<hal::byte>(p_value);
+  }
+
+  void byte(hal::byte p_value)
+  {
+    m_buffer[m_size++] = p_value;
+  }
+
+  std::span<hal::byte const> encoded() const
+  {
+    return std::span(m_buffer).first(m_size);
+  }
+
+private:
+  std::array<hal::byte, telemetry_log_writer::max_record_size> m_buffer{};
+  std::size_t m_size = 0;
+};
+
+hal::byte changed_groups(telemetry_sample const& p_current,
+                         telemetry_sample const& p_previous)
+{
+  hal::byte groups = 0;
+  if (p_current.raw_multi_turn_angle != p_previous.raw_multi_turn_angle ||
+      p_current.encoder != p_previous.encoder) {
+    groups |= angle_group;
+  }
+  if (p_current.raw_speed != p_previous.raw_speed ||
+      p_current.raw_current != p_previous.raw_current) {
+    groups |= motion_group;
+  }
+  if (p_current.raw_volts != p_previous.raw_volts ||
+      p_current.raw_motor_temperature != p_previous.raw_motor_temperature) {
+    groups |= power_group;
+  }
+  if (p_current.raw_error_state != p_previous.raw_error_state) {
+    groups |= error_group;
+  }
+  return groups;
+}
+}  // namespace
+
+telemetry_log_writer::telemetry_log_writer(sink_t p_sink)
+  : m_sink(std::move(p_sink))
+{
+  m_sink(log_header);
+  m_bytes += log_header.size();
+}
+
+void telemetry_log_writer::write(telemetry_sample const& p_sample)
+{
+  std::size_t index = 0;
+  while (index < m_motors &&
+         m_previous[index].device_id != p_sample.device_id) {
+    index++;
+  }
+
+  bool const key = index == m_motors;
+  if (key && m_motors == max_motors) {
+    throw hal::argument_out_of_domain(this);
+  }
+
+  // Key records are encoded against an all zero sample
+  auto& previous = m_previous[index];
+  if (key) {
+    previous = telemetry_sample{};
+    m_motors++;
+  }
+
+  auto const groups = key ? all_groups : changed_groups(p_sample, previous);
+  record_encoder record;
+  record.byte(static_cast<hal::byte>(index | (key ? key_record : 0)));
+  record.byte(groups);
+  record.varint(p_sample.timestamp - previous.timestamp);
+  record.varint(static_cast<std::uint32_t>(p_sample.message_number -
+                                           previous.message_number));
+  if (key) {
+    record.varint(p_sample.device_id);
+    record.byte(static_cast<hal::byte>(p_sample.model));
+  }
+  if (groups & angle_group) {
+    record.varint(zigzag(static_cast<std::int64_t>(
+      static_cast<std::uint64_t>(p_sample.raw_multi_turn_angle) -
+      static_cast<std::uint64_t>(previous.raw_multi_turn_angle))));
+    record.varint(zigzag(wrapped_delta(p_sample.encoder, previous.encoder)));
+  }
+  if (groups & motion_group) {
+    record.varint(
+      zigzag(wrapped_delta(p_sample.raw_speed, previous.raw_speed)));
+    record.varint(
+      zigzag(wrapped_delta(p_sample.raw_current, previous.raw_current)));
+  }
+  if (groups & power_group) {
+    record.varint(
+      zigzag(wrapped_delta(p_sample.raw_volts, previous.raw_volts)));
+    record.varint(zigzag(wrapped_delta(p_sample.raw_motor_temperature,
+                                       previous.raw_motor_temperature)));
+  }
+  if (groups & error_group) {
+    record.varint(p_sample.raw_error_state);
+  }
+
+  previous = p_sample;
+  auto const encoded = record.encoded();
+  m_sink(encoded);
+  m_bytes += encoded.size();
+  m_samples++;
+}
+
+void telemetry_log_writer::write(std::uint64_t p_timestamp,
+                                 can::id_t p_device_id,
+                                 drc::feedback_t const& p_feedback)
+{
+  write({
+    .timestamp = p_timestamp,
+    .device_id = p_device_id,
+    .model = telemetry_sample::model_t::drc,
+    .message_number = p_feedback.message_number,
+    .raw_multi_turn_angle = p_feedback.raw_multi_turn_angle,
+    .raw_current = p_feedback.raw_current,
+    .raw_speed = p_feedback.raw_speed,
+    .raw_volts = p_feedback.raw_volts,
+    .encoder = p_feedback.encoder,
+    .raw_motor_temperature = p_feedback.raw_motor_temperature,
+    .raw_error_state = p_feedback.raw_error_state,
+  });
+}
+
+void telemetry_log_writer::write(std::uint64_t p_timestamp,
+                                 can::id_t p_device_id,
+                                 mc_x::feedback_t const& p_feedback)
+{
+  write({
+    .timestamp = p_timestamp,
+    .device_id = p_device_id,
+    .model = telemetry_sample::model_t::mc_x,
+    .message_number = p_feedback.message_number,
+    .raw_multi_turn_angle = p_feedback.raw_multi_turn_angle,
+    .raw_current = p_feedback.raw_current,
+    .raw_speed = p_feedback.raw_speed,
+    .raw_volts = p_feedback.raw_volts,
+    .encoder = p_feedback.encoder,
+    .raw_motor_temperature = p_feedback.raw_motor_temperature,
+    .raw_error_state = p_feedback.raw_error_state,
+  });
+}
+
+std::uint64_t telemetry_log_writer::bytes() const
+{
+  return m_bytes;
+}
+
+std::uint64_t telemetry_log_writer::samples() const
+{
+  return m_samples;
+}
+
+telemetry_log_reader::telemetry_log_reader(std::span<hal::byte const> p_log)
+  : m_log(p_log)
+{
+  if (m_log.size() < log_header.size() ||
+      not std::equal(log_header.begin(), log_header.end(), m_log.begin())) {
+    throw hal::io_error(this);
+  }
+  m_offset = log_header.size();
+}
+
+std::optional<telemetry_sample> telemetry_log_reader::next()
+{
+  auto offset = m_offset;
+  bool short_record = false;
+
+  auto const read_byte = [&]() -> hal::byte {
+    if (offset >= m_log.size()) {
+      short_record = true;
+      return 0;
+    }
+    return m_log[offset++];
+  };
+
+  auto const read_varint = [&]() -> std::uint64_t {
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < max_varint_size; i++) {
+      auto const byte = read_byte();
+      value |= std::uint64_t{ byte & 0x7Fu } << (7 * i);
+      if ((byte & 0x80) == 0 || short_record) {
+        return value;
+      }
+    }
+    throw hal::io_error(this);
+  };
+
+  auto const read_delta = [&]() { return unzigzag(read_varint()); };
+
+  if (m_offset == m_log.size()) {
+    return std::nullopt;
+  }
+
+  auto const flags = read_byte();
+  auto const groups = read_byte();
+  bool const key = flags & key_record;
+  std::size_t const index = flags & index_mask;
+
+  if ((key && index != m_motors) || (not key && index >= m_motors)) {
+    throw hal::io_error(this);
+  }
+
+  auto sample = key ? telemetry_sample{} : m_previous[index];
+  sample.timestamp += read_varint();
+  sample.message_number += static_cast<std::uint32_t>(read_varint());
+  if (key) {
+    sample.device_id = static_cast<can::id_t>(read_varint());
+    sample.model = static_cast<telemetry_sample::model_t>(read_byte());
+  }
+  if (groups & angle_group) {
+    sample.raw_multi_turn_angle = static_cast<std::int64_t>(
+      static_cast<std::uint64_t>(sample.raw_multi_turn_angle) +
+      static_cast<std::uint64_t>(read_delta()));
+    sample.encoder = static_cast<std::int16_t>(sample.encoder + read_delta());
+  }
+  if (groups & motion_group) {
+    sample.raw_speed =
+      static_cast<std::int16_t>(sample.raw_speed + read_delta());
+    sample.raw_current =
+      static_cast<std::int16_t>(sample.raw_current + read_delta());
+  }
+  if (groups & power_group) {
+    sample.raw_volts =
+      static_cast<std::int16_t>(sample.raw_volts + read_delta());
+    sample.raw_motor_temperature = static_cast<std::int8_t>(
+      sample.raw_motor_temperature + read_delta());
+  }
+  if (groups & error_group) {
+    sample.raw_error_state = static_cast<std::uint16_t>(read_varint());
+  }
+
+  if (short_record) {
+    m_truncated = true;
+    m_offset = m_log.size();
+    return std::nullopt;
+  }
+
+  if (key) {
+    m_motors++;
+  }
+  m_previous[index] = sample;
+  m_offset = offset;
+  return sample;
+}
+
+bool telemetry_log_reader::truncated() const
+{
+  return m_truncated;
+}
+}  // namespace hal::rmd
@@ -0,0 +1,26 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/trace.hpp>
+
+namespace hal::rmd {
+// Weak so that applications and tools built with LIBHAL_RMD_TRACE link
+// without providing a hook. An application definition replaces this one.
+[[gnu::weak]] void trace(trace_event,
+                         can::id_t,
+                         hal::byte,
+                         std::uint64_t) noexcept
+{
+}
+}  // namespace hal::rmd
@@ -0,0 +1,153 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/any_motor.hpp>
+
+#include <array>
+
+#include <libhal-mock/steady_clock.hpp>
+#include <libhal-rmd/scheduler.hpp>
+
+#include <boost/ut.hpp>
+
+#include "fake_can.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr can::id_t drc_id = 0x141;
+constexpr can::id_t mc_x_id = 0x142;
+
+static_assert(motor_driver<drc>);
+static_assert(motor_driver<mc_x>);
+static_assert(motor_driver<motor<drc, 6, drc_id>>);
+
+/// Generic fleet code, instantiated for each concrete motor type
+template<motor_driver driver>
+void park(driver& p_driver)
+{
+  p_driver.position_control(0.0f, 10.0f);
+}
+}  // namespace
+
+void any_motor_test()
+{
+  using namespace boost::ut;
+
+  fake_can bus;
+  bus.mc_x_ids = { mc_x_id };
+  hal::mock::steady_clock clock;
+  clock.set_frequency(1.0_MHz);
+  hal::can_router router(bus);
+  drc drc_motor(router,
+                clock,
+                6.0f,
+                drc_id,
+                std::chrono::milliseconds(10),
+                drc::startup::attach);
+  mc_x mc_x_motor(router, clock, 36.0f, mc_x_id);
+
+  "any_motor dispatches commands to the concrete driver"_test = [&]() {
+    // Setup
+    bus.spy_send.reset();
+    std::array<any_motor, 2> fleet{ drc_motor, mc_x_motor };
+
+    // Exercise
+    for (auto& motor : fleet) {
+      motor.velocity_control(10.0f);
+    }
+    for (auto& motor : fleet) {
+      motor.position_control(90.0f, 5.0f);
+    }
+    fleet[0].refresh();
+    fleet[1].refresh_angle();
+    fleet[1].stop();
+
+    // Verify
+    expect(that % 7 == bus.sent());
+    // drc speed is geared: 10 rpm * 6 * 600 LSB/rpm = 0x8CA0
+    expect(that % drc_id == bus.spy_send.history<0>(0).id);
+    expect(that % 0xA2 == bus.spy_send.history<0>(0).payload[0]);
+    expect(that % 0xA0 == bus.spy_send.history<0>(0).payload[4]);
+    expect(that % 0x8C == bus.spy_send.history<0>(0).payload[5]);
+    // mc_x speed is not: 10 rpm * 600 LSB/rpm = 0x1770
+    expect(that % mc_x_id == bus.spy_send.history<0>(1).id);
+    expect(that % 0x70 == bus.spy_send.history<0>(1).payload[4]);
+    expect(that % 0x17 == bus.spy_send.history<0>(1).payload[5]);
+    expect(that % 0xA4 == bus.spy_send.history<0>(2).payload[0]);
+    expect(that % 0xA5 == bus.spy_send.history<0>(3).payload[0]);
+    expect(that % 0x9C == bus.spy_send.history<0>(4).payload[0]);
+    expect(that % 0x92 == bus.spy_send.history<0>(5).payload[0]);
+    expect(that % 0x81 == bus.spy_send.history<0>(6).payload[0]);
+  };
+
+  "any_motor::feedback() decodes with the units of the model"_test = [&]() {
+    // Setup
+    bus.response = { 0x9C, 0x32, 0x64, 0x00, 0xF4, 0x01, 0x20, 0x00 };
+    std::array<any_motor, 2> fleet{ drc_motor, mc_x_motor };
+
+    // Exercise
+    fleet[0].refresh();
+    fleet[1].refresh();
+    auto const drc_view = fleet[0].feedback();
+    auto const mc_x_view = fleet[1].feedback();
+    bus.response.reset();
+
+    // Verify
+    auto const& drc_feedback = drc_motor.feedback();
+    expect(motor_feedback::model_t::drc == drc_view.model);
+    expect(that % drc_feedback.message_number == drc_view.message_number);
+    expect(that % drc_feedback.message_number == fleet[0].message_number());
+    expect(that % drc_feedback.current() == drc_view.current);
+    expect(that % drc_feedback.speed() == drc_view.speed);
+    expect(that % drc_feedback.temperature() == drc_view.temperature);
+    expect(that % 50.0f == drc_view.temperature);
+    expect(that % 0x20 == drc_view.encoder);
+
+    auto const& mc_x_feedback = mc_x_motor.feedback();
+    expect(motor_feedback::model_t::mc_x == mc_x_view.model);
+    expect(that % mc_x_feedback.current() == mc_x_view.current);
+    expect(that % mc_x_feedback.speed() == mc_x_view.speed);
+    expect(that % 50.0f == mc_x_view.temperature);
+    expect(not mc_x_view.faulted());
+  };
+
+  "any_motor interoperates with the scheduler and generic code"_test =
+    [&]() {
+      // Setup
+      bus.spy_send.reset();
+      motor<drc, 6, 0x143> static_drc(
+        router, clock, std::chrono::milliseconds(10), drc::startup::attach);
+      any_motor const handle(mc_x_motor);
+      any_motor const static_handle(static_drc);
+
+      // Exercise
+      scheduler::motor_t const as_scheduler_motor = handle.driver();
+      auto const is_mc_x =
+        handle.visit([](auto* p_driver) -> bool {
+          return std::is_same_v<decltype(p_driver), mc_x*>;
+        });
+      park(drc_motor);
+      park(static_drc);
+
+      // Verify
+      expect(that % std::holds_alternative<mc_x*>(as_scheduler_motor));
+      expect(that % is_mc_x);
+      expect(std::get<drc*>(static_handle.driver()) == &static_drc.runtime());
+      expect(that % 2 == bus.sent());
+      expect(that % bus.spy_send.history<0>(0).payload[2] ==
+             bus.spy_send.history<0>(1).payload[2]);
+      expect(that % 0x143 == bus.spy_send.history<0>(1).id);
+    };
+};
+}  // namespace hal::rmd
@@ -0,0 +1,100 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/bus_planner.hpp>
+
+#include <cmath>
+
+#include <boost/ut.hpp>
+
+namespace hal::rmd {
+void bus_planner_test()
+{
+  using namespace boost::ut;
+  using namespace hal::literals;
+
+  "bus_planner::frame_bits()"_test = []() {
+    expect(that % 111 == bus_planner::frame_bits(8, false, false));
+    expect(that % 135 == bus_planner::frame_bits(8, false, true));
+    expect(that % 47 == bus_planner::frame_bits(0, false, false));
+    expect(that % 131 == bus_planner::frame_bits(8, true, false));
+    expect(that % 160 == bus_planner::frame_bits(8, true, true));
+  };
+
+  "bus_planner::admit() accounts for commands and replies"_test = []() {
+    // Setup
+    bus_planner planner({ .utilization_limit = 1.0f });
+
+    // Exercise
+    auto const admitted = planner.admit({ .id = 0x141, .rate = 1000.0_Hz });
+
+    // Verify
+    // 2 frames * 135 bits * 1000 Hz / 1 Mbit/s
+    expect(admitted);
+    expect(std::abs(planner.utilization() - 0.27f) < 0.0001f);
+    expect(that % 1 == planner.size());
+  };
+
+  "bus_planner::admit() rejects oversubscription"_test = []() {
+    // Setup
+    bus_planner planner({ .utilization_limit = 0.7f });
+    std::size_t admitted = 0;
+
+    // Exercise
+    // Each motor at 500 Hz uses 13.5% of the bus
+    for (can::id_t id = 0x141; id < 0x141 + 8; id++) {
+      if (planner.admit({ .id = id, .rate = 500.0_Hz })) {
+        admitted++;
+      }
+    }
+
+    // Verify
+    expect(that % 5 == admitted);
+    expect(that % 5 == planner.size());
+    expect(planner.utilization() <= 0.7f);
+  };
+
+  "bus_planner::achievable_rate()"_test = []() {
+    // Setup
+    bus_planner planner({ .utilization_limit = 0.54f });
+    planner.admit({ .id = 0x141, .rate = 200.0_Hz });
+    planner.admit({ .id = 0x142, .rate = 100.0_Hz });
+    // A broadcast stop to 4 motors
+    planner.admit({ .id = 0x280, .rate = 10.0_Hz, .replies = 4 });
+
+    // Exercise
+    auto const load = planner.utilization();
+    auto const scale = 0.54f / load;
+
+    // Verify
+    expect(std::abs(planner.achievable_rate(0) - 200.0f * scale) < 0.01f);
+    expect(std::abs(planner.achievable_rate(1) - 100.0f * scale) < 0.01f);
+    expect(std::abs(planner.achievable_rate(2) - 10.0f * scale) < 0.01f);
+    expect(that % 0x280 == planner[2].id);
+  };
+
+  "bus_planner custom baudrate"_test = []() {
+    // Setup
+    bus_planner planner({ .baudrate = 500.0_kHz,
+                          .utilization_limit = 1.0f,
+                          .worst_case_stuffing = false });
+
+    // Exercise
+    planner.admit({ .id = 0x141, .rate = 1000.0_Hz });
+
+    // Verify
+    expect(std::abs(planner.utilization() - 0.444f) < 0.0001f);
+  };
+}
+}  // namespace hal::rmd
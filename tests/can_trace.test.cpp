@@ -0,0 +1,214 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/can_trace.hpp>
+
+#include <vector>
+
+#include <libhal-mock/steady_clock.hpp>
+#include <libhal-rmd/drc.hpp>
+#include <libhal-util/enum.hpp>
+
+#include <boost/ut.hpp>
+
+#include "fake_can.hpp"
+
+namespace hal::rmd {
+namespace {
+std::queue<std::uint64_t> create_queue()
+{
+  std::queue<std::uint64_t> new_queue;
+  for (std::uint64_t i = 0; i < 255; i++) {
+    new_queue.push(i * 100);
+  }
+  return new_queue;
+}
+}  // namespace
+
+void can_trace_test()
+{
+  using namespace boost::ut;
+  using namespace std::literals;
+  using namespace hal::literals;
+
+  "can_trace encode/decode round trip"_test = []() {
+    // Setup
+    std::vector<hal::byte> trace;
+    auto const header = encode_trace_header(1.0_MHz);
+    trace.insert(trace.end(), header.begin(), header.end());
+    std::array const records{
+      trace_record{
+        .timestamp = 5,
+        .direction = trace_direction::transmit,
+        .message = { .id = 0x141,
+                     .payload = { 0x9C, 0, 0, 0, 0, 0, 0, 0 },
+                     .length = 8 },
+      },
+      trace_record{
+        .timestamp = 1'000'000'000'000,
+        .direction = trace_direction::receive,
+        .message = { .id = 0x1234567,
+                     .payload = { 0xAA, 0xBB, 0xCC },
+                     .length = 3 },
+      },
+      trace_record{
+        .timestamp = 1'000'000'000'001,
+        .direction = trace_direction::receive,
+        .message = { .id = 0x241, .length = 0, .is_remote_request = true },
+      },
+    };
+    std::uint64_t previous = 0;
+    std::array<hal::byte, max_trace_record_size> buffer{};
+    for (auto const& record : records) {
+      auto const encoded = encode_trace_record(record, previous, buffer);
+      trace.insert(trace.end(), encoded.begin(), encoded.end());
+      previous = record.timestamp;
+    }
+
+    // Exercise
+    can_trace_reader reader(trace);
+    std::vector<trace_record> decoded;
+    while (auto record = reader.next()) {
+      decoded.push_back(*record);
+    }
+
+    // Verify
+    expect(that % 1.0_MHz == reader.frequency());
+    expect(that % records.size() == decoded.size());
+    for (std::size_t i = 0; i < records.size(); i++) {
+      expect(that % records[i].timestamp == decoded[i].timestamp);
+      expect(records[i].direction == decoded[i].direction);
+      expect(that % records[i].message == decoded[i].message);
+    }
+    // Standard IDs with a full payload take 12 bytes, with a small delta
+    expect(that % (trace_header_size + 12 + 14 + 4) == trace.size());
+  };
+
+  "can_trace_reader rejects bad header"_test = []() {
+    std::array<hal::byte, trace_header_size> bad_magic{ 'N', 'O', 'P', 'E' };
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { can_trace_reader reader(bad_magic); }));
+  };
+
+  "format_candump()"_test = []() {
+    // Setup
+    std::array<char, 64> buffer{};
+    trace_record const record{
+      .timestamp = 1'000'250,
+      .direction = trace_direction::transmit,
+      .message = {
+        .id = 0x141,
+        .payload = { 0x9C, 0x00, 0x01, 0x02, 0x03, 0x04, 0xAB, 0xFF },
+        .length = 8,
+      },
+    };
+
+    // Exercise
+    auto const line = format_candump(record, 1.0_MHz, buffer);
+    auto const sub_hertz = throws<hal::argument_out_of_domain>(
+      [&]() { format_candump(record, 0.5_Hz, buffer); });
+    auto const zero = throws<hal::argument_out_of_domain>(
+      [&]() { format_candump(record, 0.0_Hz, buffer); });
+
+    // Verify
+    expect(that % "(0000000001.000250) can0 141#9C0001020304ABFF\n"sv == line);
+    expect(sub_hertz);
+    expect(zero);
+  };
+
+  "parse_candump()"_test = []() {
+    // Setup
+    std::array<char, 64> buffer{};
+    trace_record const record{
+      .timestamp = 1'000'250,
+      .direction = trace_direction::receive,
+      .message = {
+        .id = 0x241,
+        .payload = { 0x9C, 0x32, 0x00, 0x10, 0x00, 0xF4, 0x01, 0x20 },
+        .length = 8,
+      },
+    };
+    auto const line = format_candump(record, 1.0_MHz, buffer);
+
+    // Exercise
+    auto const round_trip = parse_candump(line);
+    auto const extended = parse_candump("(12.5) vcan1 12345678#0102");
+    auto const remote = parse_candump("(0.000001) can0 141#R\r\n");
+    auto const fd = parse_candump("(0.000001) can0 141##0112233");
+    auto const odd = parse_candump("(0.000001) can0 141#123");
+    auto const oversized = parse_candump("(0.1) can0 141#000102030405060708");
+    auto const not_hex = parse_candump("(0.1) can0 14G#00");
+    auto const no_timestamp = parse_candump("can0 141#00");
+
+    // Verify
+    expect(that % round_trip.has_value());
+    expect(that % record.timestamp == round_trip->timestamp);
+    expect(trace_direction::receive == round_trip->direction);
+    expect(record.message == round_trip->message);
+
+    expect(that % extended.has_value());
+    expect(that % 12'500'000 == extended->timestamp);
+    expect(that % 0x1234'5678 == extended->message.id);
+    expect(that % 2 == extended->message.length);
+    expect(that % 0x02 == extended->message.payload[1]);
+
+    expect(that % remote.has_value());
+    expect(that % 1 == remote->timestamp);
+    expect(that % remote->message.is_remote_request);
+    expect(that % 0 == remote->message.length);
+
+    expect(not fd.has_value());
+    expect(not odd.has_value());
+    expect(not oversized.has_value());
+    expect(not not_hex.has_value());
+    expect(not no_timestamp.has_value());
+  };
+
+  "can_trace_recorder & can_trace_replay"_test = []() {
+    // Setup
+    fake_can loopback;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    std::vector<hal::byte> trace;
+    can_trace_recorder recorder(
+      loopback, mock_steady, [&trace](std::span<hal::byte const> p_data) {
+        trace.insert(trace.end(), p_data.begin(), p_data.end());
+      });
+    hal::can_router router(recorder);
+    drc recorded_motor(router, mock_steady, 6.0f, 0x141);
+    recorded_motor.feedback_request(drc::read::status_2);
+
+    // Exercise
+    can_trace_replay replay(trace);
+    hal::can_router replay_router(replay);
+    drc replayed_motor(replay_router,
+                       mock_steady,
+                       6.0f,
+                       0x141,
+                       10ms,
+                       drc::startup::attach);
+    auto const delivered = replay.replay_all();
+
+    // Verify
+    // system::off, system::running & status_2 each sent then received
+    expect(that % 6 == recorder.frames());
+    expect(that % 3 == delivered);
+    expect(that % 0 == replay.frames_sent());
+    expect(that % recorded_motor.feedback().message_number ==
+           replayed_motor.feedback().message_number);
+  };
+};
+}  // namespace hal::rmd
@@ -0,0 +1,103 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/chrome_trace.hpp>
+
+#include <string>
+#include <string_view>
+
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal::rmd {
+namespace {
+bool contains(std::string const& p_text, std::string_view p_pattern)
+{
+  return p_text.find(p_pattern) != std::string::npos;
+}
+}  // namespace
+
+void chrome_trace_test()
+{
+  using namespace boost::ut;
+  using namespace std::literals;
+  using namespace hal::literals;
+
+  "chrome_trace_writer request slices"_test = []() {
+    // Setup
+    std::string json;
+    chrome_trace_writer writer(1.0_MHz, [&json](std::span<char const> p_text) {
+      json.append(p_text.begin(), p_text.end());
+    });
+
+    // Exercise
+    writer(trace_event::frame_sent, 0x141, 0x9C, 1'000);
+    writer(trace_event::reply_decoded, 0x141, 0x9C, 1'250);
+    writer(trace_event::frame_sent, 0x142, 0xA2, 2'000);
+    writer(trace_event::timeout, 0x142, 0xA2, 12'000);
+    writer.finish();
+    // Events after finishing are dropped
+    writer(trace_event::frame_sent, 0x141, 0x9C, 20'000);
+
+    // Verify
+    expect(that % 5 == writer.events());
+    expect(json.starts_with("{\"traceEvents\":[\n"));
+    expect(json.ends_with("\n]}\n"));
+    expect(contains(
+      json,
+      "{\"name\":\"request\",\"cat\":\"rmd\",\"ph\":\"B\",\"ts\":1000.000,"
+      "\"pid\":1,\"tid\":321,\"s\":\"t\",\"args\":{\"command\":\"0x9C\"}}"));
+    expect(
+      contains(json, "\"ph\":\"E\",\"ts\":1250.000,\"pid\":1,\"tid\":321"));
+    expect(contains(json,
+                    "\"name\":\"timeout\",\"cat\":\"rmd\",\"ph\":\"i\","
+                    "\"ts\":12000.000,\"pid\":1,\"tid\":322"));
+    expect(not contains(json, "20000"));
+  };
+
+  "chrome_trace_writer sub-microsecond timestamps"_test = []() {
+    // Setup
+    std::string json;
+    chrome_trace_writer writer(3.0_MHz, [&json](std::span<char const> p_text) {
+      json.append(p_text.begin(), p_text.end());
+    });
+
+    // Exercise
+    writer(trace_event::frame_sent, 0x141, 0x9C, 3'000'000'000'001);
+
+    // Verify
+    expect(contains(json, "\"ts\":1000000000000.333,"));
+  };
+
+  "chrome_trace_writer rejects sub hertz frequencies"_test = []() {
+    // Setup
+    std::string json;
+    auto const sink = [&json](std::span<char const> p_text) {
+      json.append(p_text.begin(), p_text.end());
+    };
+
+    // Exercise
+    auto const sub_hertz = throws<hal::argument_out_of_domain>(
+      [&]() { chrome_trace_writer writer(0.5_Hz, sink); });
+    auto const zero = throws<hal::argument_out_of_domain>(
+      [&]() { chrome_trace_writer writer(0.0_Hz, sink); });
+
+    // Verify
+    expect(sub_hertz);
+    expect(zero);
+    expect(json.empty());
+  };
+}
+}  // namespace hal::rmd
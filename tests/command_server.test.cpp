@@ -0,0 +1,211 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/linux/command_server.hpp>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <libhal-util/can.hpp>
+#include <libhal-util/enum.hpp>
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+#include "fake_can.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr can::id_t first_id = 0x141;
+constexpr can::id_t silent_id = 0x14F;
+
+struct host_clock : public hal::steady_clock
+{
+private:
+  hal::hertz driver_frequency() override
+  {
+    return 1'000'000'000.0f;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    auto const now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  }
+};
+
+drc make_drc(hal::can_router& p_router,
+             hal::steady_clock& p_clock,
+             can::id_t p_id)
+{
+  return drc(p_router,
+             p_clock,
+             1.0f,
+             p_id,
+             std::chrono::milliseconds(1),
+             drc::startup::attach);
+}
+}  // namespace
+
+void command_server_test()
+{
+  using namespace boost::ut;
+  using namespace std::literals;
+
+  "mpsc_queue is first in first out and bounded"_test = []() {
+    // Setup
+    mpsc_queue<int, 4> queue;
+
+    // Exercise
+    std::vector<bool> pushed;
+    for (int i = 0; i < 5; i++) {
+      pushed.push_back(queue.push(int{ i }));
+    }
+    std::vector<int> popped;
+    while (auto value = queue.pop()) {
+      popped.push_back(*value);
+    }
+
+    // Verify
+    expect(pushed == std::vector<bool>{ true, true, true, true, false });
+    expect(popped == std::vector<int>{ 0, 1, 2, 3 });
+    expect(queue.push(5));
+  };
+
+  "mpsc_queue keeps every value under contention"_test = []() {
+    // Setup
+    constexpr int producers = 4;
+    constexpr int per_producer = 10'000;
+    mpsc_queue<int, 64> queue;
+    std::vector<std::jthread> threads;
+    std::vector<int> counts(producers, 0);
+    std::vector<int> last(producers, -1);
+    bool ordered = true;
+
+    // Exercise
+    for (int p = 0; p < producers; p++) {
+      threads.emplace_back([&queue, p]() {
+        for (int i = 0; i < per_producer; i++) {
+          while (not queue.push(p * per_producer + i)) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    for (int received = 0; received < producers * per_producer;) {
+      auto value = queue.pop();
+      if (not value) {
+        continue;
+      }
+      auto const producer = *value / per_producer;
+      auto const sequence = *value % per_producer;
+      // Values from each producer must arrive in the order they were pushed
+      ordered = ordered && last[producer] < sequence;
+      last[producer] = sequence;
+      counts[producer]++;
+      received++;
+    }
+
+    // Verify
+    expect(ordered);
+    expect(counts == std::vector<int>(producers, per_producer));
+    expect(not queue.pop().has_value());
+  };
+
+  "command_server::submit() returns the motor feedback"_test = []() {
+    // Setup
+    fake_can bus;
+    host_clock clock;
+    hal::can_router router(bus);
+    auto motor = make_drc(router, clock, first_id);
+    auto const before = motor.feedback().message_number;
+    command_server server(clock);
+
+    // Exercise
+    auto future =
+      server.submit(&motor, { hal::value(drc::read::status_2) }).value();
+    auto const feedback = std::get<drc::feedback_t>(future.get());
+
+    // Verify
+    expect(that % before + 1 == feedback.message_number);
+  };
+
+  "command_server::submit() reports a timeout through the future"_test =
+    []() {
+      // Setup
+      fake_can bus;
+      bus.silent_ids = { silent_id };
+      host_clock clock;
+      hal::can_router router(bus);
+      auto motor = make_drc(router, clock, silent_id);
+      command_server server(clock);
+
+      // Exercise
+      auto future =
+        server.submit(&motor, { hal::value(drc::read::status_2) }).value();
+
+      // Verify
+      expect(throws<hal::timed_out>([&future]() { future.get(); }));
+    };
+
+  "command_server completes every command from many producers"_test = []() {
+    // Setup
+    constexpr int producers = 4;
+    constexpr int per_producer = 500;
+    constexpr int motor_count = 8;
+    fake_can bus;
+    host_clock clock;
+    hal::can_router router(bus);
+    std::vector<std::unique_ptr<drc>> motors;
+    for (int i = 0; i < motor_count; i++) {
+      motors.push_back(
+        std::make_unique<drc>(router,
+                              clock,
+                              1.0f,
+                              static_cast<can::id_t>(first_id + i),
+                              std::chrono::milliseconds(1),
+                              drc::startup::attach));
+    }
+    std::atomic<int> replies = 0;
+
+    // Exercise
+    {
+      command_server server(clock);
+      std::vector<std::jthread> threads;
+      for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+          for (int i = 0; i < per_producer; i++) {
+            auto* motor = motors[(p + i) % motor_count].get();
+            std::optional<std::future<command_server::feedback_t>> future;
+            while (not(future = server.submit(
+                         motor, { hal::value(drc::read::status_2) }))) {
+              std::this_thread::yield();
+            }
+            future->get();
+            replies++;
+          }
+        });
+      }
+      threads.clear();
+      expect(that % producers * per_producer == server.completed());
+    }
+
+    // Verify
+    expect(that % producers * per_producer == replies.load());
+    expect(that % producers * per_producer == bus.sent());
+  };
+}
+}  // namespace hal::rmd
@@ -14,15 +14,18 @@
 
 #include <libhal-rmd/drc.hpp>
 
+#include <cmath>
+#include <optional>
 #include <thread>
 
-#include <libhal-mock/can.hpp>
 #include <libhal-mock/steady_clock.hpp>
 #include <libhal-util/can.hpp>
 #include <libhal-util/enum.hpp>
 
 #include <boost/ut.hpp>
 
+#include "fake_can.hpp"
+
 namespace hal::rmd {
 namespace {
 constexpr can::id_t expected_id = 0x140;
@@ -49,51 +52,6 @@ std::queue<std::uint64_t> create_queue()
   }
   return new_queue;
 }
-
-struct rmd_responder : public hal::can
-{
-  /**
-   * @brief Reset spy information for functions
-   *
-   */
-  void reset()
-  {
-    spy_configure.reset();
-    spy_send.reset();
-    spy_bus_on.reset();
-  }
-
-  /// Spy handler for hal::can::configure()
-  spy_handler<settings> spy_configure;
-  /// Spy handler for hal::can::send()
-  spy_handler<message_t> spy_send;
-  /// Spy handler for hal::can::bus_on() will always have content of "true"
-  spy_handler<bool> spy_bus_on;
-  /// Spy handler for hal::can::on_receive()
-  hal::callback<handler> m_on_receive = [](message_t const&) {};
-
-private:
-  void driver_configure(settings const& p_settings) override
-  {
-    return spy_configure.record(p_settings);
-  }
-
-  void driver_bus_on() override
-  {
-    return spy_bus_on.record(true);
-  }
-
-  void driver_send(message_t const& p_message) override
-  {
-    spy_send.record(p_message);
-    m_on_receive(p_message);
-  }
-
-  void driver_on_receive(hal::callback<handler> p_handler) override
-  {
-    m_on_receive = p_handler;
-  }
-};
 }  // namespace
 
 void drc_test()
@@ -103,7 +61,7 @@ void drc_test()
 
   "drc::create()"_test = []() {
     // Setup
-    rmd_responder mock_can;
+    fake_can mock_can;
     mock::steady_clock mock_steady;
     auto queue = create_queue();
     mock_steady.set_uptimes(queue);
@@ -124,7 +82,7 @@ void drc_test()
 
   "drc::create() failure"_test = []() {
     // Setup
-    rmd_responder mock_can;
+    fake_can mock_can;
     mock::steady_clock mock_steady;
     auto queue = create_queue();
     mock_steady.set_uptimes(queue);
@@ -156,16 +114,326 @@ void drc_test()
     expect(that % expected1 == mock_can.spy_send.history<0>(0));
   };
 
+  "drc::create() attach"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+
+    // Exercise
+    drc driver(router,
+               mock_steady,
+               expected_gear_ratio,
+               expected_id,
+               std::chrono::milliseconds(10),
+               drc::startup::attach);
+
+    // Verify
+    expect(that % 0 == mock_can.spy_send.call_history().size());
+  };
+
+  "drc::verify_alive()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc driver0(router,
+                mock_steady,
+                expected_gear_ratio,
+                expected_id,
+                std::chrono::milliseconds(10),
+                drc::startup::attach);
+    drc driver1(router,
+                mock_steady,
+                expected_gear_ratio,
+                expected_id + 1,
+                std::chrono::milliseconds(10),
+                drc::startup::attach);
+    std::array motors{ &driver0, &driver1 };
+    auto expected = prefilled_messages<2>(
+      hal::value(drc::read::status_1_and_error_flags));
+    expected[1].id = expected_id + 1;
+
+    // Exercise
+    drc::verify_alive(motors);
+
+    // Verify
+    expect(that % 2 == mock_can.spy_send.call_history().size());
+    expect(that % expected[0] == mock_can.spy_send.history<0>(0));
+    expect(that % expected[1] == mock_can.spy_send.history<0>(1));
+    expect(that % 1 == driver0.feedback().message_number);
+    expect(that % 1 == driver1.feedback().message_number);
+  };
+
+  "drc::adaptive_timeout()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc driver(router, mock_steady, expected_gear_ratio, expected_id);
+
+    // Exercise
+    auto const disabled = driver.round_trip_time().has_value();
+    driver.adaptive_timeout({ .floor = 100us, .ceiling = 10ms });
+    driver.feedback_request(drc::read::status_2);
+    driver.feedback_request(drc::read::status_2);
+
+    // Verify
+    expect(not disabled);
+    expect(driver.round_trip_time().has_value());
+    expect(that % 2 == driver.round_trip_time()->samples());
+  };
+
+  "drc::estimate_motion()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc driver(router, mock_steady, expected_gear_ratio, expected_id);
+    auto angle = prefilled_messages<1>()[0];
+    angle.payload = { hal::value(drc::read::multi_turns_angle), 0x10, 0x27 };
+    auto speed = prefilled_messages<1>()[0];
+    speed.payload = { hal::value(drc::read::status_2), 0, 0, 0, 0x64 };
+
+    // Exercise
+    auto const disabled = driver.motion().has_value();
+    driver(angle);
+    driver.estimate_motion({ .velocity_gain = 1.0f });
+    driver(angle);
+    driver(speed);
+
+    // Verify
+    expect(not disabled);
+    expect(driver.motion().has_value());
+    expect(that % 2 == driver.motion()->samples());
+    // 0x2710 = 10000 * 0.01 degrees per LSB
+    expect(std::abs(driver.motion()->state().position - 100.0f) < 0.01f);
+    // 0x64 = 100 degrees per second
+    expect(std::abs(driver.motion()->state().velocity - 100.0f) < 0.01f);
+  };
+
+  "drc::track_multi_turn()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc driver(router, mock_steady, expected_gear_ratio, expected_id);
+    auto angle = prefilled_messages<1>()[0];
+    // 36000 * 0.01 = 360 rotor degrees = 60 output shaft degrees
+    angle.payload = { hal::value(drc::read::multi_turns_angle), 0xA0, 0x8C };
+    auto status = prefilled_messages<1>()[0];
+    status.payload = { hal::value(drc::read::status_2), 0, 0, 0, 0, 0, 0, 0 };
+
+    // Exercise
+    driver.track_multi_turn({ .counts_per_turn = 16384 });
+    driver(status);
+    driver(angle);
+    // A quarter rotor turn forward
+    status.payload[6] = 0x00;
+    status.payload[7] = 0x10;
+    driver(status);
+
+    // Verify
+    expect(driver.multi_turn().has_value());
+    expect(driver.multi_turn()->tracking());
+    expect(std::abs(driver.multi_turn()->angle() - 75.0f) < 0.01f);
+  };
+
+  "drc::write_pid() and drc::write_acceleration()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc driver(router, mock_steady, expected_gear_ratio, expected_id);
+    drc::pid_gains const gains{ 1, 2, 3, 4, 5, 6 };
+    auto expected = prefilled_messages<2>();
+    expected[0].payload = {
+      hal::value(drc::write::pid_to_rom), 0, 1, 2, 3, 4, 5, 6,
+    };
+    // 10000 = 0x2710
+    expected[1].payload = {
+      hal::value(drc::write::acceleration_data_to_ram), 0, 0, 0, 0x10, 0x27,
+    };
+    mock_can.spy_send.reset();
+
+    // Exercise
+    auto const unknown = not driver.feedback().pid.has_value();
+    driver.write_pid(gains, true);
+    driver.write_acceleration(10000);
+
+    // Verify
+    expect(unknown);
+    expect(that % expected[0] == mock_can.spy_send.history<0>(0));
+    expect(that % expected[1] == mock_can.spy_send.history<0>(1));
+    expect(gains == driver.feedback().pid);
+    expect(that % 10000 == driver.feedback().raw_acceleration.value());
+  };
+
+  "drc_configuration::commit()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc motor1(router, mock_steady, expected_gear_ratio, 0x141);
+    drc motor2(router, mock_steady, expected_gear_ratio, 0x142);
+    drc motor3(router, mock_steady, expected_gear_ratio, 0x143);
+    drc::pid_gains const gains{ 10, 20, 30, 40, 50, 60 };
+    // motor3 already has the desired gains
+    motor3.write_pid(gains);
+    mock_can.spy_send.reset();
+    drc_configuration configuration(mock_steady);
+
+    // Exercise
+    configuration.pid(motor1, gains, true);
+    configuration.pid(motor2, gains);
+    configuration.pid(motor3, gains, true);
+    configuration.acceleration(motor1, 500);
+    auto const first = configuration.commit();
+    auto const first_frames = mock_can.spy_send.call_history().size();
+    configuration.pid(motor1, gains, true);
+    configuration.pid(motor2, gains);
+    configuration.acceleration(motor1, 500);
+    auto const second = configuration.commit();
+    auto const second_frames =
+      mock_can.spy_send.call_history().size() - first_frames;
+
+    // Verify
+    // motor1 & motor2 pid reads, motor1 acceleration read
+    expect(that % 3 == first.reads);
+    expect(that % 1 == first.rom_writes);
+    // motor2 pid and motor1 acceleration
+    expect(that % 2 == first.ram_writes);
+    expect(that % 1 == first.skipped);
+    expect(that % 6 == first_frames);
+    expect(that % 0 == second.reads);
+    expect(that % 0 == second.rom_writes);
+    expect(that % 0 == second.ram_writes);
+    expect(that % 3 == second.skipped);
+    expect(that % 0 == second_frames);
+    expect(gains == motor1.feedback().pid);
+    expect(that % 500 == motor1.feedback().raw_acceleration.value());
+  };
+
+  "drc_configuration::commit() timeout"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc motor1(router,
+               mock_steady,
+               expected_gear_ratio,
+               0x141,
+               100us,
+               drc::startup::attach);
+    drc_configuration configuration(mock_steady);
+    configuration.pid(motor1, { 1, 1, 1, 1, 1, 1 });
+    mock_can.drop_count = 1;
+
+    // Exercise
+    // Verify
+    expect(throws<hal::timed_out>([&]() { configuration.commit(); }));
+  };
+
+  "drc::emergency_stop_all()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    std::array<std::optional<drc>, 3> drivers;
+    std::array<drc*, 3> motors{};
+    for (std::size_t i = 0; i < motors.size(); i++) {
+      drivers[i].emplace(router,
+                         mock_steady,
+                         expected_gear_ratio,
+                         expected_id + i,
+                         100us,
+                         drc::startup::attach);
+      motors[i] = &drivers[i].value();
+    }
+
+    // Exercise
+    auto const report = drc::emergency_stop_all(motors);
+
+    // Verify
+    expect(that % 3 == report.frames_sent);
+    expect(that % 0 == report.unacknowledged);
+    expect(that % 3 == mock_can.spy_send.call_history().size());
+    for (std::size_t i = 0; i < motors.size(); i++) {
+      auto const sent = mock_can.spy_send.history<0>(i);
+      expect(that % (expected_id + i) == sent.id);
+      expect(that % hal::value(drc::system::stop) == sent.payload[0]);
+    }
+  };
+
+  "drc::emergency_stop_all() retries unacknowledged"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    std::array<std::optional<drc>, 3> drivers;
+    std::array<drc*, 3> motors{};
+    for (std::size_t i = 0; i < motors.size(); i++) {
+      drivers[i].emplace(router,
+                         mock_steady,
+                         expected_gear_ratio,
+                         expected_id + i,
+                         100us,
+                         drc::startup::attach);
+      motors[i] = &drivers[i].value();
+    }
+    // Drop the stop sent to the first motor
+    mock_can.drop_count = 1;
+
+    // Exercise
+    auto const report = drc::emergency_stop_all(motors);
+
+    // Verify
+    expect(that % 4 == report.frames_sent);
+    expect(that % 0 == report.unacknowledged);
+    expect(that % 4 == mock_can.spy_send.call_history().size());
+    expect(that % expected_id == mock_can.spy_send.history<0>(3).id);
+  };
+
   "drc::velocity_control()"_test = []() {
     // Setup
-    rmd_responder mock_can;
+    fake_can mock_can;
     mock::steady_clock mock_steady;
     auto queue = create_queue();
     mock_steady.set_uptimes(queue);
     mock_steady.set_frequency(1.0_MHz);
     hal::can_router router(mock_can);
     drc driver(router, mock_steady, expected_gear_ratio, expected_id);
-    mock_can.reset();
+    mock_can.spy_send.reset();
     auto expected = prefilled_messages<7>(hal::value(drc::actuate::speed));
     std::array injected_rpm{
       0.0_rpm, 10.0_rpm, 10.0_rpm, 123.0_rpm, 0.0_rpm, 1024.0_rpm,
@@ -210,14 +478,14 @@ void drc_test()
 
   "drc::position_control()"_test = []() {
     // Setup
-    rmd_responder mock_can;
+    fake_can mock_can;
     mock::steady_clock mock_steady;
     auto queue = create_queue();
     mock_steady.set_uptimes(queue);
     mock_steady.set_frequency(1.0_MHz);
     hal::can_router router(mock_can);
     drc driver(router, mock_steady, expected_gear_ratio, expected_id);
-    mock_can.reset();
+    mock_can.spy_send.reset();
     auto expected = prefilled_messages<6>(hal::value(drc::actuate::position_2));
     using payload_t = decltype(expected[0].payload);
 
@@ -258,16 +526,47 @@ void drc_test()
     expect(that % expected[5] == mock_can.spy_send.history<0>(5));
   };
 
+  "drc::incremental_position_control()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc driver(router, mock_steady, expected_gear_ratio, expected_id);
+    auto servo = make_servo(driver, 10.0_rpm);
+    mock_can.spy_send.reset();
+    auto expected = prefilled_messages<2>();
+    using payload_t = decltype(expected[0].payload);
+
+    // Same encoding as position_control()
+    expected[0].payload = payload_t{
+      0xa8, 0x0, 0x68, 0x1, 0x78, 0x69, 0x0, 0x0,
+    };
+    expected[1].payload = payload_t{
+      0xa8, 0x0, 0x68, 0x1, 0xd8, 0xdc, 0xff, 0xff,
+    };
+
+    // Exercise
+    driver.incremental_position_control(45.0_deg, 10.0_rpm);
+    servo.move_by(-15.0_deg);
+
+    // Verify
+    expect(that % expected[0] == mock_can.spy_send.history<0>(0));
+    expect(that % expected[1] == mock_can.spy_send.history<0>(1));
+  };
+
   "drc::feedback_request()"_test = []() {
     // Setup
-    rmd_responder mock_can;
+    fake_can mock_can;
     mock::steady_clock mock_steady;
     auto queue = create_queue();
     mock_steady.set_uptimes(queue);
     mock_steady.set_frequency(1.0_MHz);
     hal::can_router router(mock_can);
     drc driver(router, mock_steady, expected_gear_ratio, expected_id);
-    mock_can.reset();
+    mock_can.spy_send.reset();
 
     auto expected = prefilled_messages<3>();
 
@@ -289,14 +588,14 @@ void drc_test()
 
   "drc::system_control()"_test = []() {
     // Setup
-    rmd_responder mock_can;
+    fake_can mock_can;
     mock::steady_clock mock_steady;
     auto queue = create_queue();
     mock_steady.set_uptimes(queue);
     mock_steady.set_frequency(1.0_MHz);
     hal::can_router router(mock_can);
     drc driver(router, mock_steady, expected_gear_ratio, expected_id);
-    mock_can.reset();
+    mock_can.spy_send.reset();
 
     auto expected = prefilled_messages<4>();
 
@@ -321,7 +620,7 @@ void drc_test()
 
   "drc::operator() update feedback status_2 "_test = []() {
     // Setup
-    rmd_responder mock_can;
+    fake_can mock_can;
     mock::steady_clock mock_steady;
     auto queue = create_queue();
     mock_steady.set_uptimes(queue);
@@ -349,11 +648,131 @@ void drc_test()
     expect(that % 0x7766 == driver.feedback().encoder);
   };
 
+  "drc::take_updated() reports refreshed field groups"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc driver(router,
+               mock_steady,
+               expected_gear_ratio,
+               expected_id,
+               10ms,
+               drc::startup::attach);
+    auto const motion = hal::value(drc::field_group::motion);
+    auto const temperature = hal::value(drc::field_group::temperature);
+    auto const status = hal::value(drc::field_group::status);
+    auto const angle = hal::value(drc::field_group::angle);
+
+    // Exercise
+    driver.feedback_request(drc::read::status_2);
+    auto const after_status_2 = driver.take_updated();
+    auto const after_take = driver.take_updated();
+    driver.feedback_request(drc::read::status_1_and_error_flags);
+    driver.feedback_request(drc::read::multi_turns_angle);
+    auto const after_rest = driver.take_updated();
+
+    // Verify
+    expect(that % (motion | temperature) == after_status_2);
+    expect(that % 0 == after_take);
+    expect(that % (status | temperature | angle) == after_rest);
+    expect(that % drc::all_field_groups == driver.feedback().received);
+    expect(that % 0 == driver.feedback().updated);
+    expect(driver.feedback().updated_at[0] < driver.feedback().updated_at[3]);
+  };
+
+  "drc::request_stale() only requests stale field groups"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc driver(router,
+               mock_steady,
+               expected_gear_ratio,
+               expected_id,
+               10ms,
+               drc::startup::attach);
+    auto const temperature = hal::value(drc::field_group::temperature);
+    auto const angle = hal::value(drc::field_group::angle);
+    mock_can.spy_send.reset();
+
+    // Exercise
+    auto const initial = driver.request_stale(1ms);
+    auto const initial_frames = mock_can.spy_send.call_history().size();
+    auto const fresh = driver.request_stale(1ms);
+    auto const fresh_frames = mock_can.spy_send.call_history().size();
+    std::queue<std::uint64_t> later;
+    later.push(5'000);
+    mock_steady.set_uptimes(later);
+    auto const angle_only = driver.request_stale(1ms, angle);
+    auto const temperature_only = driver.request_stale(1ms, temperature);
+
+    // Verify
+    expect(that % drc::all_field_groups == initial);
+    expect(that % 3 == initial_frames);
+    expect(that % 0 == fresh);
+    expect(that % 3 == fresh_frames);
+    expect(that % angle == angle_only);
+    expect(that % temperature == temperature_only);
+    expect(that % 5 == mock_can.spy_send.call_history().size());
+    auto const& angle_request = mock_can.spy_send.history<0>(3);
+    auto const& temperature_request = mock_can.spy_send.history<0>(4);
+    expect(that % hal::value(drc::read::multi_turns_angle) ==
+           angle_request.payload[0]);
+    expect(that % hal::value(drc::read::status_2) ==
+           temperature_request.payload[0]);
+  };
+
+  "drc::request_stale() across a fleet"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    std::array<std::optional<drc>, 2> drivers;
+    std::array<drc*, 2> motors{};
+    for (std::size_t i = 0; i < motors.size(); i++) {
+      drivers[i].emplace(router,
+                         mock_steady,
+                         expected_gear_ratio,
+                         0x141 + i,
+                         100us,
+                         drc::startup::attach);
+      motors[i] = &drivers[i].value();
+    }
+    auto const angle = hal::value(drc::field_group::angle);
+    mock_can.spy_send.reset();
+
+    // Exercise
+    drc::request_stale(motors, 1ms, angle);
+    auto const first_frames = mock_can.spy_send.call_history().size();
+    drc::request_stale(motors, 1ms, angle);
+    auto const second_frames = mock_can.spy_send.call_history().size();
+    mock_can.drop_count = 1;
+    auto const unresponsive = throws<hal::timed_out>(
+      [&motors]() { drc::request_stale(motors, 0us, angle); });
+
+    // Verify
+    expect(that % 2 == first_frames);
+    expect(that % 2 == second_frames);
+    expect(unresponsive);
+    expect(that % 0x141 == mock_can.spy_send.history<0>(0).id);
+    expect(that % 0x142 == mock_can.spy_send.history<0>(1).id);
+  };
+
   "drc::feedback().current() "_test = []() {};
 
   "hal::make_<interface>()"_test = []() {
     // Setup
-    rmd_responder mock_can;
+    fake_can mock_can;
     mock::steady_clock mock_steady;
     auto queue = create_queue();
     mock_steady.set_uptimes(queue);
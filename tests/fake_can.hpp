@@ -0,0 +1,127 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include <libhal-mock/testing.hpp>
+#include <libhal/can.hpp>
+
+namespace hal::rmd {
+/**
+ * @brief Configurable fake can bus shared by the unit tests
+ *
+ * Records every sent frame and, by default, answers each one the way a motor
+ * would by echoing it back to the receive handler. MC-X motors reply on their
+ * device ID + 0x100, so frames sent to the IDs in `mc_x_ids` are answered on
+ * that ID instead, and MC-X broadcasts are answered by each of them.
+ */
+struct fake_can : public hal::can
+{
+  /// Offset between the device ID of an MC-X motor and its replies
+  static constexpr can::id_t mc_x_response_offset = 0x100;
+  /// ID of MC-X commands addressed to every MC-X motor on the bus
+  static constexpr can::id_t mc_x_broadcast_id = 0x280;
+
+  /**
+   * @brief Deliver a frame to the receive handler as if it came from the bus
+   *
+   * @param p_message - frame to deliver
+   */
+  void receive(message_t const& p_message)
+  {
+    m_on_receive(p_message);
+  }
+
+  /**
+   * @return std::size_t - number of frames sent so far
+   */
+  std::size_t sent() const
+  {
+    return spy_send.call_history().size();
+  }
+
+  /// Spy handler for hal::can::send()
+  spy_handler<message_t> spy_send;
+  /// Answer each sent frame, disable to inject replies manually
+  bool echo = true;
+  /// Device IDs of MC-X motors, answered on ID + mc_x_response_offset
+  std::vector<can::id_t> mc_x_ids;
+  /// Device IDs that never answer
+  std::vector<can::id_t> silent_ids;
+  /// Payload of the answers instead of the payload of the sent frame
+  std::optional<std::array<hal::byte, 8>> response{};
+  /// Number of upcoming frames that will not be answered
+  std::size_t drop_count = 0;
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  void driver_bus_on() override
+  {
+  }
+
+  void answer(can::id_t p_device_id, message_t p_message)
+  {
+    if (std::ranges::count(silent_ids, p_device_id) != 0) {
+      return;
+    }
+
+    if (drop_count > 0) {
+      drop_count--;
+      return;
+    }
+
+    p_message.id = p_device_id;
+    if (std::ranges::count(mc_x_ids, p_device_id) != 0) {
+      p_message.id += mc_x_response_offset;
+    }
+    if (response) {
+      p_message.payload = *response;
+    }
+    m_on_receive(p_message);
+  }
+
+  void driver_send(message_t const& p_message) override
+  {
+    spy_send.record(p_message);
+
+    if (not echo) {
+      return;
+    }
+
+    if (p_message.id == mc_x_broadcast_id) {
+      for (auto const id : mc_x_ids) {
+        answer(id, p_message);
+      }
+    } else {
+      answer(p_message.id, p_message);
+    }
+  }
+
+  void driver_on_receive(hal::callback<handler> p_handler) override
+  {
+    m_on_receive = p_handler;
+  }
+
+  hal::callback<handler> m_on_receive = [](message_t const&) {};
+};
+}  // namespace hal::rmd
@@ -0,0 +1,206 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/fault_injector.hpp>
+
+#include <queue>
+#include <vector>
+
+#include <libhal-mock/steady_clock.hpp>
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+#include "fake_can.hpp"
+
+namespace hal::rmd {
+namespace {
+hal::can::message_t frame(hal::can::id_t p_id)
+{
+  return { .id = p_id, .payload = { 0x9C }, .length = 8 };
+}
+}  // namespace
+
+void fault_injector_test()
+{
+  using namespace boost::ut;
+  using namespace std::literals;
+  using namespace hal::literals;
+
+  "fault_injector passes frames through without faults"_test = []() {
+    // Setup
+    fake_can bus;
+    bus.echo = false;
+    hal::mock::steady_clock clock;
+    fault_injector injector(bus, clock, {});
+    std::vector<hal::can::message_t> received;
+    injector.on_receive(
+      [&received](hal::can::message_t const& p_message) {
+        received.push_back(p_message);
+      });
+
+    // Exercise
+    injector.send(frame(0x141));
+    bus.receive(frame(0x241));
+
+    // Verify
+    expect(that % 1 == bus.sent());
+    expect(frame(0x141) == bus.spy_send.history<0>(0));
+    expect(that % 1 == received.size());
+    expect(frame(0x241) == received[0]);
+    expect(that % 2 == injector.stats().passed);
+  };
+
+  "fault_injector drops every frame with a loss rate of 1"_test = []() {
+    // Setup
+    fake_can bus;
+    bus.echo = false;
+    hal::mock::steady_clock clock;
+    fault_injector injector(bus, clock, { .loss = 1.0f });
+    std::size_t received = 0;
+    injector.on_receive([&received](hal::can::message_t const&) {
+      received++;
+    });
+
+    // Exercise
+    injector.send(frame(0x141));
+    bus.receive(frame(0x141));
+
+    // Verify
+    expect(that % 0 == bus.sent());
+    expect(that % 0 == received);
+    expect(that % 2 == injector.stats().dropped);
+  };
+
+  "fault_injector duplicates frames"_test = []() {
+    // Setup
+    fake_can bus;
+    bus.echo = false;
+    hal::mock::steady_clock clock;
+    fault_injector injector(bus, clock, { .duplicate = 1.0f });
+
+    // Exercise
+    injector.send(frame(0x141));
+
+    // Verify
+    expect(that % 2 == bus.sent());
+    expect(bus.spy_send.history<0>(0) == bus.spy_send.history<0>(1));
+    expect(that % 1 == injector.stats().duplicated);
+  };
+
+  "fault_injector corrupts the ID or length"_test = []() {
+    // Setup
+    fake_can bus;
+    bus.echo = false;
+    hal::mock::steady_clock clock;
+    fault_injector injector(bus, clock, { .corrupt = 1.0f });
+
+    // Exercise
+    for (int i = 0; i < 20; i++) {
+      injector.send(frame(0x141));
+    }
+
+    // Verify
+    expect(that % 20 == bus.sent());
+    expect(that % 20 == injector.stats().corrupted);
+    for (auto const& [message] : bus.spy_send.call_history()) {
+      expect(message.id != 0x141 || message.length != 8);
+    }
+  };
+
+  "fault_injector releases delayed frames when the clock is read"_test =
+    []() {
+      // Setup
+      fake_can bus;
+      bus.echo = false;
+      hal::mock::steady_clock clock;
+      clock.set_frequency(1.0_MHz);
+      std::queue<std::uint64_t> uptimes;
+      for (std::uint64_t tick : { 0, 500, 999, 1000 }) {
+        uptimes.push(tick);
+      }
+      clock.set_uptimes(uptimes);
+      fault_injector injector(
+        bus, clock, { .delay = 1.0f, .delay_time = 1ms, .incoming = false });
+
+      // Exercise
+      injector.send(frame(0x141));
+      auto const sent_at_send = bus.sent();
+      injector.uptime();
+      injector.uptime();
+      auto const sent_before_due = bus.sent();
+      injector.uptime();
+
+      // Verify
+      expect(that % 0 == sent_at_send);
+      expect(that % 0 == sent_before_due);
+      expect(that % 1 == bus.sent());
+      expect(that % 1 == injector.stats().delayed);
+    };
+
+  "fault_injector only faults the selected direction"_test = []() {
+    // Setup
+    fake_can bus;
+    bus.echo = false;
+    hal::mock::steady_clock clock;
+    fault_injector injector(bus, clock, { .loss = 1.0f, .incoming = false });
+    std::size_t received = 0;
+    injector.on_receive([&received](hal::can::message_t const&) {
+      received++;
+    });
+
+    // Exercise
+    injector.send(frame(0x141));
+    bus.receive(frame(0x141));
+
+    // Verify
+    expect(that % 0 == bus.sent());
+    expect(that % 1 == received);
+  };
+
+  "fault_injector is reproducible for a seed"_test = []() {
+    // Setup
+    fake_can first_bus;
+    first_bus.echo = false;
+    fake_can second_bus;
+    second_bus.echo = false;
+    hal::mock::steady_clock clock;
+    fault_injector::settings const profile = { .loss = 0.3f, .seed = 42 };
+    fault_injector first(first_bus, clock, profile);
+    fault_injector second(second_bus, clock, profile);
+
+    // Exercise
+    for (int i = 0; i < 1000; i++) {
+      first.send(frame(0x141));
+      second.send(frame(0x141));
+    }
+
+    // Verify
+    expect(that % first.stats().dropped == second.stats().dropped);
+    expect(250 < first.stats().dropped && first.stats().dropped < 350);
+    expect(that % 1000 == first.stats().dropped + first.stats().passed);
+  };
+
+  "fault_injector rejects rates outside of [0, 1]"_test = []() {
+    fake_can bus;
+    bus.echo = false;
+    hal::mock::steady_clock clock;
+
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { fault_injector injector(bus, clock, { .loss = 1.5f }); }));
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { fault_injector injector(bus, clock, { .delay = -0.1f }); }));
+  };
+}
+}  // namespace hal::rmd
@@ -0,0 +1,223 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/health_monitor.hpp>
+
+#include <vector>
+
+#include <libhal-mock/steady_clock.hpp>
+#include <libhal-util/enum.hpp>
+
+#include <boost/ut.hpp>
+
+#include "fake_can.hpp"
+
+namespace hal::rmd {
+namespace {
+std::queue<std::uint64_t> create_queue()
+{
+  std::queue<std::uint64_t> new_queue;
+  for (std::uint64_t i = 0; i < 10'000; i++) {
+    new_queue.push(i);
+  }
+  return new_queue;
+}
+
+/// DRC status 1 response with the given temperature, voltage and error flags
+can::message_t status_1(can::id_t p_id,
+                        hal::byte p_celsius,
+                        std::uint16_t p_decivolts,
+                        hal::byte p_flags)
+{
+  return {
+    .id = p_id,
+    .payload = { hal::value(drc::read::status_1_and_error_flags),
+                 p_celsius,
+                 0,
+                 static_cast<hal::byte>(p_decivolts & 0xFF),
+                 static_cast<hal::byte>(p_decivolts >> 8),
+                 0,
+                 0,
+                 p_flags },
+    .length = 8,
+  };
+}
+}  // namespace
+
+void health_monitor_test()
+{
+  using namespace boost::ut;
+  using namespace std::literals;
+  using namespace hal::literals;
+
+  "health_monitor samples motors round robin when idle"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.echo = false;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    // One second per tick keeps the trends easy to reason about
+    mock_steady.set_frequency(1.0_Hz);
+    hal::can_router router(mock_can);
+    drc motor1(router, mock_steady, 6.0f, 0x141, 10ms, drc::startup::attach);
+    drc motor2(router, mock_steady, 6.0f, 0x142, 10ms, drc::startup::attach);
+    scheduler bus_scheduler(mock_steady);
+    health_monitor monitor(bus_scheduler, mock_steady, { .interval = 0s });
+    struct edge_t
+    {
+      drc* motor;
+      std::uint16_t raised;
+      std::uint16_t cleared;
+    };
+    std::vector<edge_t> edges;
+    monitor.on_flag_change([&edges](health_monitor::motor_t p_motor,
+                                    std::uint16_t p_raised,
+                                    std::uint16_t p_cleared) {
+      edges.push_back({ std::get<drc*>(p_motor), p_raised, p_cleared });
+    });
+    monitor.add(&motor1);
+    monitor.add(&motor2);
+
+    auto cycle = [&](drc& p_motor, can::message_t const& p_response) {
+      monitor.service();
+      bus_scheduler.service();
+      p_motor(p_response);
+      bus_scheduler.service();
+    };
+
+    // Exercise
+    cycle(motor1, status_1(0x141, 30, 240, 0x00));
+    cycle(motor2, status_1(0x142, 40, 480, 0x04));
+    cycle(motor1, status_1(0x141, 31, 250, 0x01));
+    cycle(motor2, status_1(0x142, 40, 480, 0x00));
+    monitor.service();
+
+    // Verify
+    expect(that % 4 == mock_can.spy_send.call_history().size());
+    // The next request is queued but not yet transmitted
+    expect(that % 1 == bus_scheduler.pending(scheduler::priority::telemetry));
+    expect(that % 0x141 == mock_can.spy_send.history<0>(0).id);
+    expect(that % 0x142 == mock_can.spy_send.history<0>(1).id);
+    expect(that % 0x141 == mock_can.spy_send.history<0>(2).id);
+    expect(that % hal::value(drc::read::status_1_and_error_flags) ==
+           mock_can.spy_send.history<0>(0).payload[0]);
+
+    expect(that % 3 == edges.size());
+    expect(&motor2 == edges[0].motor);
+    expect(that % 0x04 == edges[0].raised);
+    expect(&motor1 == edges[1].motor);
+    expect(that % 0x01 == edges[1].raised);
+    expect(&motor2 == edges[2].motor);
+    expect(that % 0x04 == edges[2].cleared);
+
+    auto const& health1 = monitor.health(0);
+    expect(that % 2 == health1.samples);
+    expect(that % 0 == health1.missed);
+    expect(that % 0x01 == health1.error_flags);
+    expect(health1.volts_trend > 0.0f);
+    expect(health1.temperature_trend > 0.0f);
+    expect(that % 0.0f == monitor.health(1).volts_trend);
+  };
+
+  "health_monitor waits for the scheduler to be idle"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.echo = false;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc motor(router, mock_steady, 6.0f, 0x141, 10ms, drc::startup::attach);
+    scheduler bus_scheduler(mock_steady);
+    health_monitor monitor(bus_scheduler, mock_steady, { .interval = 0s });
+    monitor.add(&motor);
+    bus_scheduler.submit(&motor, { hal::value(drc::actuate::speed) });
+
+    // Exercise
+    monitor.service();
+    auto const pending = bus_scheduler.pending(scheduler::priority::telemetry);
+    bus_scheduler.service();
+    motor(mock_can.spy_send.history<0>(0));
+    bus_scheduler.service();
+    monitor.service();
+
+    // Verify
+    expect(that % 0 == pending);
+    expect(that % 1 == bus_scheduler.pending(scheduler::priority::telemetry));
+  };
+
+  "health_monitor counts missed responses"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.echo = false;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc motor(router, mock_steady, 6.0f, 0x141, 10ms, drc::startup::attach);
+    scheduler bus_scheduler(mock_steady, 100us);
+    health_monitor monitor(bus_scheduler, mock_steady, { .interval = 1s });
+    monitor.add(&motor);
+
+    // Exercise
+    monitor.service();
+    bus_scheduler.flush();
+    monitor.service();
+
+    // Verify
+    expect(that % 1 == bus_scheduler.stats().timeouts);
+    expect(that % 1 == monitor.health(0).missed);
+    expect(that % 0 == monitor.health(0).samples);
+    // The interval has not elapsed, so no new request was made
+    expect(bus_scheduler.idle());
+  };
+
+  "health_monitor ignores responses to other commands"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.echo = false;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc motor(router, mock_steady, 6.0f, 0x141, 10ms, drc::startup::attach);
+    scheduler bus_scheduler(mock_steady, 100us);
+    health_monitor monitor(bus_scheduler, mock_steady, { .interval = 1s });
+    monitor.add(&motor);
+    motor(status_1(0x141, 30, 240, 0x00));
+
+    // Exercise
+    monitor.service();
+    bus_scheduler.service();
+    bus_scheduler.submit(&motor, { hal::value(drc::actuate::speed) });
+    // The status request is dropped and times out, then the setpoint is sent
+    while (bus_scheduler.stats().sent < 2) {
+      bus_scheduler.service();
+    }
+    motor(mock_can.spy_send.history<0>(1));
+    bus_scheduler.service();
+    monitor.service();
+
+    // Verify
+    expect(that % 1 == bus_scheduler.stats().timeouts);
+    expect(that % 1 == bus_scheduler.stats().completed);
+    expect(that % 1 == monitor.health(0).missed);
+    expect(that % 0 == monitor.health(0).samples);
+  };
+}
+}  // namespace hal::rmd
@@ -16,6 +16,25 @@ namespace hal::rmd {
 extern void drc_test();
 extern void drc_adaptors_test();
 extern void mc_x_test();
+extern void rtt_estimator_test();
+extern void scheduler_test();
+extern void can_trace_test();
+extern void chrome_trace_test();
+extern void motion_estimator_test();
+extern void multi_turn_tracker_test();
+extern void health_monitor_test();
+extern void stall_detector_test();
+extern void bus_planner_test();
+extern void fault_injector_test();
+extern void telemetry_log_test();
+extern void motor_test();
+extern void any_motor_test();
+extern void motor_bank_test();
+extern void simulated_bus_test();
+#if defined(__linux__)
+extern void command_server_test();
+extern void shared_telemetry_test();
+#endif
 }  // namespace hal::rmd
 
 int main()
@@ -23,4 +42,23 @@ int main()
   hal::rmd::drc_test();
   hal::rmd::drc_adaptors_test();
   hal::rmd::mc_x_test();
+  hal::rmd::rtt_estimator_test();
+  hal::rmd::scheduler_test();
+  hal::rmd::can_trace_test();
+  hal::rmd::chrome_trace_test();
+  hal::rmd::motion_estimator_test();
+  hal::rmd::multi_turn_tracker_test();
+  hal::rmd::health_monitor_test();
+  hal::rmd::stall_detector_test();
+  hal::rmd::bus_planner_test();
+  hal::rmd::fault_injector_test();
+  hal::rmd::telemetry_log_test();
+  hal::rmd::motor_test();
+  hal::rmd::any_motor_test();
+  hal::rmd::motor_bank_test();
+  hal::rmd::simulated_bus_test();
+#if defined(__linux__)
+  hal::rmd::command_server_test();
+  hal::rmd::shared_telemetry_test();
+#endif
 }
@@ -14,13 +14,33 @@
 
 #include <libhal-rmd/mc_x.hpp>
 
+#include <cmath>
+#include <optional>
+
 #include <libhal-mock/can.hpp>
 #include <libhal-mock/steady_clock.hpp>
 #include <libhal-util/enum.hpp>
 
 #include <boost/ut.hpp>
 
+#include "fake_can.hpp"
+
 namespace hal::rmd {
+namespace {
+constexpr can::id_t expected_id = 0x141;
+constexpr can::id_t response_offset = 0x100;
+constexpr can::id_t broadcast_id = 0x280;
+
+std::queue<std::uint64_t> create_queue()
+{
+  std::queue<std::uint64_t> new_queue;
+  for (std::uint64_t i = 0; i < 255; i++) {
+    new_queue.push(i);
+  }
+  return new_queue;
+}
+}  // namespace
+
 void mc_x_test()
 {
   using namespace boost::ut;
@@ -28,5 +48,450 @@ void mc_x_test()
   using namespace hal::literals;
 
   "create()"_test = []() {};
+
+  "mc_x::velocity_control() with current limit"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.mc_x_ids = { expected_id };
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    mc_x driver(router, mock_steady, 36.0f, expected_id);
+    mock_can.spy_send.reset();
+
+    // Exercise
+    auto const unrated = throws<hal::argument_out_of_domain>(
+      [&driver]() { driver.velocity_control(10.0_rpm, 2.0_A); });
+    driver.rated_current(8.0_A);
+    driver.velocity_control(10.0_rpm, 2.0_A);
+    driver.velocity_control(10.0_rpm, 100.0_A);
+    driver.velocity_control(10.0_rpm, 0.01_A);
+    auto const negative = throws<hal::argument_out_of_domain>(
+      [&driver]() { driver.velocity_control(10.0_rpm, -1.0_A); });
+
+    // Verify
+    expect(unrated);
+    expect(negative);
+    expect(that % 3 == mock_can.spy_send.call_history().size());
+    auto const& limited = mock_can.spy_send.history<0>(0);
+    expect(that % hal::value(mc_x::actuate::speed) == limited.payload[0]);
+    // 2A of 8A rated current = 25%
+    expect(that % 25 == limited.payload[1]);
+    // 10 rpm = 60 dps = 6000 (0x1770) at 0.01 dps/LSB
+    expect(that % 0x70 == limited.payload[4]);
+    expect(that % 0x17 == limited.payload[5]);
+    expect(that % 255 == mock_can.spy_send.history<0>(1).payload[1]);
+    expect(that % 1 == mock_can.spy_send.history<0>(2).payload[1]);
+  };
+
+  "make_motor() with current limit"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.mc_x_ids = { expected_id };
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    mc_x driver(router, mock_steady, 36.0f, expected_id);
+    driver.rated_current(10.0_A);
+    auto limited = make_motor(driver, 100.0_rpm, 5.0_A);
+    auto unlimited = make_motor(driver, 100.0_rpm);
+    mock_can.spy_send.reset();
+
+    // Exercise
+    limited.power(0.5f);
+    unlimited.power(0.5f);
+
+    // Verify
+    expect(that % 50 == mock_can.spy_send.history<0>(0).payload[1]);
+    expect(that % 0 == mock_can.spy_send.history<0>(1).payload[1]);
+  };
+
+  "mc_x::incremental_position_control()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.mc_x_ids = { expected_id };
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    mc_x driver(router, mock_steady, 36.0f, expected_id);
+    auto servo = make_servo(driver, 1.0_rpm);
+    mock_can.spy_send.reset();
+
+    // Exercise
+    driver.incremental_position_control(90.0_deg, 1.0_rpm);
+    servo.move_by(-90.0_deg);
+
+    // Verify
+    auto const& forward = mock_can.spy_send.history<0>(0);
+    auto const& backward = mock_can.spy_send.history<0>(1);
+    expect(that % hal::value(mc_x::actuate::incremental_position) ==
+           forward.payload[0]);
+    // 1 rpm * 36 gear ratio = 216 dps
+    expect(that % 216 == forward.payload[2]);
+    expect(that % 0 == forward.payload[3]);
+    // 90 degrees = 9000 (0x2328) at 0.01 degrees/LSB
+    expect(that % 0x28 == forward.payload[4]);
+    expect(that % 0x23 == forward.payload[5]);
+    expect(that % 0xD8 == backward.payload[4]);
+    expect(that % 0xDC == backward.payload[5]);
+    expect(that % 0xFF == backward.payload[7]);
+  };
+
+  "mc_x::adaptive_timeout()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.mc_x_ids = { expected_id };
+    mock::steady_clock mock_steady;
+    // Each reading of the clock advances it by 1ms
+    std::queue<std::uint64_t> queue;
+    for (std::uint64_t i = 0; i < 255; i++) {
+      queue.push(i * 1'000);
+    }
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    mc_x driver(router, mock_steady, 36.0f, expected_id);
+
+    // Exercise
+    auto const disabled = driver.round_trip_time().has_value();
+    driver.adaptive_timeout({ .floor = 100us, .ceiling = 100ms });
+    auto const before_samples = driver.round_trip_time()->timeout();
+    driver.feedback_request(mc_x::read::status_2);
+    driver.feedback_request(mc_x::read::status_2);
+    auto const learned = driver.round_trip_time()->timeout();
+    mock_can.drop_count = 1;
+    auto const timed_out = throws<hal::timed_out>(
+      [&driver]() { driver.feedback_request(mc_x::read::status_2); });
+    auto const backed_off = driver.round_trip_time()->timeout();
+
+    // Verify
+    expect(not disabled);
+    expect(that % 2 == driver.round_trip_time()->samples());
+    // The ceiling is used until a round trip time has been recorded
+    expect(100ms == before_samples);
+    // Grows from the floor to cover the mean plus four deviations
+    expect(learned > driver.round_trip_time()->mean() && learned < 100ms);
+    expect(learned > 2ms);
+    expect(timed_out);
+    // Each timeout doubles the learned timeout
+    expect(backed_off > learned);
+  };
+
+  "mc_x::adaptive_timeout() is bounded by the floor"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.mc_x_ids = { expected_id };
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    mc_x driver(router, mock_steady, 36.0f, expected_id);
+
+    // Exercise
+    driver.adaptive_timeout({ .floor = 100us, .ceiling = 10ms });
+    driver.feedback_request(mc_x::read::status_2);
+    driver.feedback_request(mc_x::read::status_2);
+
+    // Verify
+    // Round trips of a few microseconds are raised to the floor
+    expect(driver.round_trip_time()->mean() < 100us);
+    expect(100us == driver.round_trip_time()->timeout());
+  };
+
+  "mc_x::detect_stall()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.mc_x_ids = { expected_id };
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_kHz);
+    hal::can_router router(mock_can);
+    mc_x driver(router, mock_steady, 36.0f, expected_id);
+    int stall_count = 0;
+    driver.detect_stall({ .current_threshold = 2.0_A,
+                          .window = 10ms,
+                          .stop_on_stall = true },
+                        [&stall_count]() { stall_count++; });
+    // Stationary with 5A (50 * 0.1A/LSB) of current
+    can::message_t stalled{ .id = expected_id + response_offset,
+                            .payload = { hal::value(mc_x::read::status_2),
+                                         25,
+                                         50,
+                                         0 },
+                            .length = 8 };
+
+    // Exercise
+    // The responder echoes commands, the speed reply reports no current
+    driver.velocity_control(10.0_rpm);
+    mock_can.spy_send.reset();
+    for (int i = 0; i < 20; i++) {
+      driver(stalled);
+    }
+    auto const sent_from_handler = mock_can.spy_send.call_history().size();
+    auto const stop_sent = driver.send_pending_stop();
+    auto const stop_sent_again = driver.send_pending_stop();
+
+    // Verify
+    expect(that % 1 == stall_count);
+    // The stall disarms the detector, so later replies do not stall again
+    expect(that % 1 == driver.stall()->stalls());
+    expect(not driver.stall()->stalled());
+    // The receive handler only requests the stop
+    expect(that % 0 == sent_from_handler);
+    expect(stop_sent);
+    expect(not stop_sent_again);
+    expect(that % 1 == mock_can.spy_send.call_history().size());
+    expect(that % hal::value(mc_x::system::stop) ==
+           mock_can.spy_send.history<0>(0).payload[0]);
+  };
+
+  "mc_x::detect_stall() stop precedes the next command"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.mc_x_ids = { expected_id };
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_kHz);
+    hal::can_router router(mock_can);
+    mc_x driver(router, mock_steady, 36.0f, expected_id);
+    driver.detect_stall({ .current_threshold = 2.0_A,
+                          .window = 10ms,
+                          .stop_on_stall = true },
+                        []() {});
+    can::message_t stalled{ .id = expected_id + response_offset,
+                            .payload = { hal::value(mc_x::read::status_2),
+                                         25,
+                                         50,
+                                         0 },
+                            .length = 8 };
+    driver.velocity_control(10.0_rpm);
+    for (int i = 0; i < 20; i++) {
+      driver(stalled);
+    }
+    mock_can.spy_send.reset();
+
+    // Exercise
+    driver.feedback_request(mc_x::read::status_2);
+
+    // Verify
+    expect(that % 2 == mock_can.spy_send.call_history().size());
+    expect(that % hal::value(mc_x::system::stop) ==
+           mock_can.spy_send.history<0>(0).payload[0]);
+    expect(that % hal::value(mc_x::read::status_2) ==
+           mock_can.spy_send.history<0>(1).payload[0]);
+    expect(not driver.send_pending_stop());
+  };
+
+  "mc_x::emergency_stop_all()"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    std::array<std::optional<mc_x>, 3> drivers;
+    std::array<mc_x*, 3> motors{};
+    for (std::size_t i = 0; i < motors.size(); i++) {
+      drivers[i].emplace(router, mock_steady, 36.0f, expected_id + i, 100us);
+      motors[i] = &drivers[i].value();
+      mock_can.mc_x_ids.push_back(expected_id + i);
+    }
+
+    // Exercise
+    auto const report = mc_x::emergency_stop_all(motors);
+
+    // Verify
+    expect(that % 1 == report.frames_sent);
+    expect(that % 0 == report.unacknowledged);
+    expect(that % 1 == mock_can.spy_send.call_history().size());
+    expect(that % broadcast_id == mock_can.spy_send.history<0>(0).id);
+    expect(that % hal::value(mc_x::system::stop) ==
+           mock_can.spy_send.history<0>(0).payload[0]);
+    for (auto const* motor : motors) {
+      expect(that % 1 == motor->feedback().message_number);
+    }
+  };
+
+  "mc_x::emergency_stop_all() disarms stall detection"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_kHz);
+    hal::can_router router(mock_can);
+    mc_x driver(router, mock_steady, 36.0f, expected_id);
+    mock_can.mc_x_ids.push_back(expected_id);
+    std::array<mc_x*, 1> motors{ &driver };
+    int stall_count = 0;
+    driver.detect_stall({ .current_threshold = 2.0_A, .window = 10ms },
+                        [&stall_count]() { stall_count++; });
+    // Stationary with 5A (50 * 0.1A/LSB) of current
+    can::message_t stalled{ .id = expected_id + response_offset,
+                            .payload = { hal::value(mc_x::read::status_2),
+                                         25,
+                                         50,
+                                         0 },
+                            .length = 8 };
+    driver.velocity_control(10.0_rpm);
+
+    // Exercise
+    mc_x::emergency_stop_all(motors);
+    for (int i = 0; i < 20; i++) {
+      driver(stalled);
+    }
+
+    // Verify
+    expect(that % 0 == stall_count);
+    expect(that % 0 == driver.stall()->stalls());
+  };
+
+  "mc_x::emergency_stop_all() retries unacknowledged"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    std::array<std::optional<mc_x>, 2> drivers;
+    std::array<mc_x*, 2> motors{};
+    for (std::size_t i = 0; i < motors.size(); i++) {
+      drivers[i].emplace(router, mock_steady, 36.0f, expected_id + i, 20us);
+      motors[i] = &drivers[i].value();
+    }
+    // The second motor misses the broadcast but will respond to retries
+    mock_can.mc_x_ids = { expected_id + 1, expected_id };
+    mock_can.drop_count = 1;
+
+    // Exercise
+    auto const report = mc_x::emergency_stop_all(motors);
+
+    // Verify
+    expect(that % 2 == report.frames_sent);
+    expect(that % 0 == report.unacknowledged);
+    expect(that % 2 == mock_can.spy_send.call_history().size());
+    expect(that % (expected_id + 1) == mock_can.spy_send.history<0>(1).id);
+  };
+
+  "mc_x::emergency_stop_all() reports unresponsive motor"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    std::array<std::optional<mc_x>, 2> drivers;
+    std::array<mc_x*, 2> motors{};
+    for (std::size_t i = 0; i < motors.size(); i++) {
+      drivers[i].emplace(router, mock_steady, 36.0f, expected_id + i, 20us);
+      motors[i] = &drivers[i].value();
+      mock_can.mc_x_ids.push_back(expected_id + i);
+    }
+    mock_can.silent_ids.push_back(expected_id + 1);
+
+    // Exercise
+    auto const report = mc_x::emergency_stop_all(motors, 2);
+
+    // Verify
+    expect(that % 3 == report.frames_sent);
+    expect(that % 0b10 == report.unacknowledged);
+  };
+
+  "mc_x::request_stale() only requests stale field groups"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.mc_x_ids = { expected_id };
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    mc_x driver(router, mock_steady, 36.0f, expected_id);
+    auto const motion = hal::value(mc_x::field_group::motion);
+    auto const temperature = hal::value(mc_x::field_group::temperature);
+    auto const status = hal::value(mc_x::field_group::status);
+    mock_can.spy_send.reset();
+
+    // Exercise
+    auto const initial = driver.request_stale(1ms, motion | status);
+    auto const updated = driver.take_updated();
+    auto const fresh = driver.request_stale(1ms);
+    std::queue<std::uint64_t> later;
+    later.push(5'000);
+    mock_steady.set_uptimes(later);
+    auto const stale = driver.request_stale(1ms);
+
+    // Verify
+    expect(that % (motion | status) == initial);
+    // Both status replies carry the temperature
+    expect(that % (motion | temperature | status) == updated);
+    expect(that % hal::value(mc_x::field_group::angle) == fresh);
+    expect(that % mc_x::all_field_groups == stale);
+    expect(that % 6 == mock_can.spy_send.call_history().size());
+    expect(that % hal::value(mc_x::read::status_2) ==
+           mock_can.spy_send.history<0>(0).payload[0]);
+    expect(that % hal::value(mc_x::read::status_1_and_error_flags) ==
+           mock_can.spy_send.history<0>(1).payload[0]);
+  };
+
+  "mc_x::track_multi_turn() with a gear ratio"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.mc_x_ids = { expected_id };
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    mc_x driver(router, mock_steady, 36.0f, expected_id);
+    // 36000 * 0.01 = 360 output shaft degrees, MC-X angles are not geared
+    can::message_t angle{
+      .id = expected_id + response_offset,
+      .payload = { hal::value(mc_x::read::multi_turns_angle),
+                   0,
+                   0,
+                   0,
+                   0xA0,
+                   0x8C },
+      .length = 8,
+    };
+    can::message_t status{
+      .id = expected_id + response_offset,
+      .payload = { hal::value(mc_x::read::status_2) },
+      .length = 8,
+    };
+
+    // Exercise
+    driver.track_multi_turn({ .counts_per_turn = 16384 });
+    driver(status);
+    driver(angle);
+    auto const seeded = driver.multi_turn()->angle();
+    // A quarter rotor turn forward is 90 / 36 = 2.5 output shaft degrees
+    status.payload[6] = 0x00;
+    status.payload[7] = 0x10;
+    driver(status);
+    auto const advanced = driver.multi_turn()->angle();
+    driver(angle);
+
+    // Verify
+    expect(driver.multi_turn()->tracking());
+    expect(std::abs(seeded - 360.0f) < 0.01f);
+    expect(std::abs(advanced - 362.5f) < 0.01f);
+    // Resyncing to the reported angle only corrects the small drift
+    expect(std::abs(driver.multi_turn()->angle() - 360.0f) < 0.01f);
+    expect(std::abs(driver.multi_turn()->drift() + 2.5f) < 0.01f);
+  };
 };
 }  // namespace hal::rmd
\ No newline at end of file
@@ -0,0 +1,120 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/motion_estimator.hpp>
+
+#include <cmath>
+
+#include <boost/ut.hpp>
+
+namespace hal::rmd {
+void motion_estimator_test()
+{
+  using namespace boost::ut;
+  using namespace hal::literals;
+
+  "motion_estimator first position seeds the state"_test = []() {
+    // Setup
+    motion_estimator estimator(1.0_kHz, {});
+
+    // Exercise
+    estimator.update_position(100, 45.0f);
+
+    // Verify
+    expect(that % 45.0f == estimator.state().position);
+    expect(that % 0.0f == estimator.state().velocity);
+    expect(that % 100 == estimator.last_update());
+    expect(that % 1 == estimator.samples());
+  };
+
+  "motion_estimator tracks constant velocity"_test = []() {
+    // Setup
+    motion_estimator estimator(1.0_kHz, {});
+    constexpr float velocity = 90.0f;  // degrees per second
+
+    // Exercise
+    // 10ms telemetry period for 2 seconds
+    for (std::uint64_t t = 0; t <= 2000; t += 10) {
+      estimator.update_position(t, velocity * static_cast<float>(t) / 1000.0f);
+    }
+    auto const predicted = estimator.extrapolate(2050);
+
+    // Verify
+    expect(std::abs(estimator.state().velocity - velocity) < 0.5f);
+    expect(std::abs(estimator.state().acceleration) < 1.0f);
+    expect(std::abs(predicted.position - velocity * 2.05f) < 0.5f);
+  };
+
+  "motion_estimator tracks constant acceleration"_test = []() {
+    // Setup
+    motion_estimator estimator(1.0_kHz, {});
+    constexpr float acceleration = 20.0f;  // degrees per second squared
+
+    // Exercise
+    for (std::uint64_t t = 0; t <= 4000; t += 10) {
+      auto const seconds = static_cast<float>(t) / 1000.0f;
+      estimator.update_position(t, 0.5f * acceleration * seconds * seconds);
+    }
+
+    // Verify
+    expect(std::abs(estimator.state().acceleration - acceleration) < 1.0f);
+    expect(std::abs(estimator.state().velocity - acceleration * 4.0f) < 1.0f);
+  };
+
+  "motion_estimator velocity measurements"_test = []() {
+    // Setup
+    motion_estimator estimator(1.0_kHz, { .velocity_gain = 0.5f });
+    estimator.update_position(0, 0.0f);
+
+    // Exercise
+    estimator.update_velocity(10, 100.0f);
+    auto const first = estimator.state().velocity;
+    estimator.update_velocity(20, 100.0f);
+    auto const second = estimator.state().velocity;
+
+    // Verify
+    expect(that % 50.0f == first);
+    expect(that % 75.0f == second);
+    expect(estimator.state().position > 0.0f);
+  };
+
+  "motion_estimator::extrapolate() does not go backwards"_test = []() {
+    // Setup
+    motion_estimator estimator(1.0_kHz, {});
+    estimator.update_position(100, 10.0f);
+
+    // Exercise
+    auto const state = estimator.extrapolate(50);
+
+    // Verify
+    expect(that % 10.0f == state.position);
+  };
+
+  "motion_estimator::reset()"_test = []() {
+    // Setup
+    motion_estimator estimator(1.0_kHz, {});
+    estimator.update_position(0, 10.0f);
+    estimator.update_position(10, 20.0f);
+
+    // Exercise
+    estimator.reset();
+    estimator.update_position(20, -5.0f);
+
+    // Verify
+    expect(that % -5.0f == estimator.state().position);
+    expect(that % 0.0f == estimator.state().velocity);
+    expect(that % 1 == estimator.samples());
+  };
+}
+}  // namespace hal::rmd
@@ -0,0 +1,252 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/motor.hpp>
+
+#include <array>
+#include <cstdlib>
+
+#include <libhal-mock/steady_clock.hpp>
+
+#include <boost/ut.hpp>
+
+#include "fake_can.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr can::id_t device_id = 0x141;
+constexpr std::uint32_t drc_gear = 6;
+constexpr std::uint32_t mc_x_gear = 36;
+
+using static_drc = motor<drc, drc_gear, device_id>;
+using static_mc_x = motor<mc_x, mc_x_gear, device_id>;
+
+// Encoding runs at compile time: 10 rpm * 6 * 600 LSB/rpm = 0x8CA0
+static_assert(static_drc::velocity_payload(10.0f) ==
+              std::array<hal::byte, 8>{ 0xA2, 0, 0, 0, 0xA0, 0x8C, 0, 0 });
+// MC-X speed commands are not scaled by the gear ratio: 10 * 600 = 0x1770
+static_assert(static_mc_x::velocity_payload(10.0f) ==
+              std::array<hal::byte, 8>{ 0xA2, 0, 0, 0, 0x70, 0x17, 0, 0 });
+// Saturates rather than overflowing
+static_assert(
+  static_drc::velocity_payload(1e9f) ==
+  std::array<hal::byte, 8>{ 0xA2, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0x7F });
+// The wrapper adds no state to the runtime driver
+static_assert(sizeof(static_drc) == sizeof(drc));
+static_assert(sizeof(static_mc_x) == sizeof(mc_x));
+
+struct command_case
+{
+  float angle;
+  float speed;
+};
+
+constexpr std::array cases{
+  command_case{ 0.0f, 0.0f },      command_case{ 90.0f, 10.0f },
+  command_case{ -45.25f, -25.5f }, command_case{ 720.0f, 100.0f },
+  command_case{ 12.5f, -3.0f },
+};
+
+/// Signed little endian field of a payload
+std::int32_t field(std::array<hal::byte, 8> const& p_payload,
+                   std::size_t p_offset,
+                   std::size_t p_size)
+{
+  std::uint32_t value = 0;
+  for (std::size_t i = 0; i < p_size; i++) {
+    value |= static_cast<std::uint32_t>(p_payload[p_offset + i]) << (8 * i);
+  }
+  auto const unused_bits = 32 - 8 * p_size;
+  return static_cast<std::int32_t>(value << unused_bits) >> unused_bits;
+}
+
+/// Number of fields that differ from the runtime driver's when sweeping
+/// commands across a 0.01 rpm grid from -100 rpm to 100 rpm.
+template<class static_motor, class runtime_driver>
+std::size_t sweep(runtime_driver& p_runtime, fake_can& p_runtime_bus)
+{
+  std::size_t mismatches = 0;
+  auto check = [&mismatches](std::int32_t p_expected, std::int32_t p_actual) {
+    if (p_expected != p_actual) {
+      mismatches++;
+    }
+  };
+
+  for (int step = -10'000; step <= 10'000; step++) {
+    auto const speed = static_cast<float>(step) * 0.01f;
+    auto const angle = static_cast<float>(step) * 0.37f;
+    p_runtime_bus.spy_send.reset();
+    p_runtime.velocity_control(speed);
+    p_runtime.position_control(angle, speed);
+    p_runtime.incremental_position_control(angle, speed);
+
+    std::array const expected{
+      static_motor::velocity_payload(speed),
+      static_motor::position_payload(angle, speed),
+      static_motor::incremental_position_payload(angle, speed),
+    };
+    auto const sent = [&p_runtime_bus](std::size_t p_index) {
+      return p_runtime_bus.spy_send.history<0>(p_index).payload;
+    };
+    check(field(expected[0], 4, 4), field(sent(0), 4, 4));
+    for (std::size_t i = 1; i < expected.size(); i++) {
+      check(field(expected[i], 2, 2), field(sent(i), 2, 2));
+      check(field(expected[i], 4, 4), field(sent(i), 4, 4));
+    }
+  }
+
+  return mismatches;
+}
+
+/// Run every motion command through both drivers and collect the frames
+template<class runtime_driver, class static_motor>
+void compare(runtime_driver& p_runtime,
+             static_motor& p_static,
+             fake_can& p_runtime_bus,
+             fake_can& p_static_bus)
+{
+  using namespace boost::ut;
+
+  for (auto const& command : cases) {
+    p_runtime.velocity_control(command.speed);
+    p_static.velocity_control(command.speed);
+    p_runtime.position_control(command.angle, command.speed);
+    p_static.position_control(command.angle, command.speed);
+    p_runtime.incremental_position_control(command.angle, command.speed);
+    p_static.incremental_position_control(command.angle, command.speed);
+  }
+
+  expect(that % p_runtime_bus.sent() == p_static_bus.sent());
+  for (std::size_t i = 0; i < p_runtime_bus.sent(); i++) {
+    expect(p_runtime_bus.spy_send.history<0>(i) ==
+           p_static_bus.spy_send.history<0>(i));
+  }
+}
+}  // namespace
+
+void motor_test()
+{
+  using namespace boost::ut;
+
+  "motor<drc> encodes the same frames as drc for exact values"_test = []() {
+    // Setup
+    fake_can runtime_bus;
+    fake_can static_bus;
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router runtime_router(runtime_bus);
+    hal::can_router static_router(static_bus);
+    drc runtime(runtime_router,
+                clock,
+                static_cast<float>(drc_gear),
+                device_id,
+                std::chrono::milliseconds(10),
+                drc::startup::attach);
+    static_drc compile_time(static_router,
+                            clock,
+                            std::chrono::milliseconds(10),
+                            drc::startup::attach);
+
+    // Exercise & Verify
+    compare(runtime, compile_time, runtime_bus, static_bus);
+    expect(that % cases.size() * 3 == static_bus.sent());
+    expect(that % device_id == static_bus.spy_send.history<0>(0).id);
+    expect(that % 3 * cases.size() == compile_time.feedback().message_number);
+  };
+
+  "motor<mc_x> encodes the same frames as mc_x for exact values"_test = []() {
+    // Setup
+    fake_can runtime_bus;
+    fake_can static_bus;
+    runtime_bus.mc_x_ids = { device_id };
+    static_bus.mc_x_ids = { device_id };
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router runtime_router(runtime_bus);
+    hal::can_router static_router(static_bus);
+    mc_x runtime(
+      runtime_router, clock, static_cast<float>(mc_x_gear), device_id);
+    static_mc_x compile_time(static_router, clock);
+
+    // Exercise & Verify
+    compare(runtime, compile_time, runtime_bus, static_bus);
+    expect(that % cases.size() * 3 == static_bus.sent());
+    expect(that % 3 * cases.size() == compile_time.feedback().message_number);
+  };
+
+  "motor<drc> encodes the same frames as drc"_test = []() {
+    // Setup
+    fake_can bus;
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router router(bus);
+    drc runtime(router,
+                clock,
+                static_cast<float>(drc_gear),
+                device_id,
+                std::chrono::milliseconds(10),
+                drc::startup::attach);
+
+    // Exercise
+    auto const mismatches = sweep<static_drc>(runtime, bus);
+    bus.spy_send.reset();
+    runtime.velocity_control(0.03f);
+
+    // Verify
+    expect(that % 0 == mismatches);
+    // 0.03 rpm is not representable, so a folded scale would round to 108
+    expect(that % 107 == field(static_drc::velocity_payload(0.03f), 4, 4));
+    expect(that % 107 == field(bus.spy_send.history<0>(0).payload, 4, 4));
+  };
+
+  "motor<mc_x> encodes the same frames as mc_x"_test = []() {
+    // Setup
+    fake_can bus;
+    bus.mc_x_ids = { device_id };
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router router(bus);
+    mc_x runtime(router, clock, static_cast<float>(mc_x_gear), device_id);
+
+    // Exercise
+    auto const mismatches = sweep<static_mc_x>(runtime, bus);
+
+    // Verify
+    expect(that % 0 == mismatches);
+  };
+
+  "motor forwards the remaining commands to its driver"_test = []() {
+    // Setup
+    fake_can bus;
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router router(bus);
+    static_drc compile_time(
+      router, clock, std::chrono::milliseconds(10), drc::startup::attach);
+
+    // Exercise
+    compile_time.feedback_request(drc::read::status_2);
+    compile_time.system_control(drc::system::stop);
+    compile_time.transmit({ 0x9A });
+
+    // Verify
+    expect(that % 3 == bus.sent());
+    expect(that % 0x9C == bus.spy_send.history<0>(0).payload[0]);
+    expect(that % 0x81 == bus.spy_send.history<0>(1).payload[0]);
+    expect(that % 0x9A == bus.spy_send.history<0>(2).payload[0]);
+    expect(that % 6.0f == static_drc::gear_ratio);
+    expect(that % 3 == compile_time.runtime().feedback().message_number);
+  };
+};
+}  // namespace hal::rmd
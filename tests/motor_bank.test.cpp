@@ -0,0 +1,206 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/motor_bank.hpp>
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <libhal-mock/steady_clock.hpp>
+#include <libhal-rmd/drc.hpp>
+#include <libhal-rmd/mc_x.hpp>
+#include <libhal-rmd/motor.hpp>
+
+#include <boost/ut.hpp>
+
+#include "fake_can.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr can::id_t first_id = 0x141;
+constexpr can::id_t mc_x_response_offset = fake_can::mc_x_response_offset;
+
+static_assert(std::is_nothrow_move_constructible_v<drc>);
+static_assert(std::is_nothrow_move_assignable_v<drc>);
+static_assert(std::is_nothrow_move_constructible_v<mc_x>);
+static_assert(std::is_nothrow_move_assignable_v<mc_x>);
+static_assert(std::is_nothrow_move_constructible_v<motor<drc, 6, first_id>>);
+
+/// Status 2 reply from the given ID reporting 25C
+can::message_t status_2(can::id_t p_id)
+{
+  return { .id = p_id, .payload = { 0x9C, 0x19 }, .length = 8 };
+}
+
+drc make_drc(hal::can_router& p_router,
+             hal::steady_clock& p_clock,
+             can::id_t p_id)
+{
+  return { p_router,
+           p_clock,
+           6.0f,
+           p_id,
+           std::chrono::milliseconds(10),
+           drc::startup::attach };
+}
+}  // namespace
+
+void motor_bank_test()
+{
+  using namespace boost::ut;
+
+  "drc move re-binds the router callback"_test = []() {
+    // Setup
+    fake_can bus;
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router router(bus);
+    drc original = make_drc(router, clock, first_id);
+    original.feedback_request(drc::read::status_2);
+
+    // Exercise
+    drc moved(std::move(original));
+    bus.receive(status_2(first_id));
+
+    // Verify
+    expect(that % 2 == moved.feedback().message_number);
+    expect(that % 25 == moved.feedback().raw_motor_temperature);
+    moved.feedback_request(drc::read::status_2);
+    expect(that % 3 == moved.feedback().message_number);
+  };
+
+  "drc move assignment releases the previous route"_test = []() {
+    // Setup
+    fake_can bus;
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router router(bus);
+    drc first = make_drc(router, clock, first_id);
+    drc second = make_drc(router, clock, first_id + 1);
+
+    // Exercise
+    second = std::move(first);
+    bus.receive(status_2(first_id));
+    bus.receive(status_2(first_id + 1));
+
+    // Verify
+    expect(that % 1 == second.feedback().message_number);
+    second.velocity_control(1.0_rpm);
+    expect(that % 2 == second.feedback().message_number);
+  };
+
+  "mc_x move re-binds the router callback"_test = []() {
+    // Setup
+    fake_can bus;
+    bus.mc_x_ids = { first_id, first_id + 1 };
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router router(bus);
+    mc_x original(router, clock, 36.0f, first_id);
+    mc_x other(router, clock, 36.0f, first_id + 1);
+
+    // Exercise
+    mc_x moved(std::move(original));
+    other = std::move(moved);
+    bus.receive(status_2(first_id + mc_x_response_offset));
+    other.feedback_request(mc_x::read::status_2);
+
+    // Verify
+    expect(that % 2 == other.feedback().message_number);
+  };
+
+  "drc can be stored in a std::vector"_test = []() {
+    // Setup
+    fake_can bus;
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router router(bus);
+    std::vector<drc> motors;
+
+    // Exercise
+    for (can::id_t id = first_id; id < first_id + 8; id++) {
+      motors.push_back(make_drc(router, clock, id));
+    }
+    for (auto& motor : motors) {
+      motor.feedback_request(drc::read::status_2);
+    }
+
+    // Verify
+    for (auto const& motor : motors) {
+      expect(that % 1 == motor.feedback().message_number);
+    }
+  };
+
+  "motor_bank stores motors contiguously"_test = []() {
+    // Setup
+    fake_can bus;
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router router(bus);
+    motor_bank<drc, 4> bank;
+
+    // Exercise
+    for (can::id_t id = first_id; id < first_id + 3; id++) {
+      bank.emplace(router,
+                   clock,
+                   6.0f,
+                   id,
+                   std::chrono::milliseconds(10),
+                   drc::startup::attach);
+    }
+    bank.emplace(make_drc(router, clock, first_id + 3));
+    for (auto& motor : bank) {
+      motor.feedback_request(drc::read::status_2);
+    }
+
+    // Verify
+    expect(that % 4 == bank.size());
+    expect(that % bank.full());
+    expect(that % 4 == decltype(bank)::max_size());
+    expect(&bank[1] == &bank[0] + 1);
+    expect(that % 4 == bank.motors().size());
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { bank.emplace(make_drc(router, clock, first_id + 4)); }));
+    for (auto const& motor : bank) {
+      expect(that % 1 == motor.feedback().message_number);
+    }
+  };
+
+  "motor_bank move and clear keep routes consistent"_test = []() {
+    // Setup
+    fake_can bus;
+    bus.mc_x_ids = { first_id, first_id + 1 };
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    hal::can_router router(bus);
+    motor_bank<mc_x, 2> bank;
+    bank.emplace(router, clock, 36.0f, first_id);
+    bank.emplace(router, clock, 36.0f, first_id + 1);
+
+    // Exercise
+    motor_bank<mc_x, 2> moved(std::move(bank));
+    for (auto& motor : moved) {
+      motor.feedback_request(mc_x::read::status_2);
+    }
+    moved.clear();
+    bus.receive(status_2(first_id + mc_x_response_offset));
+
+    // Verify
+    expect(that % 0 == bank.size());
+    expect(that % 0 == moved.size());
+    expect(that % 2 == bus.sent());
+  };
+};
+}  // namespace hal::rmd
@@ -0,0 +1,119 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/multi_turn_tracker.hpp>
+
+#include <cmath>
+
+#include <boost/ut.hpp>
+
+namespace hal::rmd {
+void multi_turn_tracker_test()
+{
+  using namespace boost::ut;
+
+  "multi_turn_tracker waits for a seed"_test = []() {
+    // Setup
+    multi_turn_tracker tracker(1.0f, {});
+
+    // Exercise
+    tracker.update(1000);
+
+    // Verify
+    expect(not tracker.tracking());
+    expect(tracker.resync_due());
+    expect(that % 0 == tracker.updates_since_seed());
+  };
+
+  "multi_turn_tracker seed uses the last encoder reading"_test = []() {
+    // Setup
+    multi_turn_tracker tracker(1.0f, { .counts_per_turn = 3600 });
+    tracker.update(100);
+
+    // Exercise
+    tracker.seed(720.0f);
+    tracker.update(190);
+
+    // Verify
+    expect(tracker.tracking());
+    // 90 counts at 0.1 degrees per count
+    expect(std::abs(tracker.angle() - 729.0f) < 0.001f);
+  };
+
+  "multi_turn_tracker seed without an encoder reading"_test = []() {
+    // Setup
+    multi_turn_tracker tracker(1.0f, { .counts_per_turn = 3600 });
+
+    // Exercise
+    tracker.seed(-90.0f);
+    auto const waiting = not tracker.tracking();
+    tracker.update(3000);
+    auto const reference = tracker.angle();
+    tracker.update(2900);
+
+    // Verify
+    expect(waiting);
+    expect(that % -90.0f == reference);
+    expect(std::abs(tracker.angle() - -100.0f) < 0.001f);
+  };
+
+  "multi_turn_tracker unwraps across the encoder rollover"_test = []() {
+    // Setup
+    multi_turn_tracker tracker(9.0f, {});
+    tracker.update(0);
+    tracker.seed(0.0f);
+
+    // Exercise
+    // Three full rotor turns forward in 1/8th turn steps, then one back
+    std::uint32_t encoder = 0;
+    for (int i = 0; i < 24; i++) {
+      encoder = (encoder + 8192) % 65536;
+      tracker.update(static_cast<std::int16_t>(encoder));
+    }
+    auto const forward = tracker.angle();
+    for (int i = 0; i < 8; i++) {
+      encoder = (encoder + 65536 - 8192) % 65536;
+      tracker.update(static_cast<std::int16_t>(encoder));
+    }
+
+    // Verify
+    // 3 rotor turns = 120 output shaft degrees with a 9:1 gear ratio
+    expect(std::abs(forward - 120.0f) < 0.01f);
+    expect(std::abs(tracker.angle() - 80.0f) < 0.01f);
+  };
+
+  "multi_turn_tracker resync"_test = []() {
+    // Setup
+    multi_turn_tracker tracker(
+      1.0f, { .counts_per_turn = 3600, .resync_interval = 3 });
+    tracker.update(0);
+    tracker.seed(0.0f);
+
+    // Exercise
+    tracker.update(10);
+    tracker.update(20);
+    auto const early = tracker.resync_due();
+    tracker.update(30);
+    auto const due = tracker.resync_due();
+    tracker.seed(3.5f);
+
+    // Verify
+    expect(not early);
+    expect(due);
+    expect(not tracker.resync_due());
+    expect(std::abs(tracker.drift() - 0.5f) < 0.001f);
+    expect(that % 3.5f == tracker.angle());
+  };
+}
+}  // namespace hal::rmd
@@ -0,0 +1,109 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/rtt_estimator.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal::rmd {
+void rtt_estimator_test()
+{
+  using namespace boost::ut;
+  using namespace std::literals;
+
+  "rtt_estimator::timeout() without samples"_test = []() {
+    // Setup
+    rtt_estimator estimator({ .floor = 200us, .ceiling = 10ms });
+
+    // Exercise
+    auto const timeout = estimator.timeout();
+
+    // Verify
+    expect(that % 10ms == timeout);
+    expect(that % 0 == estimator.samples());
+  };
+
+  "rtt_estimator::record() steady round trips"_test = []() {
+    // Setup
+    rtt_estimator estimator({ .floor = 200us, .ceiling = 10ms });
+
+    // Exercise
+    for (int i = 0; i < 100; i++) {
+      estimator.record(300us);
+    }
+
+    // Verify
+    expect(that % 100 == estimator.samples());
+    expect(299us <= estimator.mean() && estimator.mean() <= 301us);
+    expect(estimator.deviation() < 5us);
+    expect(estimator.timeout() < 400us);
+    expect(that % 200us <= estimator.timeout());
+  };
+
+  "rtt_estimator::record() jitter widens timeout"_test = []() {
+    // Setup
+    rtt_estimator steady({ .floor = 100us, .ceiling = 10ms });
+    rtt_estimator jittery({ .floor = 100us, .ceiling = 10ms });
+
+    // Exercise
+    for (int i = 0; i < 100; i++) {
+      steady.record(300us);
+      jittery.record((i % 2) ? 100us : 500us);
+    }
+
+    // Verify
+    expect(steady.timeout() < jittery.timeout());
+    expect(jittery.timeout() < 10ms);
+  };
+
+  "rtt_estimator::timeout() clamped to bounds"_test = []() {
+    // Setup
+    rtt_estimator estimator({ .floor = 1ms, .ceiling = 2ms });
+
+    // Exercise
+    estimator.record(10us);
+    auto const low = estimator.timeout();
+    estimator.record(50ms);
+    auto const high = estimator.timeout();
+
+    // Verify
+    expect(that % 1ms == low);
+    expect(that % 2ms == high);
+  };
+
+  "rtt_estimator::record_timeout() backs off"_test = []() {
+    // Setup
+    rtt_estimator estimator({ .floor = 100us, .ceiling = 10ms });
+    for (int i = 0; i < 100; i++) {
+      estimator.record(300us);
+    }
+    auto const initial = estimator.timeout();
+
+    // Exercise
+    estimator.record_timeout();
+    auto const backoff = estimator.timeout();
+    for (int i = 0; i < 20; i++) {
+      estimator.record_timeout();
+    }
+    auto const saturated = estimator.timeout();
+    estimator.record(300us);
+    auto const recovered = estimator.timeout();
+
+    // Verify
+    expect(initial < backoff);
+    expect(that % 10ms == saturated);
+    expect(recovered <= initial);
+  };
+};
+}  // namespace hal::rmd
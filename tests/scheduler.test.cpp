@@ -0,0 +1,270 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/scheduler.hpp>
+
+#include <libhal-mock/steady_clock.hpp>
+#include <libhal-util/enum.hpp>
+
+#include <boost/ut.hpp>
+
+#include "fake_can.hpp"
+
+namespace hal::rmd {
+namespace {
+constexpr can::id_t expected_id = 0x141;
+
+std::queue<std::uint64_t> create_queue()
+{
+  std::queue<std::uint64_t> new_queue;
+  for (std::uint64_t i = 0; i < 100'000; i++) {
+    new_queue.push(i);
+  }
+  return new_queue;
+}
+
+std::array<hal::byte, 8> command(hal::byte p_command)
+{
+  return { p_command, 0, 0, 0, 0, 0, 0, 0 };
+}
+}  // namespace
+
+void scheduler_test()
+{
+  using namespace boost::ut;
+  using namespace std::literals;
+  using namespace hal::literals;
+
+  "scheduler::classify()"_test = []() {
+    using enum scheduler::priority;
+    expect(emergency == scheduler::classify(hal::value(drc::system::stop)));
+    expect(emergency == scheduler::classify(hal::value(mc_x::system::off)));
+    expect(setpoint == scheduler::classify(hal::value(drc::actuate::speed)));
+    expect(setpoint == scheduler::classify(hal::value(mc_x::actuate::torque)));
+    expect(telemetry == scheduler::classify(hal::value(drc::read::status_2)));
+    expect(configuration ==
+           scheduler::classify(hal::value(drc::write::pid_to_rom)));
+  };
+
+  "scheduler::service() transmits by priority"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.echo = false;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc motor(router,
+              mock_steady,
+              6.0f,
+              expected_id,
+              10ms,
+              drc::startup::attach);
+    scheduler bus_scheduler(mock_steady);
+    std::array expected{
+      hal::value(drc::system::stop),
+      hal::value(drc::actuate::speed),
+      hal::value(drc::read::status_2),
+      hal::value(drc::write::pid_to_ram),
+    };
+
+    // Exercise
+    bus_scheduler.submit(&motor, command(expected[3]));
+    bus_scheduler.submit(&motor, command(expected[2]));
+    bus_scheduler.submit(&motor, command(expected[1]));
+    bus_scheduler.submit(&motor, command(expected[0]));
+    for (std::size_t i = 0; i < expected.size(); i++) {
+      bus_scheduler.service();
+      auto response = mock_can.spy_send.history<0>(i);
+      motor(response);
+    }
+    auto const work_remaining = bus_scheduler.service();
+
+    // Verify
+    expect(not work_remaining);
+    expect(that % 4 == mock_can.spy_send.call_history().size());
+    for (std::size_t i = 0; i < expected.size(); i++) {
+      expect(that % expected[i] ==
+             mock_can.spy_send.history<0>(i).payload[0]);
+    }
+    expect(that % 4 == bus_scheduler.stats().sent);
+    expect(that % 4 == bus_scheduler.stats().completed);
+  };
+
+  "scheduler::service() emergency preempts in flight command"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.echo = false;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc motor(router,
+              mock_steady,
+              6.0f,
+              expected_id,
+              10ms,
+              drc::startup::attach);
+    scheduler bus_scheduler(mock_steady);
+    bus_scheduler.submit(&motor, command(hal::value(drc::read::status_2)));
+    bus_scheduler.submit(&motor, command(hal::value(drc::read::status_2)));
+    bus_scheduler.service();
+
+    // Exercise
+    bus_scheduler.submit(&motor, command(hal::value(drc::system::stop)));
+    bus_scheduler.service();
+
+    // Verify
+    expect(that % 2 == mock_can.spy_send.call_history().size());
+    expect(that % hal::value(drc::system::stop) ==
+           mock_can.spy_send.history<0>(1).payload[0]);
+    expect(that % 1 == bus_scheduler.stats().preempted);
+    expect(that % 1 == bus_scheduler.pending(scheduler::priority::telemetry));
+  };
+
+  "scheduler::service() ignores late response of preempted command"_test =
+    []() {
+      // Setup
+      fake_can mock_can;
+      mock_can.echo = false;
+      mock::steady_clock mock_steady;
+      auto queue = create_queue();
+      mock_steady.set_uptimes(queue);
+      mock_steady.set_frequency(1.0_MHz);
+      hal::can_router router(mock_can);
+      drc motor(router,
+                mock_steady,
+                6.0f,
+                expected_id,
+                10ms,
+                drc::startup::attach);
+      scheduler bus_scheduler(mock_steady);
+      bus_scheduler.submit(&motor, command(hal::value(drc::actuate::speed)));
+      bus_scheduler.submit(&motor, command(hal::value(drc::read::status_2)));
+      bus_scheduler.service();
+      bus_scheduler.submit(&motor, command(hal::value(drc::system::stop)));
+      bus_scheduler.service();
+
+      // Exercise
+      motor(mock_can.spy_send.history<0>(0));
+      bus_scheduler.service();
+      auto const sent_after_late_response =
+        mock_can.spy_send.call_history().size();
+      auto const completed_after_late_response =
+        bus_scheduler.stats().completed;
+      motor(mock_can.spy_send.history<0>(1));
+      bus_scheduler.service();
+
+      // Verify
+      expect(that % 2 == sent_after_late_response);
+      expect(that % 0 == completed_after_late_response);
+      expect(that % 1 == bus_scheduler.stats().completed);
+      expect(that % 3 == mock_can.spy_send.call_history().size());
+      expect(that % hal::value(drc::read::status_2) ==
+             mock_can.spy_send.history<0>(2).payload[0]);
+    };
+
+  "scheduler::service() completes when a late response arrives last"_test =
+    []() {
+      // Setup
+      fake_can mock_can;
+      mock_can.echo = false;
+      mock::steady_clock mock_steady;
+      auto queue = create_queue();
+      mock_steady.set_uptimes(queue);
+      mock_steady.set_frequency(1.0_MHz);
+      hal::can_router router(mock_can);
+      drc motor(router,
+                mock_steady,
+                6.0f,
+                expected_id,
+                10ms,
+                drc::startup::attach);
+      scheduler bus_scheduler(mock_steady);
+      bus_scheduler.submit(&motor, command(hal::value(drc::actuate::speed)));
+      bus_scheduler.service();
+      bus_scheduler.submit(&motor, command(hal::value(drc::system::stop)));
+      bus_scheduler.service();
+
+      // Exercise
+      // Both responses arrive between two calls to service()
+      motor(mock_can.spy_send.history<0>(1));
+      motor(mock_can.spy_send.history<0>(0));
+      bus_scheduler.service();
+
+      // Verify
+      expect(that % 2 == mock_can.spy_send.call_history().size());
+      expect(that % 1 == bus_scheduler.stats().preempted);
+      expect(that % 1 == bus_scheduler.stats().completed);
+      expect(that % 0 == bus_scheduler.stats().timeouts);
+      expect(bus_scheduler.idle());
+    };
+
+  "scheduler::service() timeout"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.echo = false;
+    mock::steady_clock mock_steady;
+    auto queue = create_queue();
+    mock_steady.set_uptimes(queue);
+    mock_steady.set_frequency(1.0_MHz);
+    hal::can_router router(mock_can);
+    drc motor(router,
+              mock_steady,
+              6.0f,
+              expected_id,
+              10ms,
+              drc::startup::attach);
+    scheduler bus_scheduler(mock_steady, 100us);
+    bus_scheduler.submit(&motor, command(hal::value(drc::read::status_2)));
+
+    // Exercise
+    bus_scheduler.flush();
+
+    // Verify
+    expect(that % 1 == bus_scheduler.stats().sent);
+    expect(that % 1 == bus_scheduler.stats().timeouts);
+    expect(that % 0 == bus_scheduler.stats().completed);
+  };
+
+  "scheduler::submit() full queue"_test = []() {
+    // Setup
+    fake_can mock_can;
+    mock_can.echo = false;
+    mock::steady_clock mock_steady;
+    hal::can_router router(mock_can);
+    drc motor(router,
+              mock_steady,
+              6.0f,
+              expected_id,
+              10ms,
+              drc::startup::attach);
+    scheduler bus_scheduler(mock_steady);
+    auto const payload = command(hal::value(drc::read::status_2));
+
+    // Exercise
+    for (std::size_t i = 0; i < scheduler::queue_depth; i++) {
+      bus_scheduler.submit(&motor, payload);
+    }
+    auto const accepted = bus_scheduler.submit(&motor, payload);
+
+    // Verify
+    expect(not accepted);
+    expect(that % scheduler::queue_depth ==
+           bus_scheduler.pending(scheduler::priority::telemetry));
+  };
+};
+}  // namespace hal::rmd
@@ -0,0 +1,202 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/linux/shared_telemetry.hpp>
+
+#include <atomic>
+#include <queue>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <libhal-mock/steady_clock.hpp>
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal::rmd {
+namespace {
+/// Unique per process so parallel test runs do not share a segment
+std::string segment_name(std::string_view p_test)
+{
+  return "/libhal_rmd_" + std::string(p_test) + "_" +
+         std::to_string(getpid());
+}
+}  // namespace
+
+void shared_telemetry_test()
+{
+  using namespace boost::ut;
+  using namespace hal::literals;
+
+  "telemetry_reader::read() unpublished slot"_test = []() {
+    // Setup
+    hal::mock::steady_clock clock;
+    auto const name = segment_name("unpublished");
+    telemetry_exporter exporter(name, clock);
+    telemetry_reader reader(name);
+
+    // Exercise
+    auto const record = reader.read(0);
+
+    // Verify
+    expect(not record.has_value());
+    expect(that % 0 == reader.publishes());
+  };
+
+  "telemetry_exporter::publish() drc feedback"_test = []() {
+    // Setup
+    hal::mock::steady_clock clock;
+    clock.set_frequency(1.0_MHz);
+    std::queue<std::uint64_t> uptimes;
+    uptimes.push(2'500);
+    clock.set_uptimes(uptimes);
+    auto const name = segment_name("drc");
+    telemetry_exporter exporter(name, clock);
+    telemetry_reader reader(name);
+    drc::feedback_t feedback{};
+    feedback.message_number = 7;
+    feedback.raw_multi_turn_angle = 36'000;
+    feedback.raw_motor_temperature = 40;
+    feedback.raw_error_state = 0x08;
+    feedback.encoder = 1234;
+
+    // Exercise
+    exporter.publish(3, 0x143, feedback);
+    auto const record = reader.read(3);
+
+    // Verify
+    expect(record.has_value());
+    expect(that % 2'500'000 == record->timestamp_ns);
+    expect(that % 0x143 == record->device_id);
+    expect(that % 7 == record->message_number);
+    expect(that % 1 == record->publishes);
+    expect(that % 36'000 == record->raw_multi_turn_angle);
+    expect(that % feedback.angle() == record->angle);
+    expect(that % feedback.temperature() == record->temperature);
+    expect(that % 0x08 == record->error_state);
+    expect(that % 1234 == record->encoder);
+    expect(telemetry_record::model_t::drc == record->model);
+    expect(that % 1 == reader.publishes());
+    expect(not reader.read(2).has_value());
+  };
+
+  "telemetry_exporter::publish() mc_x feedback"_test = []() {
+    // Setup
+    hal::mock::steady_clock clock;
+    auto const name = segment_name("mc_x");
+    telemetry_exporter exporter(name, clock);
+    telemetry_reader reader(name);
+    mc_x::feedback_t feedback{};
+    feedback.raw_error_state = 0x0400;
+
+    // Exercise
+    exporter.publish(0, 0x141, feedback);
+    exporter.publish(0, 0x141, feedback);
+    auto const record = reader.read(0);
+
+    // Verify
+    expect(record.has_value());
+    expect(that % 2 == record->publishes);
+    expect(that % 0x0400 == record->error_state);
+    expect(telemetry_record::model_t::mc_x == record->model);
+  };
+
+  "telemetry_reader rejects missing segments and bad slots"_test = []() {
+    hal::mock::steady_clock clock;
+    auto const name = segment_name("slots");
+    telemetry_exporter exporter(name, clock);
+    telemetry_reader reader(name);
+
+    expect(throws<hal::io_error>(
+      []() { telemetry_reader missing(segment_name("missing")); }));
+    expect(throws<hal::argument_out_of_domain>([&]() {
+      exporter.publish(
+        telemetry_exporter::slot_count, 0x141, drc::feedback_t{});
+    }));
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { reader.read(telemetry_exporter::slot_count); }));
+  };
+
+  "telemetry_reader never observes a torn record"_test = []() {
+    // Setup
+    hal::mock::steady_clock clock;
+    auto const name = segment_name("torn");
+    telemetry_exporter exporter(name, clock);
+    telemetry_reader reader(name);
+    std::atomic<bool> done = false;
+    bool consistent = true;
+    std::uint64_t reads = 0;
+
+    // Exercise
+    std::jthread writer([&]() {
+      drc::feedback_t feedback{};
+      for (std::uint32_t i = 1; i <= 200'000; i++) {
+        feedback.message_number = i;
+        feedback.raw_multi_turn_angle = std::int64_t{ i } * 3;
+        feedback.encoder = static_cast<std::int16_t>(i);
+        exporter.publish(0, 0x141, feedback);
+      }
+      done = true;
+    });
+    while (not done) {
+      if (auto const record = reader.read(0)) {
+        auto const number = record->message_number;
+        auto const angle = std::int64_t{ number } * 3;
+        consistent = consistent && record->raw_multi_turn_angle == angle &&
+                     record->encoder == static_cast<std::int16_t>(number) &&
+                     record->publishes == number;
+        reads++;
+      }
+    }
+    writer.join();
+
+    // Verify
+    expect(consistent);
+    expect(0 < reads);
+    expect(that % 200'000 == reader.read(0)->message_number);
+  };
+
+  "telemetry_reader gives up on a slot left mid publish"_test = []() {
+    // Setup
+    hal::mock::steady_clock clock;
+    auto const name = segment_name("dead");
+    telemetry_exporter exporter(name, clock);
+    telemetry_reader reader(name);
+    exporter.publish(0, 0x141, drc::feedback_t{});
+    // Simulate an exporter that died mid publish by leaving the sequence of
+    // the first slot, which starts on the second cache line, odd.
+    auto const descriptor = shm_open(name.c_str(), O_RDWR, 0);
+    auto* const memory =
+      mmap(nullptr, 128, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    auto* const sequence =
+      reinterpret_cast<std::atomic<std::uint32_t>*>(
+        static_cast<char*>(memory) + 64);
+    sequence->store(3);
+
+    // Exercise
+    auto const gave_up = throws<hal::resource_unavailable_try_again>(
+      [&]() { reader.read(0); });
+    munmap(memory, 128);
+
+    // Verify
+    expect(gave_up);
+    expect(that % telemetry_reader::max_read_retries == reader.retries());
+  };
+}
+}  // namespace hal::rmd
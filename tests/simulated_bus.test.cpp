@@ -0,0 +1,119 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/simulated_bus.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <libhal/can.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal::rmd {
+void simulated_bus_test()
+{
+  using namespace boost::ut;
+  using namespace hal::literals;
+
+  "simulated_bus::frame_ns()"_test = []() {
+    // Setup
+    simulated_bus bus;
+    simulated_bus stuffed_bus({ .worst_case_stuffing = true });
+    simulated_bus slow_bus({ .baudrate = 500.0_kHz });
+
+    // Exercise + Verify
+    // 111 bits at 1 Mbit/s, 24 of them stuff bits in the worst case
+    expect(that % 111'000 == bus.frame_ns(8));
+    expect(that % 135'000 == stuffed_bus.frame_ns(8));
+    expect(that % 222'000 == slow_bus.frame_ns(8));
+    expect(that % 47'000 == bus.frame_ns(0));
+  };
+
+  "simulated_bus keeps the bus busy for one frame per send"_test = []() {
+    // Setup
+    simulated_bus bus({ .poll_ns = 0 });
+    hal::can::message_t const request{ .id = 0x141, .length = 8 };
+
+    // Exercise
+    bus.host().send(request);
+    bus.advance(500'000);
+
+    // Verify
+    expect(that % 1 == bus.stats().host_frames);
+    expect(that % 0 == bus.stats().device_frames);
+    expect(that % 111'000 == bus.stats().busy_ns);
+    expect(that % 500'000 == bus.now());
+  };
+
+  "simulated_bus delivers the reply after the processing delay"_test = []() {
+    // Setup
+    simulated_bus bus({ .poll_ns = 0 });
+    bus.add_device({ .id = 0x141, .reply_id = 0x141, .processing_ns = 50'000 });
+    std::vector<std::pair<can::id_t, std::uint64_t>> received;
+    bus.host().on_receive([&](hal::can::message_t const& p_message) {
+      received.emplace_back(p_message.id, bus.now());
+    });
+    hal::can::message_t const request{ .id = 0x141, .length = 8 };
+
+    // Exercise
+    bus.host().send(request);
+    bus.advance(500'000);
+
+    // Verify
+    // request frame + processing delay + reply frame
+    expect(that % 1 == received.size());
+    expect(that % 0x141 == received[0].first);
+    expect(that % 272'000 == received[0].second);
+    expect(that % 1 == bus.stats().host_frames);
+    expect(that % 1 == bus.stats().device_frames);
+    expect(that % 222'000 == bus.stats().busy_ns);
+    expect(that % 0 == bus.stats().arbitration_losses);
+  };
+
+  "simulated_bus arbitrates ready frames by lowest ID"_test = []() {
+    // Setup
+    simulated_bus bus({ .poll_ns = 0 });
+    // Added first so that insertion order cannot explain the result
+    bus.add_device({ .id = 0x142,
+                     .reply_id = 0x242,
+                     .processing_ns = 50'000,
+                     .broadcast_id = 0x280 });
+    bus.add_device({ .id = 0x141,
+                     .reply_id = 0x241,
+                     .processing_ns = 50'000,
+                     .broadcast_id = 0x280 });
+    std::vector<std::pair<can::id_t, std::uint64_t>> received;
+    bus.host().on_receive([&](hal::can::message_t const& p_message) {
+      received.emplace_back(p_message.id, bus.now());
+    });
+    hal::can::message_t const broadcast{ .id = 0x280, .length = 8 };
+
+    // Exercise
+    bus.host().send(broadcast);
+    bus.advance(500'000);
+
+    // Verify
+    // Both replies are ready at 161us, the loser waits one frame for the bus
+    expect(that % 2 == received.size());
+    expect(that % 0x241 == received[0].first);
+    expect(that % 272'000 == received[0].second);
+    expect(that % 0x242 == received[1].first);
+    expect(that % 383'000 == received[1].second);
+    expect(that % 1 == bus.stats().arbitration_losses);
+    expect(that % 111'000 == bus.stats().worst_access_ns);
+  };
+}
+}  // namespace hal::rmd
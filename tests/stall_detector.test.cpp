@@ -0,0 +1,107 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/stall_detector.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal::rmd {
+void stall_detector_test()
+{
+  using namespace boost::ut;
+  using namespace std::literals;
+  using namespace hal::literals;
+
+  "stall_detector reports a stall after the window"_test = []() {
+    // Setup
+    stall_detector detector(1.0_kHz,
+                            { .speed_threshold = 1.0_rpm,
+                              .current_threshold = 2.0_A,
+                              .window = 20ms });
+    detector.command(100.0_rpm);
+
+    // Exercise
+    auto const at_start = detector.update(0, 0.5_rpm, 3.0_A);
+    auto const in_window = detector.update(19, -0.5_rpm, -3.0_A);
+    auto const after_window = detector.update(20, 0.0_rpm, 3.0_A);
+    auto const still_stalled = detector.update(30, 0.0_rpm, 3.0_A);
+
+    // Verify
+    expect(not at_start);
+    expect(not in_window);
+    expect(after_window);
+    expect(not still_stalled);
+    expect(detector.stalled());
+    expect(that % 1 == detector.stalls());
+  };
+
+  "stall_detector ignores normal operation"_test = []() {
+    // Setup
+    stall_detector detector(1.0_kHz, { .window = 20ms });
+
+    // Exercise
+    // Not commanded to move, such as holding position
+    auto const idle = detector.update(0, 0.0_rpm, 5.0_A) ||
+                      detector.update(100, 0.0_rpm, 5.0_A);
+    detector.command(10.0_rpm);
+    // Moving under heavy load
+    auto const moving = detector.update(200, 10.0_rpm, 5.0_A) ||
+                        detector.update(300, 10.0_rpm, 5.0_A);
+    // Stationary but drawing little current, such as starting up
+    auto const light = detector.update(400, 0.0_rpm, 0.5_A) ||
+                       detector.update(500, 0.0_rpm, 0.5_A);
+
+    // Verify
+    expect(not idle);
+    expect(not moving);
+    expect(not light);
+    expect(that % 0 == detector.stalls());
+  };
+
+  "stall_detector recovers and detects again"_test = []() {
+    // Setup
+    stall_detector detector(1.0_kHz, { .window = 10ms });
+    detector.command(10.0_rpm);
+    detector.update(0, 0.0_rpm, 5.0_A);
+    detector.update(10, 0.0_rpm, 5.0_A);
+
+    // Exercise
+    detector.update(20, 10.0_rpm, 1.0_A);
+    auto const recovered = not detector.stalled();
+    auto const first = detector.update(30, 0.0_rpm, 5.0_A);
+    auto const second = detector.update(40, 0.0_rpm, 5.0_A);
+
+    // Verify
+    expect(recovered);
+    expect(not first);
+    expect(second);
+    expect(that % 2 == detector.stalls());
+  };
+
+  "stall_detector::command() zero disarms"_test = []() {
+    // Setup
+    stall_detector detector(1.0_kHz, { .window = 10ms });
+    detector.command(10.0_rpm);
+    detector.update(0, 0.0_rpm, 5.0_A);
+
+    // Exercise
+    detector.command(0.0_rpm);
+    auto const stalled = detector.update(50, 0.0_rpm, 5.0_A);
+
+    // Verify
+    expect(not stalled);
+    expect(that % 0 == detector.stalls());
+  };
+}
+}  // namespace hal::rmd
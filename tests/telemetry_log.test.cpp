@@ -0,0 +1,201 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-rmd/telemetry_log.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal::rmd {
+namespace {
+struct log_buffer
+{
+  std::vector<hal::byte> bytes;
+
+  telemetry_log_writer::sink_t sink()
+  {
+    return [this](std::span<hal::byte const> p_chunk) {
+      bytes.insert(bytes.end(), p_chunk.begin(), p_chunk.end());
+    };
+  }
+};
+
+std::vector<telemetry_sample> read_all(telemetry_log_reader& p_reader)
+{
+  std::vector<telemetry_sample> samples;
+  while (auto sample = p_reader.next()) {
+    samples.push_back(*sample);
+  }
+  return samples;
+}
+
+telemetry_sample sample(can::id_t p_id, std::uint64_t p_timestamp)
+{
+  return {
+    .timestamp = p_timestamp,
+    .device_id = p_id,
+    .message_number = 1,
+    .raw_multi_turn_angle = 36'000,
+    .raw_current = -120,
+    .raw_speed = 300,
+    .raw_volts = 240,
+    .encoder = 1000,
+    .raw_motor_temperature = 35,
+  };
+}
+}  // namespace
+
+void telemetry_log_test()
+{
+  using namespace boost::ut;
+
+  "telemetry_log round trips samples of many motors"_test = []() {
+    // Setup
+    log_buffer buffer;
+    telemetry_log_writer writer(buffer.sink());
+    std::vector<telemetry_sample> expected;
+    for (std::uint64_t i = 0; i < 100; i++) {
+      for (can::id_t id = 0x141; id < 0x144; id++) {
+        auto next = sample(id, i * 1000 + id);
+        next.model = id == 0x143 ? telemetry_sample::model_t::mc_x
+                                 : telemetry_sample::model_t::drc;
+        next.message_number = static_cast<std::uint32_t>(i * 2);
+        next.raw_multi_turn_angle = static_cast<std::int64_t>(i * i) - 50;
+        next.raw_speed = static_cast<std::int16_t>(i % 7);
+        next.raw_error_state = i == 50 ? 0x0400 : 0;
+        expected.push_back(next);
+      }
+    }
+
+    // Exercise
+    for (auto const& entry : expected) {
+      writer.write(entry);
+    }
+    telemetry_log_reader reader(buffer.bytes);
+    auto const decoded = read_all(reader);
+
+    // Verify
+    expect(decoded == expected);
+    expect(not reader.truncated());
+    expect(that % buffer.bytes.size() == writer.bytes());
+    expect(that % 300 == writer.samples());
+  };
+
+  "telemetry_log round trips wrapping and extreme values"_test = []() {
+    // Setup
+    log_buffer buffer;
+    telemetry_log_writer writer(buffer.sink());
+    auto first = sample(0x141, std::numeric_limits<std::uint64_t>::max());
+    first.encoder = std::numeric_limits<std::int16_t>::max();
+    first.raw_multi_turn_angle = std::numeric_limits<std::int64_t>::max();
+    first.message_number = std::numeric_limits<std::uint32_t>::max();
+    first.raw_motor_temperature = std::numeric_limits<std::int8_t>::min();
+    auto second = first;
+    second.timestamp = 5;
+    second.encoder = std::numeric_limits<std::int16_t>::min();
+    second.raw_multi_turn_angle = std::numeric_limits<std::int64_t>::min();
+    second.message_number = 0;
+    second.raw_motor_temperature = std::numeric_limits<std::int8_t>::max();
+
+    // Exercise
+    writer.write(first);
+    writer.write(second);
+    telemetry_log_reader reader(buffer.bytes);
+    auto const decoded = read_all(reader);
+
+    // Verify
+    expect(decoded == std::vector{ first, second });
+  };
+
+  "telemetry_log_writer only stores changed field groups"_test = []() {
+    // Setup
+    log_buffer buffer;
+    telemetry_log_writer writer(buffer.sink());
+    auto const first = sample(0x141, 1000);
+    auto second = first;
+    second.timestamp += 1000;
+    second.message_number++;
+
+    // Exercise
+    writer.write(first);
+    auto const after_key = buffer.bytes.size();
+    writer.write(second);
+    auto const unchanged_size = buffer.bytes.size() - after_key;
+
+    // Verify
+    // Index and groups, 2 byte timestamp delta and 1 byte message delta
+    expect(that % 5 == unchanged_size);
+  };
+
+  "drc feedback is stored with its model"_test = []() {
+    // Setup
+    log_buffer buffer;
+    telemetry_log_writer writer(buffer.sink());
+    drc::feedback_t drc_feedback{};
+    drc_feedback.raw_error_state = 0x08;
+    mc_x::feedback_t mc_x_feedback{};
+    mc_x_feedback.raw_error_state = 0x0400;
+
+    // Exercise
+    writer.write(10, 0x141, drc_feedback);
+    writer.write(20, 0x142, mc_x_feedback);
+    telemetry_log_reader reader(buffer.bytes);
+    auto const decoded = read_all(reader);
+
+    // Verify
+    expect(that % 2 == decoded.size());
+    expect(telemetry_sample::model_t::drc == decoded[0].model);
+    expect(that % 0x08 == decoded[0].raw_error_state);
+    expect(telemetry_sample::model_t::mc_x == decoded[1].model);
+    expect(that % 0x0400 == decoded[1].raw_error_state);
+    expect(that % 20 == decoded[1].timestamp);
+  };
+
+  "telemetry_log_reader stops at a truncated record"_test = []() {
+    // Setup
+    log_buffer buffer;
+    telemetry_log_writer writer(buffer.sink());
+    writer.write(sample(0x141, 10));
+    writer.write(sample(0x142, 20));
+    buffer.bytes.pop_back();
+
+    // Exercise
+    telemetry_log_reader reader(buffer.bytes);
+    auto const decoded = read_all(reader);
+
+    // Verify
+    expect(that % 1 == decoded.size());
+    expect(reader.truncated());
+  };
+
+  "telemetry_log rejects bad headers and too many motors"_test = []() {
+    std::vector<hal::byte> const bad_header{ 'R', 'M', 'D', 'X', 1 };
+    expect(throws<hal::io_error>(
+      [&]() { telemetry_log_reader reader(bad_header); }));
+
+    log_buffer buffer;
+    telemetry_log_writer writer(buffer.sink());
+    for (can::id_t i = 0; i < telemetry_log_writer::max_motors; i++) {
+      writer.write(sample(0x100 + i, 0));
+    }
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { writer.write(sample(0x200, 0)); }));
+  };
+}
+}  // namespace hal::rmd
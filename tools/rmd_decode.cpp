@@ -0,0 +1,678 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <libhal-canrouter/can_router.hpp>
+#include <libhal-rmd/can_trace.hpp>
+#include <libhal-rmd/drc.hpp>
+#include <libhal-rmd/mc_x.hpp>
+#include <libhal-rmd/scheduler.hpp>
+#include <libhal/error.hpp>
+
+namespace {
+using hal::rmd::drc;
+using hal::rmd::mc_x;
+using hal::rmd::trace_direction;
+using hal::rmd::trace_record;
+
+constexpr std::size_t max_motors = 32;
+constexpr hal::can::id_t first_motor_id = 0x141;
+constexpr hal::can::id_t mc_x_response_offset = 0x100;
+constexpr hal::can::id_t mc_x_multi_motor_id = 0x280;
+
+/// Discards every frame, the drivers are only used for their decoders
+struct null_can : public hal::can
+{
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  void driver_bus_on() override
+  {
+  }
+
+  void driver_send(message_t const&) override
+  {
+  }
+
+  void driver_on_receive(hal::callback<handler>) override
+  {
+  }
+};
+
+struct null_clock : public hal::steady_clock
+{
+  hal::hertz driver_frequency() override
+  {
+    return 1'000'000.0f;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    return 0;
+  }
+};
+
+/// Read only memory mapping of an entire capture file
+class mapped_file
+{
+public:
+  explicit mapped_file(char const* p_path)
+  {
+    auto const descriptor = ::open(p_path, O_RDONLY);
+    if (descriptor < 0) {
+      return;
+    }
+    struct stat info{};
+    if (::fstat(descriptor, &info) == 0 && info.st_size > 0) {
+      auto const size = static_cast<std::size_t>(info.st_size);
+      auto* const address =
+        ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+      if (address != MAP_FAILED) {
+        // Captures are read front to back exactly once
+        ::madvise(address, size, MADV_SEQUENTIAL);
+        m_data = { static_cast<hal::byte const*>(address), size };
+      }
+    }
+    ::close(descriptor);
+  }
+
+  mapped_file(mapped_file&) = delete;
+  mapped_file& operator=(mapped_file&) = delete;
+
+  ~mapped_file()
+  {
+    if (not m_data.empty()) {
+      ::munmap(const_cast<hal::byte*>(m_data.data()), m_data.size());
+    }
+  }
+
+  std::span<hal::byte const> data() const
+  {
+    return m_data;
+  }
+
+private:
+  std::span<hal::byte const> m_data{};
+};
+
+/**
+ * @brief Log-linear histogram of round trip times in microseconds
+ *
+ * Each power of two is split into 8 buckets, bounding the error of a reported
+ * percentile to 12.5% with a fixed amount of memory, regardless of how many
+ * samples a capture holds.
+ */
+class rtt_histogram
+{
+public:
+  void add(std::uint64_t p_microseconds)
+  {
+    m_buckets[bucket(p_microseconds)]++;
+    m_count++;
+  }
+
+  /**
+   * @param p_fraction - percentile to report within [0, 1]
+   * @return std::uint64_t - lower bound of the bucket holding the percentile
+   */
+  std::uint64_t percentile(double p_fraction) const
+  {
+    auto const rank = static_cast<std::uint64_t>(
+      std::ceil(p_fraction * static_cast<double>(m_count)));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < m_buckets.size(); i++) {
+      seen += m_buckets[i];
+      if (seen >= std::max<std::uint64_t>(rank, 1)) {
+        return lower_bound(i);
+      }
+    }
+    return 0;
+  }
+
+private:
+  static constexpr std::size_t sub_buckets = 8;
+  static constexpr std::size_t sub_bucket_bits = 3;
+
+  static std::size_t bucket(std::uint64_t p_value)
+  {
+    if (p_value < sub_buckets) {
+      return static_cast<std::size_t>(p_value);
+    }
+    auto const msb = static_cast<std::size_t>(std::bit_width(p_value) - 1);
+    auto const sub = (p_value >> (msb - sub_bucket_bits)) & (sub_buckets - 1);
+    return (msb - sub_bucket_bits + 1) * sub_buckets +
+           static_cast<std::size_t>(sub);
+  }
+
+  static std::uint64_t lower_bound(std::size_t p_bucket)
+  {
+    if (p_bucket < sub_buckets) {
+      return p_bucket;
+    }
+    auto const msb = p_bucket / sub_buckets + sub_bucket_bits - 1;
+    auto const sub = p_bucket % sub_buckets;
+    return (sub_buckets + sub) << (msb - sub_bucket_bits);
+  }
+
+  std::array<std::uint64_t, 64 * sub_buckets> m_buckets{};
+  std::uint64_t m_count = 0;
+};
+
+enum class model_t : std::uint8_t
+{
+  unknown,
+  drc,
+  mc_x,
+};
+
+struct motor_state
+{
+  struct request_t
+  {
+    std::uint64_t timestamp;
+    hal::byte command;
+    /// Payload of the request, a repeat of it is a retry rather than a reply
+    std::array<hal::byte, 8> payload;
+  };
+
+  model_t model = model_t::unknown;
+  std::optional<request_t> outstanding{};
+  std::uint64_t requests = 0;
+  std::uint64_t replies = 0;
+  std::uint64_t unanswered = 0;
+  std::uint64_t unsolicited = 0;
+  std::uint64_t rtt_samples = 0;
+  std::uint64_t rtt_min = UINT64_MAX;
+  std::uint64_t rtt_max = 0;
+  double rtt_sum = 0.0;
+  double rtt_sum_of_squares = 0.0;
+  rtt_histogram histogram{};
+  std::unique_ptr<drc> drc_decoder{};
+  std::unique_ptr<mc_x> mc_x_decoder{};
+};
+
+char const* command_name(hal::byte p_command)
+{
+  switch (p_command) {
+    case 0x19:
+      return "current_position_to_rom_as_motor_zero";
+    case 0x30:
+      return "read_pid";
+    case 0x31:
+      return "pid_to_ram";
+    case 0x32:
+      return "pid_to_rom";
+    case 0x33:
+      return "read_acceleration";
+    case 0x34:
+      return "acceleration_data_to_ram";
+    case 0x91:
+      return "encoder_offset";
+    case 0x92:
+      return "multi_turns_angle";
+    case 0x9A:
+      return "status_1_and_error_flags";
+    case 0x9B:
+      return "clear_error_flag";
+    case 0x9C:
+      return "status_2";
+    case 0xA1:
+      return "torque";
+    case 0xA2:
+      return "speed";
+    case 0xA4:
+      return "position_2";
+    case 0xA5:
+      return "position";
+    case 0xA8:
+      return "incremental_position";
+    case 0x80:
+      return "off";
+    case 0x81:
+      return "stop";
+    case 0x88:
+      return "running";
+    default:
+      return "unknown";
+  }
+}
+
+char const* priority_name(hal::rmd::scheduler::priority p_priority)
+{
+  using priority = hal::rmd::scheduler::priority;
+  switch (p_priority) {
+    case priority::emergency:
+      return "emergency";
+    case priority::setpoint:
+      return "setpoint";
+    case priority::telemetry:
+      return "telemetry";
+    default:
+      return "configuration";
+  }
+}
+
+struct options_t
+{
+  bool timeline = false;
+  std::optional<hal::can::id_t> motor{};
+};
+
+/**
+ * @brief Classifies frames of a capture and decodes replies with the drivers
+ *
+ * Frames on 0x141 to 0x160 are requests to a motor or replies of a DRC motor,
+ * frames on 0x241 to 0x260 are replies of an MC-X motor and 0x280 carries MC-X
+ * multi-motor commands. candump logs do not record direction, so a frame on a
+ * request ID is taken as a DRC reply when it echoes the command byte of the
+ * motor's outstanding request without repeating it byte for byte and the motor
+ * is not known to be an MC-X.
+ */
+class decoder
+{
+public:
+  decoder(options_t p_options, hal::hertz p_frequency)
+    : m_options(p_options)
+    , m_microseconds_per_tick(1e6 / static_cast<double>(p_frequency))
+  {
+  }
+
+  void process(trace_record const& p_record, bool p_direction_known)
+  {
+    auto const& message = p_record.message;
+    m_frames++;
+    m_last_timestamp = p_record.timestamp;
+    if (m_frames == 1) {
+      m_first_timestamp = p_record.timestamp;
+    }
+
+    if (message.length == 0 || message.is_remote_request) {
+      m_other++;
+      return;
+    }
+
+    auto const command = message.payload[0];
+    if (message.id == mc_x_multi_motor_id) {
+      m_broadcasts++;
+      m_last_broadcast = motor_state::request_t{
+        p_record.timestamp, command, message.payload
+      };
+      count_request(command);
+      if (timeline(message.id)) {
+        print_frame(p_record, message.id, "broadcast", command);
+        std::printf("\n");
+      }
+      return;
+    }
+
+    if (in_range(message.id, first_motor_id)) {
+      auto& motor = m_motors[message.id - first_motor_id];
+      bool const reply =
+        p_direction_known
+          ? p_record.direction == trace_direction::receive
+          : motor.outstanding && motor.model != model_t::mc_x &&
+              motor.outstanding->command == command &&
+              motor.outstanding->payload != message.payload;
+      if (reply) {
+        on_reply(p_record, message.id, motor, model_t::drc);
+      } else {
+        on_request(p_record, message.id, motor);
+      }
+      return;
+    }
+
+    if (in_range(message.id, first_motor_id + mc_x_response_offset)) {
+      auto const id = message.id - mc_x_response_offset;
+      on_reply(p_record, id, m_motors[id - first_motor_id], model_t::mc_x);
+      return;
+    }
+
+    m_other++;
+  }
+
+  void summarize() const
+  {
+    std::printf("frames %llu, motor traffic over %.6f s, mc_x broadcasts %llu,"
+                " other frames %llu\n",
+                to_ull(m_frames),
+                to_microseconds(m_last_timestamp - m_first_timestamp) / 1e6,
+                to_ull(m_broadcasts),
+                to_ull(m_other));
+    std::printf("requests by class: emergency %llu, setpoint %llu, "
+                "telemetry %llu, configuration %llu\n",
+                to_ull(m_requests_by_priority[0]),
+                to_ull(m_requests_by_priority[1]),
+                to_ull(m_requests_by_priority[2]),
+                to_ull(m_requests_by_priority[3]));
+    std::printf("\n%-6s %-7s %10s %10s %10s %11s %9s %9s %9s %9s %9s %9s\n",
+                "motor",
+                "model",
+                "requests",
+                "replies",
+                "unanswered",
+                "unsolicited",
+                "rtt_min",
+                "rtt_mean",
+                "rtt_p50",
+                "rtt_p99",
+                "rtt_max",
+                "rtt_stdev");
+
+    for (std::size_t i = 0; i < m_motors.size(); i++) {
+      auto const& motor = m_motors[i];
+      auto const id = static_cast<hal::can::id_t>(first_motor_id + i);
+      if (motor.requests == 0 && motor.replies == 0) {
+        continue;
+      }
+      if (m_options.motor && *m_options.motor != id) {
+        continue;
+      }
+      auto const unanswered = motor.unanswered + (motor.outstanding ? 1 : 0);
+      std::printf("0x%03X  %-7s %10llu %10llu %10llu %11llu",
+                  static_cast<unsigned>(id),
+                  model_name(motor.model),
+                  to_ull(motor.requests),
+                  to_ull(motor.replies),
+                  to_ull(unanswered),
+                  to_ull(motor.unsolicited));
+
+      if (motor.rtt_samples == 0) {
+        std::printf(" %9s %9s %9s %9s %9s %9s\n", "-", "-", "-", "-", "-", "-");
+        continue;
+      }
+      auto const count = static_cast<double>(motor.rtt_samples);
+      auto const mean = motor.rtt_sum / count;
+      auto const variance =
+        std::max(0.0, motor.rtt_sum_of_squares / count - mean * mean);
+      std::printf(" %9llu %9.1f %9llu %9llu %9llu %9.1f\n",
+                  to_ull(motor.rtt_min),
+                  mean,
+                  to_ull(motor.histogram.percentile(0.50)),
+                  to_ull(motor.histogram.percentile(0.99)),
+                  to_ull(motor.rtt_max),
+                  std::sqrt(variance));
+    }
+    std::printf("\nrtt columns are in microseconds, percentiles are accurate "
+                "to 12.5%%\n");
+  }
+
+private:
+  static bool in_range(hal::can::id_t p_id, hal::can::id_t p_first)
+  {
+    return p_first <= p_id && p_id < p_first + max_motors;
+  }
+
+  static unsigned long long to_ull(std::uint64_t p_value)
+  {
+    return static_cast<unsigned long long>(p_value);
+  }
+
+  static char const* model_name(model_t p_model)
+  {
+    switch (p_model) {
+      case model_t::drc:
+        return "drc";
+      case model_t::mc_x:
+        return "mc_x";
+      default:
+        return "unknown";
+    }
+  }
+
+  double to_microseconds(std::uint64_t p_ticks) const
+  {
+    return static_cast<double>(p_ticks) * m_microseconds_per_tick;
+  }
+
+  void count_request(hal::byte p_command)
+  {
+    auto const priority = hal::rmd::scheduler::classify(p_command);
+    m_requests_by_priority[static_cast<std::size_t>(priority)]++;
+  }
+
+  void on_request(trace_record const& p_record,
+                  hal::can::id_t p_id,
+                  motor_state& p_motor)
+  {
+    auto const command = p_record.message.payload[0];
+    if (p_motor.outstanding) {
+      p_motor.unanswered++;
+    }
+    p_motor.outstanding = motor_state::request_t{
+      p_record.timestamp, command, p_record.message.payload
+    };
+    p_motor.requests++;
+    count_request(command);
+    if (timeline(p_id)) {
+      print_frame(p_record, p_id, "request", command);
+      std::printf("\n");
+    }
+  }
+
+  void on_reply(trace_record const& p_record,
+                hal::can::id_t p_id,
+                motor_state& p_motor,
+                model_t p_model)
+  {
+    auto const& message = p_record.message;
+    auto const command = message.payload[0];
+    p_motor.model = p_model;
+    p_motor.replies++;
+
+    // Replies to MC-X multi-motor commands are timed from the broadcast
+    std::optional<motor_state::request_t> request{};
+    if (p_motor.outstanding && p_motor.outstanding->command == command) {
+      request = p_motor.outstanding;
+      p_motor.outstanding.reset();
+    } else if (p_model == model_t::mc_x && m_last_broadcast &&
+               m_last_broadcast->command == command) {
+      request = m_last_broadcast;
+    }
+
+    std::optional<std::uint64_t> rtt{};
+    if (request && p_record.timestamp >= request->timestamp) {
+      rtt = static_cast<std::uint64_t>(
+        std::llround(to_microseconds(p_record.timestamp - request->timestamp)));
+      p_motor.rtt_samples++;
+      p_motor.rtt_min = std::min(p_motor.rtt_min, *rtt);
+      p_motor.rtt_max = std::max(p_motor.rtt_max, *rtt);
+      p_motor.rtt_sum += static_cast<double>(*rtt);
+      p_motor.rtt_sum_of_squares +=
+        static_cast<double>(*rtt) * static_cast<double>(*rtt);
+      p_motor.histogram.add(*rtt);
+    } else {
+      p_motor.unsolicited++;
+    }
+
+    if (not timeline(p_id)) {
+      return;
+    }
+    print_frame(p_record, p_id, "reply", command);
+    if (p_model == model_t::drc) {
+      if (not p_motor.drc_decoder) {
+        p_motor.drc_decoder = std::make_unique<drc>(
+          m_router, m_clock, 1.0f, p_id, m_timeout, drc::startup::attach);
+      }
+      (*p_motor.drc_decoder)(message);
+      print_feedback(p_motor.drc_decoder->feedback(), rtt);
+    } else {
+      if (not p_motor.mc_x_decoder) {
+        p_motor.mc_x_decoder =
+          std::make_unique<mc_x>(m_router, m_clock, 1.0f, p_id, m_timeout);
+      }
+      (*p_motor.mc_x_decoder)(message);
+      print_feedback(p_motor.mc_x_decoder->feedback(), rtt);
+    }
+  }
+
+  bool timeline(hal::can::id_t p_id) const
+  {
+    return m_options.timeline &&
+           (not m_options.motor || *m_options.motor == p_id);
+  }
+
+  void print_frame(trace_record const& p_record,
+                   hal::can::id_t p_id,
+                   char const* p_kind,
+                   hal::byte p_command) const
+  {
+    std::printf("%.6f 0x%03X %-9s %-24s %s",
+                to_microseconds(p_record.timestamp) / 1e6,
+                static_cast<unsigned>(p_id),
+                p_kind,
+                command_name(p_command),
+                priority_name(hal::rmd::scheduler::classify(p_command)));
+  }
+
+  template<class feedback_type>
+  static void print_feedback(feedback_type const& p_feedback,
+                             std::optional<std::uint64_t> p_rtt)
+  {
+    std::printf("  angle=%.2f speed=%.2f current=%.2f volts=%.1f temp=%.0f "
+                "error=0x%X",
+                static_cast<double>(p_feedback.angle()),
+                static_cast<double>(p_feedback.speed()),
+                static_cast<double>(p_feedback.current()),
+                static_cast<double>(p_feedback.volts()),
+                static_cast<double>(p_feedback.temperature()),
+                static_cast<unsigned>(p_feedback.raw_error_state));
+    if (p_rtt) {
+      std::printf(" rtt=%lluus", to_ull(*p_rtt));
+    }
+    std::printf("\n");
+  }
+
+  options_t m_options;
+  double m_microseconds_per_tick;
+  null_can m_can{};
+  hal::can_router m_router{ m_can };
+  null_clock m_clock{};
+  hal::time_duration m_timeout = std::chrono::milliseconds(10);
+  std::array<motor_state, max_motors> m_motors{};
+  std::array<std::uint64_t, 4> m_requests_by_priority{};
+  std::optional<motor_state::request_t> m_last_broadcast{};
+  std::uint64_t m_frames = 0;
+  std::uint64_t m_broadcasts = 0;
+  std::uint64_t m_other = 0;
+  std::uint64_t m_first_timestamp = 0;
+  std::uint64_t m_last_timestamp = 0;
+};
+
+bool is_binary_trace(std::span<hal::byte const> p_data)
+{
+  constexpr std::string_view magic = "RMDT";
+  return p_data.size() >= magic.size() &&
+         std::equal(magic.begin(), magic.end(), p_data.begin());
+}
+}  // namespace
+
+/**
+ * Decodes a capture of RMD bus traffic into per-motor timelines and round trip
+ * time statistics.
+ *
+ * Usage: libhal-rmd-decode [--timeline] [--motor <id>] <capture>
+ *
+ * The capture is either a binary trace written by hal::rmd::can_trace_recorder
+ * or a `candump -l` log. It is memory mapped and processed in a single pass,
+ * so captures of any size are decoded with constant memory.
+ */
+int main(int p_argc, char** p_argv)
+{
+  options_t options;
+  char const* path = nullptr;
+  for (int i = 1; i < p_argc; i++) {
+    std::string_view const argument = p_argv[i];
+    if (argument == "--timeline") {
+      options.timeline = true;
+    } else if (argument == "--motor" && i + 1 < p_argc) {
+      options.motor =
+        static_cast<hal::can::id_t>(std::strtoul(p_argv[++i], nullptr, 0));
+    } else {
+      path = p_argv[i];
+    }
+  }
+
+  if (path == nullptr) {
+    std::fprintf(
+      stderr, "usage: %s [--timeline] [--motor <id>] <capture>\n", p_argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  mapped_file const file(path);
+  auto const data = file.data();
+  if (data.empty()) {
+    std::fprintf(stderr, "unable to map %s\n", path);
+    return EXIT_FAILURE;
+  }
+
+  if (is_binary_trace(data)) {
+    try {
+      hal::rmd::can_trace_reader reader(data);
+      decoder decode(options, reader.frequency());
+      while (auto const record = reader.next()) {
+        decode.process(*record, true);
+      }
+      decode.summarize();
+    } catch (hal::argument_out_of_domain const&) {
+      std::fprintf(stderr, "%s has an unsupported trace header\n", path);
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  decoder decode(options, 1'000'000.0f);
+  std::string_view const text(reinterpret_cast<char const*>(data.data()),
+                              data.size());
+  std::uint64_t skipped = 0;
+  for (std::size_t start = 0; start < text.size();) {
+    auto end = text.find('\n', start);
+    if (end == text.npos) {
+      end = text.size();
+    }
+    if (auto const record = hal::rmd::parse_candump(
+          text.substr(start, end - start))) {
+      decode.process(*record, false);
+    } else if (end > start) {
+      skipped++;
+    }
+    start = end + 1;
+  }
+  decode.summarize();
+  if (skipped != 0) {
+    std::fprintf(stderr,
+                 "skipped %llu lines that are not classic CAN frames\n",
+                 static_cast<unsigned long long>(skipped));
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <libhal-rmd/telemetry_log.hpp>
+#include <libhal/error.hpp>
+
+namespace {
+/// Decode the raw fields of a sample with the units of its motor model
+template<class feedback_type>
+feedback_type to_feedback(hal::rmd::telemetry_sample const& p_sample)
+{
+  feedback_type feedback{};
+  feedback.message_number = p_sample.message_number;
+  feedback.raw_multi_turn_angle = p_sample.raw_multi_turn_angle;
+  feedback.raw_current = p_sample.raw_current;
+  feedback.raw_speed = p_sample.raw_speed;
+  feedback.raw_volts = p_sample.raw_volts;
+  feedback.encoder = p_sample.encoder;
+  feedback.raw_motor_temperature = p_sample.raw_motor_temperature;
+  feedback.raw_error_state =
+    static_cast<decltype(feedback.raw_error_state)>(p_sample.raw_error_state);
+  return feedback;
+}
+
+template<class feedback_type>
+void print_units(hal::rmd::telemetry_sample const& p_sample)
+{
+  auto const feedback = to_feedback<feedback_type>(p_sample);
+  std::printf(",%.3f,%.3f,%.3f,%.2f,%.1f",
+              static_cast<double>(feedback.angle()),
+              static_cast<double>(feedback.speed()),
+              static_cast<double>(feedback.current()),
+              static_cast<double>(feedback.volts()),
+              static_cast<double>(feedback.temperature()));
+}
+}  // namespace
+
+/**
+ * Converts a telemetry log written by hal::rmd::telemetry_log_writer to CSV.
+ *
+ * Usage: libhal-rmd-log-to-csv <log file> [clock frequency in Hz]
+ *
+ * When the frequency of the logging clock is given, timestamps are printed in
+ * seconds, otherwise in clock ticks.
+ */
+int main(int p_argc, char** p_argv)
+{
+  if (p_argc < 2) {
+    std::fprintf(stderr, "usage: %s <log file> [clock hz]\n", p_argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream file(p_argv[1], std::ios::binary);
+  if (not file) {
+    std::fprintf(stderr, "unable to open %s\n", p_argv[1]);
+    return EXIT_FAILURE;
+  }
+  std::vector<hal::byte> const log(std::istreambuf_iterator<char>(file), {});
+  auto const frequency = p_argc > 2 ? std::strtod(p_argv[2], nullptr) : 0.0;
+
+  try {
+    hal::rmd::telemetry_log_reader reader(log);
+    std::printf("%s,device_id,model,message_number,raw_multi_turn_angle,"
+                "encoder,error_state,angle_deg,speed_rpm,current_a,volts,"
+                "temperature_c\n",
+                frequency > 0.0 ? "time_s" : "timestamp_ticks");
+
+    while (auto const sample = reader.next()) {
+      if (frequency > 0.0) {
+        std::printf("%.9f", static_cast<double>(sample->timestamp) / frequency);
+      } else {
+        std::printf("%llu", static_cast<unsigned long long>(sample->timestamp));
+      }
+      using model_t = hal::rmd::telemetry_sample::model_t;
+      bool const drc = sample->model == model_t::drc;
+      std::printf(",0x%03X,%s,%u,%lld,%d,0x%04X",
+                  static_cast<unsigned>(sample->device_id),
+                  drc ? "drc" : "mc_x",
+                  static_cast<unsigned>(sample->message_number),
+                  static_cast<long long>(sample->raw_multi_turn_angle),
+                  sample->encoder,
+                  static_cast<unsigned>(sample->raw_error_state));
+      if (drc) {
+        print_units<hal::rmd::drc::feedback_t>(*sample);
+      } else {
+        print_units<hal::rmd::mc_x::feedback_t>(*sample);
+      }
+      std::printf("\n");
+    }
+
+    if (reader.truncated()) {
+      std::fprintf(stderr, "warning: log ends with a truncated record\n");
+    }
+  } catch (hal::io_error const&) {
+    std::fprintf(stderr, "%s is not a valid telemetry log\n", p_argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}